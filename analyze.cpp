@@ -0,0 +1,54 @@
+#include <cstring>
+#include <iostream>
+#include <string>
+#include "Chip8.hpp"
+#include "RomAnalysis.hpp"
+
+// Disassembles a ROM without running it: follows every jump, call and skip
+// from the start address, splits the code into basic blocks and reports
+// what static analysis can't see (indirect jumps, self-modifying code) and
+// which interpreter quirks the ROM seems to rely on
+int main(int argc, char** argv)
+{
+    if(argc < 2)
+    {
+        std::cout << "Usage: " << argv[0] << " <rom> [--listing] [--dot file]" << "\n";
+        return -1;
+    }
+    bool listing = false;
+    std::string dotFile;
+    for(int i = 2; i < argc; i++)
+    {
+        if(std::strcmp(argv[i], "--listing") == 0)
+        {
+            listing = true;
+        }
+        else if(std::strcmp(argv[i], "--dot") == 0 && i + 1 < argc)
+        {
+            dotFile = argv[++i];
+        }
+        else
+        {
+            std::cout << "Unknown option: " << argv[i] << "\n";
+            return -1;
+        }
+    }
+
+    Chip8 chip8;
+    if(chip8.LoadRom(argv[1]) < 0)
+    {
+        return -1;
+    }
+    const std::shared_ptr<const RomAnalysis> analysis = RomAnalysis::Get(chip8);
+    if(listing)
+    {
+        analysis->WriteListing(std::cout);
+        std::cout << "\n";
+    }
+    analysis->WriteSummary(std::cout);
+    if(!dotFile.empty() && !analysis->WriteDot(dotFile))
+    {
+        return -1;
+    }
+    return 0;
+}
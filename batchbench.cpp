@@ -0,0 +1,107 @@
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <memory>
+#include <string>
+#include <vector>
+#include "Args.hpp"
+#include "BatchChip8.hpp"
+#include "Chip8.hpp"
+
+// Runs the same ROM on N lanes of BatchChip8 and on N separate Chip8 objects
+// with identical per lane input, checks both end in the same states and
+// reports the aggregate instructions per second of each
+static const uint32_t CYCLES_PER_FRAME = 10;
+
+// Lanes differ only in input: lane l holds key (l % 16) for a while
+static bool KeyHeld(uint32_t lane, uint32_t frame)
+{
+    return (frame / 30 + lane) % 4 == 0;
+}
+
+int main(int argc, char** argv)
+{
+    uint32_t lanes = 256, frames = 600;
+    if(argc < 2 || (argc > 2 && !ParseArg(argv[2], lanes)) || (argc > 3 && !ParseArg(argv[3], frames)))
+    {
+        std::cout << "Usage: " << argv[0] << " <rom> [lanes] [frames]" << "\n";
+        return -1;
+    }
+    std::ifstream file(argv[1], std::ios::binary);
+    std::vector<uint8_t> rom{std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>()};
+
+    std::vector<uint64_t> seeds(lanes);
+    for(uint32_t lane = 0; lane < lanes; lane++)
+    {
+        seeds[lane] = lane;
+    }
+
+    BatchChip8 batch{lanes};
+    batch.Seed(seeds.data());
+    if(batch.LoadRom(rom.data(), rom.size()) < 0)
+    {
+        std::cout << "Error: could not load " << argv[1] << "\n";
+        return -1;
+    }
+    auto start = std::chrono::steady_clock::now();
+    for(uint32_t frame = 0; frame < frames; frame++)
+    {
+        for(uint32_t lane = 0; lane < lanes; lane++)
+        {
+            batch.keypad[lane * sizes::numKeys + lane % sizes::numKeys] = KeyHeld(lane, frame);
+        }
+        for(uint32_t i = 0; i < CYCLES_PER_FRAME; i++)
+        {
+            batch.Step();
+        }
+        batch.UpdateTimers();
+    }
+    const double batchSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    std::vector<std::unique_ptr<Chip8>> machines;
+    for(uint32_t lane = 0; lane < lanes; lane++)
+    {
+        machines.push_back(std::make_unique<Chip8>());
+        machines.back()->Seed(seeds[lane]);
+        machines.back()->LoadRom(rom.data(), rom.size());
+    }
+    start = std::chrono::steady_clock::now();
+    for(uint32_t frame = 0; frame < frames; frame++)
+    {
+        for(uint32_t lane = 0; lane < lanes; lane++)
+        {
+            Chip8 &chip8 = *machines[lane];
+            chip8.keypad[lane % sizes::numKeys] = KeyHeld(lane, frame);
+            for(uint32_t i = 0; i < CYCLES_PER_FRAME; i++)
+            {
+                chip8.Cycle();
+            }
+            chip8.UpdateTimers();
+        }
+    }
+    const double scalarSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    uint32_t mismatches = 0;
+    for(uint32_t lane = 0; lane < lanes; lane++)
+    {
+        mismatches += batch.LaneStateHash(lane) != machines[lane]->StateHash();
+    }
+
+    const double instructions = static_cast<double>(lanes) * frames * CYCLES_PER_FRAME;
+    const double steps = static_cast<double>(batch.uniformSteps + batch.divergentSteps);
+    std::cout << "Lanes: " << lanes << ", frames: " << frames << ", AVX2: " << (batch.UsesAvx2() ? "yes" : "no") << "\n";
+    std::cout << "Batch:  " << instructions / batchSeconds / 1e6 << " MIPS aggregate ("
+              << 100.0 * batch.uniformSteps / steps << "% of steps in lockstep, "
+              << (batch.divergentSteps ? static_cast<double>(batch.divergentGroups) / batch.divergentSteps : 0.0)
+              << " opcode groups per divergent step)\n";
+    std::cout << "Chip8:  " << instructions / scalarSeconds / 1e6 << " MIPS aggregate\n";
+    std::cout << "Speedup: " << scalarSeconds / batchSeconds << "x\n";
+    if(mismatches)
+    {
+        std::cout << "ERROR: " << mismatches << " lanes ended in a different state than Chip8\n";
+        return 1;
+    }
+    std::cout << "All lanes match Chip8\n";
+    return 0;
+}
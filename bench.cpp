@@ -0,0 +1,360 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "Args.hpp"
+#include "BatchChip8.hpp"
+#include "BenchRoms.hpp"
+#include "Chip8.hpp"
+
+// Times every opcode kernel and workload from BenchRoms through each way of
+// executing instructions:
+//   chip8      Chip8::Cycle, function pointer table dispatch
+//   lockstep   BatchChip8 with every lane on the same instruction
+//   divergent  BatchChip8 with half the lanes a step behind, so every step
+//              runs lane by lane (kernels that loop on one instruction and
+//              workloads can't stay split and skip this path)
+// Each benchmark runs once to warm up and then --reps times. The table shows
+// the median, the fastest run and the relative standard deviation; --json
+// and --csv write the same numbers for tracking regressions
+using clock_type = std::chrono::steady_clock;
+
+static const uint32_t CYCLES_PER_FRAME = 10; // 600 IPS
+static const uint64_t KERNEL_INSTRUCTIONS = 2000000;
+static const uint64_t WORKLOAD_INSTRUCTIONS = 10000000;
+
+struct BenchOptions
+{
+    int reps = 5;
+    uint32_t lanes = 64;
+    uint64_t scale = 1; // Instructions are divided by this, --quick sets 10
+    std::string filter;
+    std::string jsonFile;
+    std::string csvFile;
+};
+
+struct Result
+{
+    std::string suite; // opcode or workload
+    std::string name;
+    std::string path;
+    uint64_t instructions; // Per run, summed over lanes
+    bool frames;           // Ran in frames of CYCLES_PER_FRAME + UpdateTimers
+    std::vector<double> seconds;
+    double median;
+    double fastest;
+    double stddevPct;
+};
+
+// Keeps the final states observable so nothing is optimised away
+static volatile uint64_t sink = 0;
+
+// What a run of the given budget really executes, runs are whole frames
+// and whole steps over every lane
+static uint64_t Executed(uint64_t instructions, bool frames, uint32_t lanes)
+{
+    const uint64_t perLane = instructions / lanes;
+    return (frames ? perLane / CYCLES_PER_FRAME * CYCLES_PER_FRAME : perLane) * lanes;
+}
+
+static double RunChip8(const benchroms::BenchRom &rom, uint64_t instructions, bool frames)
+{
+    Chip8 chip8;
+    chip8.Seed(1);
+    chip8.LoadRom(rom.data.data(), rom.data.size());
+    const auto start = clock_type::now();
+    if (frames)
+    {
+        for (uint64_t frame = 0; frame < instructions / CYCLES_PER_FRAME; frame++)
+        {
+            for (uint32_t i = 0; i < CYCLES_PER_FRAME; i++)
+            {
+                chip8.Cycle();
+            }
+            chip8.UpdateTimers();
+            chip8.screenUpdate = false;
+        }
+    }
+    else
+    {
+        for (uint64_t i = 0; i < instructions; i++)
+        {
+            chip8.Cycle();
+        }
+    }
+    const double seconds = std::chrono::duration<double>(clock_type::now() - start).count();
+    sink = sink ^ chip8.StateHash();
+    return seconds;
+}
+
+static double RunBatch(const benchroms::BenchRom &rom, uint64_t instructions, bool frames, uint32_t lanes, bool diverge)
+{
+    BatchChip8 batch{lanes};
+    const std::vector<uint64_t> seeds(lanes, 1);
+    batch.Seed(seeds.data());
+    batch.LoadRom(rom.data.data(), rom.data.size());
+    if (diverge)
+    {
+        for (uint32_t lane = 1; lane < lanes; lane += 2)
+        {
+            batch.keypad[lane * sizes::numKeys] = 1; // See the kernel prologue
+        }
+    }
+    const uint64_t steps = instructions / lanes;
+    const auto start = clock_type::now();
+    if (frames)
+    {
+        for (uint64_t frame = 0; frame < steps / CYCLES_PER_FRAME; frame++)
+        {
+            for (uint32_t i = 0; i < CYCLES_PER_FRAME; i++)
+            {
+                batch.Step();
+            }
+            batch.UpdateTimers();
+        }
+    }
+    else
+    {
+        for (uint64_t i = 0; i < steps; i++)
+        {
+            batch.Step();
+        }
+    }
+    const double seconds = std::chrono::duration<double>(clock_type::now() - start).count();
+    sink = sink ^ batch.LaneStateHash(0);
+    return seconds;
+}
+
+static void Summarise(Result &result)
+{
+    std::vector<double> sorted = result.seconds;
+    std::sort(sorted.begin(), sorted.end());
+    const size_t n = sorted.size();
+    result.median = n % 2 ? sorted[n / 2] : (sorted[n / 2 - 1] + sorted[n / 2]) / 2;
+    result.fastest = sorted.front();
+    double mean = 0;
+    for (double s : sorted)
+    {
+        mean += s;
+    }
+    mean /= n;
+    double variance = 0;
+    for (double s : sorted)
+    {
+        variance += (s - mean) * (s - mean);
+    }
+    variance /= n > 1 ? n - 1 : 1;
+    result.stddevPct = 100.0 * std::sqrt(variance) / mean;
+}
+
+static double NsPerInstruction(const Result &result, double seconds)
+{
+    return seconds * 1e9 / result.instructions;
+}
+
+static double Mips(const Result &result)
+{
+    return result.instructions / result.median / 1e6;
+}
+
+// Frames per second (summed over lanes), only for runs made of frames
+static double Fps(const Result &result)
+{
+    return result.instructions / CYCLES_PER_FRAME / result.median;
+}
+
+static void PrintResult(const Result &result)
+{
+    std::cout << std::left << std::setw(10) << result.name << std::setw(11) << result.path << std::right
+              << std::fixed << std::setprecision(1) << std::setw(10) << Mips(result)
+              << std::setprecision(2) << std::setw(10) << NsPerInstruction(result, result.median)
+              << std::setw(10) << NsPerInstruction(result, result.fastest)
+              << std::setprecision(1) << std::setw(7) << result.stddevPct << "%";
+    if (result.frames)
+    {
+        std::cout << std::setprecision(0) << std::setw(14) << Fps(result);
+    }
+    std::cout << "\n";
+}
+
+static bool WriteJson(const std::string &filename, const std::vector<Result> &results, const BenchOptions &options)
+{
+    std::ofstream out(filename);
+    if (!out)
+    {
+        std::cout << "Error: could not write " << filename << "\n";
+        return false;
+    }
+    out << std::setprecision(6) << "{\n  \"reps\": " << options.reps << ",\n  \"lanes\": " << options.lanes
+        << ",\n  \"cycles_per_frame\": " << CYCLES_PER_FRAME << ",\n  \"results\": [\n";
+    for (size_t i = 0; i < results.size(); i++)
+    {
+        const Result &result = results[i];
+        out << "    {\"suite\": \"" << result.suite << "\", \"name\": \"" << result.name << "\", \"path\": \""
+            << result.path << "\", \"instructions\": " << result.instructions
+            << ", \"mips\": " << Mips(result)
+            << ", \"ns_per_instruction\": " << NsPerInstruction(result, result.median)
+            << ", \"min_ns_per_instruction\": " << NsPerInstruction(result, result.fastest)
+            << ", \"stddev_pct\": " << result.stddevPct;
+        if (result.frames)
+        {
+            out << ", \"fps\": " << Fps(result);
+        }
+        out << ", \"seconds\": [";
+        for (size_t k = 0; k < result.seconds.size(); k++)
+        {
+            out << (k ? ", " : "") << result.seconds[k];
+        }
+        out << "]}" << (i + 1 < results.size() ? "," : "") << "\n";
+    }
+    out << "  ]\n}\n";
+    return static_cast<bool>(out);
+}
+
+static bool WriteCsv(const std::string &filename, const std::vector<Result> &results)
+{
+    std::ofstream out(filename);
+    if (!out)
+    {
+        std::cout << "Error: could not write " << filename << "\n";
+        return false;
+    }
+    out << std::setprecision(6) << "suite,name,path,instructions,reps,mips,ns_per_instruction,min_ns_per_instruction,stddev_pct,fps\n";
+    for (const Result &result : results)
+    {
+        out << result.suite << "," << result.name << "," << result.path << "," << result.instructions << ","
+            << result.seconds.size() << "," << Mips(result) << "," << NsPerInstruction(result, result.median) << ","
+            << NsPerInstruction(result, result.fastest) << "," << result.stddevPct << ",";
+        if (result.frames)
+        {
+            out << Fps(result);
+        }
+        out << "\n";
+    }
+    return static_cast<bool>(out);
+}
+
+template <typename Run>
+static Result Measure(const char *suite, const benchroms::BenchRom &rom, const char *path, uint64_t instructions,
+                      bool frames, uint32_t lanes, int reps, Run run)
+{
+    Result result{suite, rom.name, path, Executed(instructions, frames, lanes), frames, {}, 0, 0, 0};
+    run(); // Warm up caches, branch predictors and the page copies
+    for (int rep = 0; rep < reps; rep++)
+    {
+        result.seconds.push_back(run());
+    }
+    Summarise(result);
+    PrintResult(result);
+    return result;
+}
+
+static void PrintUsage(const char *program)
+{
+    std::cout << "Usage: " << program << " [--reps n] [--lanes n] [--filter name] [--quick] [--json file] [--csv file]" << "\n";
+}
+
+int main(int argc, char** argv)
+{
+    BenchOptions options;
+    for(int i = 1; i < argc; i++)
+    {
+        if(std::strcmp(argv[i], "--reps") == 0 && i + 1 < argc)
+        {
+            if(!ParseArg(argv[++i], options.reps))
+            {
+                PrintUsage(argv[0]);
+                return -1;
+            }
+            options.reps = std::max(1, options.reps);
+        }
+        else if(std::strcmp(argv[i], "--lanes") == 0 && i + 1 < argc)
+        {
+            if(!ParseArg(argv[++i], options.lanes))
+            {
+                PrintUsage(argv[0]);
+                return -1;
+            }
+            options.lanes = std::max(2u, options.lanes);
+        }
+        else if(std::strcmp(argv[i], "--filter") == 0 && i + 1 < argc)
+        {
+            options.filter = argv[++i];
+        }
+        else if(std::strcmp(argv[i], "--json") == 0 && i + 1 < argc)
+        {
+            options.jsonFile = argv[++i];
+        }
+        else if(std::strcmp(argv[i], "--csv") == 0 && i + 1 < argc)
+        {
+            options.csvFile = argv[++i];
+        }
+        else if(std::strcmp(argv[i], "--quick") == 0)
+        {
+            options.scale = 10;
+        }
+        else
+        {
+            PrintUsage(argv[0]);
+            return -1;
+        }
+    }
+
+    std::vector<Result> results;
+    const uint32_t lanes = options.lanes;
+    const int reps = options.reps;
+    auto selected = [&](const benchroms::BenchRom &rom) {
+        return options.filter.empty() || rom.name.find(options.filter) != std::string::npos;
+    };
+    std::cout << "Median of " << reps << " runs, " << lanes << " lanes for BatchChip8, "
+              << CYCLES_PER_FRAME << " cycles per frame\n";
+    std::cout << std::left << std::setw(10) << "name" << std::setw(11) << "path" << std::right << std::setw(10) << "MIPS"
+              << std::setw(10) << "ns/instr" << std::setw(10) << "min ns" << std::setw(8) << "stddev"
+              << std::setw(14) << "frames/s" << "\n";
+
+    const uint64_t kernelInstructions = KERNEL_INSTRUCTIONS / options.scale;
+    for (const benchroms::BenchRom &rom : benchroms::OpcodeKernels())
+    {
+        if (!selected(rom))
+        {
+            continue;
+        }
+        results.push_back(Measure("opcode", rom, "chip8", kernelInstructions, false, 1, reps,
+                                  [&] { return RunChip8(rom, kernelInstructions, false); }));
+        results.push_back(Measure("opcode", rom, "lockstep", kernelInstructions, false, lanes, reps,
+                                  [&] { return RunBatch(rom, kernelInstructions, false, lanes, false); }));
+        if (!rom.selfLoop)
+        {
+            results.push_back(Measure("opcode", rom, "divergent", kernelInstructions, false, lanes, reps,
+                                      [&] { return RunBatch(rom, kernelInstructions, false, lanes, true); }));
+        }
+    }
+
+    const uint64_t workloadInstructions = WORKLOAD_INSTRUCTIONS / options.scale;
+    for (const benchroms::BenchRom &rom : benchroms::Workloads())
+    {
+        if (!selected(rom))
+        {
+            continue;
+        }
+        results.push_back(Measure("workload", rom, "chip8", workloadInstructions, true, 1, reps,
+                                  [&] { return RunChip8(rom, workloadInstructions, true); }));
+        results.push_back(Measure("workload", rom, "lockstep", workloadInstructions, true, lanes, reps,
+                                  [&] { return RunBatch(rom, workloadInstructions, true, lanes, false); }));
+    }
+
+    if (!options.jsonFile.empty() && !WriteJson(options.jsonFile, results, options))
+    {
+        return -1;
+    }
+    if (!options.csvFile.empty() && !WriteCsv(options.csvFile, results))
+    {
+        return -1;
+    }
+    return 0;
+}
@@ -0,0 +1,119 @@
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include "Args.hpp"
+#include "Chip8.hpp"
+#include "CoroutineScheduler.hpp"
+
+// Runs many sessions of one ROM as coroutines, one CoroutineScheduler per
+// thread, as fast as possible. The first sessions are also run with plain
+// Cycle() calls to check the coroutine mode ends in exactly the same state
+static const uint32_t IPS = 600;
+static const uint32_t CHECKED_SESSIONS = 16;
+
+// Every session gets a key press now and then
+static uint16_t KeysAt(uint32_t session, uint32_t frame)
+{
+    return ((frame + session * 7) % 240 < 5) ? static_cast<uint16_t>(1u << (session % 16)) : 0;
+}
+
+int main(int argc, char** argv)
+{
+    uint32_t count = 1000, frames = 600, threadCount = 2;
+    if(argc < 2 || (argc > 2 && !ParseArg(argv[2], count)) || (argc > 3 && !ParseArg(argv[3], frames)) ||
+       (argc > 4 && (!ParseArg(argv[4], threadCount) || threadCount == 0)))
+    {
+        std::cout << "Usage: " << argv[0] << " <rom> [sessions] [frames] [threads]" << "\n";
+        return -1;
+    }
+    std::ifstream file(argv[1], std::ios::binary);
+    std::vector<uint8_t> rom{std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>()};
+
+    std::vector<std::unique_ptr<CoroutineScheduler>> schedulers;
+    for(uint32_t t = 0; t < threadCount; t++)
+    {
+        schedulers.push_back(std::make_unique<CoroutineScheduler>(count / threadCount + 1));
+    }
+    for(uint32_t i = 0; i < count; i++)
+    {
+        if(schedulers[i % threadCount]->AddSession(rom.data(), rom.size(), IPS, i) < 0)
+        {
+            std::cout << "Error: could not create session " << i << "\n";
+            return -1;
+        }
+    }
+
+    const auto start = std::chrono::steady_clock::now();
+    std::vector<std::thread> threads;
+    for(uint32_t t = 0; t < threadCount; t++)
+    {
+        threads.emplace_back([&, t] {
+            CoroutineScheduler &scheduler = *schedulers[t];
+            for(uint32_t frame = 0; frame < frames; frame++)
+            {
+                for(uint32_t local = 0; local * threadCount + t < count; local++)
+                {
+                    const uint32_t session = local * threadCount + t;
+                    if(KeysAt(session, frame) != KeysAt(session, frame - 1) || frame == 0)
+                    {
+                        scheduler.PressKeys(local, KeysAt(session, frame));
+                    }
+                }
+                scheduler.Tick();
+            }
+        });
+    }
+    for(std::thread &thread : threads)
+    {
+        thread.join();
+    }
+    const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    const uint32_t checked = std::min(count, CHECKED_SESSIONS);
+    uint32_t mismatches = 0;
+    for(uint32_t session = 0; session < checked; session++)
+    {
+        Chip8 reference;
+        reference.Seed(session);
+        reference.LoadRom(rom.data(), rom.size());
+        for(uint32_t frame = 0; frame < frames; frame++)
+        {
+            for(int key = 0; key < sizes::numKeys; key++)
+            {
+                reference.keypad[key] = (KeysAt(session, frame) >> key) & 1u;
+            }
+            for(uint32_t i = 0; i < IPS / 60; i++)
+            {
+                reference.Cycle();
+            }
+            reference.UpdateTimers();
+        }
+        const uint64_t hash = schedulers[session % threadCount]->Machine(session / threadCount).StateHash();
+        mismatches += hash != reference.StateHash();
+    }
+
+    uint64_t executed = 0, skipped = 0, waiting = 0;
+    for(const std::unique_ptr<CoroutineScheduler> &scheduler : schedulers)
+    {
+        executed += scheduler->CyclesExecuted();
+        skipped += scheduler->CyclesSkipped();
+        waiting += scheduler->WaitingForKey();
+    }
+    std::cout << "Sessions: " << count << " on " << threadCount << " threads, " << frames << " frames in "
+              << seconds << " s (" << frames / seconds / 60.0 << "x real time)\n";
+    std::cout << "Cycles executed: " << executed << ", skipped while waiting: " << skipped << "\n";
+    std::cout << "Sessions waiting for a key at the end: " << waiting << "\n";
+    if(mismatches)
+    {
+        std::cout << "ERROR: " << mismatches << " of " << checked << " sessions ended in a different state than plain execution\n";
+        return 1;
+    }
+    std::cout << "First " << checked << " sessions match plain execution\n";
+    return 0;
+}
@@ -0,0 +1,260 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include "Args.hpp"
+#include "Chip8.hpp"
+#include "Debugger.hpp"
+#include "Timeline.hpp"
+
+static const char *const HELP =
+    "b addr            break before addr runs        d addr          delete breakpoint\n"
+    "w addr [len]      stop on writes (Fx33/Fx55)    uw addr [len]   stop watching\n"
+    "r x [value]       stop when Vx changes/becomes  rc              clear register conditions\n"
+    "c [frames]        continue (default 600)        s               step\n"
+    "n                 step over CALL                o               step out\n"
+    "l [addr] [count]  disassemble (default PC)      p               registers and call stack\n"
+    "x addr [len]      hex dump                      k key           toggle a keypad key (hex)\n"
+    "i                 list breakpoints              reset           reset the machine\n"
+    "bs [n]            step back n instructions      bc              continue backwards to the last stop\n"
+    "bw addr           back to the last write of addr\n"
+    "q                 quit                          (empty line repeats the last command)\n";
+
+static void PrintPosition(const Chip8 &chip8, const Debugger &debugger, const Timeline &timeline)
+{
+    std::cout << "instruction " << timeline.Instruction() << ", frame " << timeline.Frame() << "\n";
+    debugger.WriteDisassembly(std::cout, chip8.GetPC(), 1);
+}
+
+// Runs until the debugger stops or maxFrames frames have passed. The
+// timeline ticks the timers every IPS / 60 instructions like the window does
+static void Run(Chip8 &chip8, Debugger &debugger, Timeline &timeline, uint64_t maxFrames)
+{
+    const uint64_t lastFrame = timeline.Frame() + maxFrames;
+    while (timeline.Frame() < lastFrame)
+    {
+        timeline.Cycle();
+        if (debugger.Stopped())
+        {
+            std::cout << "Stopped: " << debugger.StopReason() << ", ";
+            PrintPosition(chip8, debugger, timeline);
+            return;
+        }
+    }
+    std::cout << "Still running after " << maxFrames << " frames, ";
+    PrintPosition(chip8, debugger, timeline);
+}
+
+static bool ParseNumber(std::istringstream &in, uint32_t &value)
+{
+    std::string text;
+    if (!(in >> text))
+    {
+        return false;
+    }
+    char *end = nullptr;
+    value = std::strtoul(text.c_str(), &end, 16);
+    if (*end != '\0')
+    {
+        std::cout << "Error: not a hex number: " << text << "\n";
+        return false;
+    }
+    return true;
+}
+
+static void PrintUsage(const char *program)
+{
+    std::cout << "Usage: " << program << " <rom> [--ips n] [--seed n] [--checkpoint n]" << "\n";
+}
+
+// Interactive debugger on stdin: breakpoints, write watchpoints, register
+// conditions, stepping forwards and backwards and disassembly. Numbers are hex
+int main(int argc, char** argv)
+{
+    if(argc < 2)
+    {
+        PrintUsage(argv[0]);
+        return -1;
+    }
+    uint32_t IPS = 600;
+    uint64_t seed = 0;
+    uint32_t interval = 4096;
+    for(int i = 2; i < argc; i++)
+    {
+        if(std::strcmp(argv[i], "--ips") == 0 && i + 1 < argc)
+        {
+            if(!ParseArg(argv[++i], IPS))
+            {
+                PrintUsage(argv[0]);
+                return -1;
+            }
+        }
+        else if(std::strcmp(argv[i], "--seed") == 0 && i + 1 < argc)
+        {
+            if(!ParseArg(argv[++i], seed, 0))
+            {
+                PrintUsage(argv[0]);
+                return -1;
+            }
+        }
+        else if(std::strcmp(argv[i], "--checkpoint") == 0 && i + 1 < argc)
+        {
+            if(!ParseArg(argv[++i], interval))
+            {
+                PrintUsage(argv[0]);
+                return -1;
+            }
+        }
+        else
+        {
+            std::cout << "Unknown option: " << argv[i] << "\n";
+            return -1;
+        }
+    }
+
+    Chip8 chip8;
+    chip8.Seed(seed);
+    if(chip8.LoadRom(argv[1]) < 0)
+    {
+        return -1;
+    }
+    Debugger debugger(chip8);
+    Timeline timeline(chip8, IPS / 60, interval, &debugger);
+    debugger.WriteDisassembly(std::cout, chip8.GetPC(), 1);
+
+    std::string line, last;
+    while(std::cout << "(chip8) " << std::flush, std::getline(std::cin, line))
+    {
+        if(line.empty())
+        {
+            line = last;
+        }
+        last = line;
+        std::istringstream in(line);
+        std::string command;
+        if(!(in >> command))
+        {
+            continue;
+        }
+        uint32_t a = 0, b = 0;
+        if(command == "q")
+        {
+            break;
+        }
+        else if(command == "h" || command == "help")
+        {
+            std::cout << HELP;
+        }
+        else if(command == "b" && ParseNumber(in, a))
+        {
+            debugger.SetBreakpoint(a);
+        }
+        else if(command == "d" && ParseNumber(in, a))
+        {
+            debugger.ClearBreakpoint(a);
+        }
+        else if(command == "w" && ParseNumber(in, a))
+        {
+            debugger.SetWatchpoint(a, ParseNumber(in, b) ? b : 1);
+        }
+        else if(command == "uw" && ParseNumber(in, a))
+        {
+            debugger.ClearWatchpoint(a, ParseNumber(in, b) ? b : 1);
+        }
+        else if(command == "r" && ParseNumber(in, a))
+        {
+            if(ParseNumber(in, b))
+            {
+                debugger.BreakOnValue(a, b);
+            }
+            else
+            {
+                debugger.BreakOnChange(a);
+            }
+        }
+        else if(command == "rc")
+        {
+            debugger.ClearConditions();
+        }
+        else if(command == "c")
+        {
+            uint64_t frames = 600;
+            in >> frames;
+            debugger.Resume(Debugger::CONTINUE);
+            Run(chip8, debugger, timeline, frames);
+        }
+        else if(command == "s" || command == "n" || command == "o")
+        {
+            debugger.Resume(command == "s" ? Debugger::STEP : command == "n" ? Debugger::STEP_OVER : Debugger::STEP_OUT);
+            Run(chip8, debugger, timeline, 600);
+        }
+        else if(command == "l")
+        {
+            a = chip8.GetPC();
+            b = 10;
+            if(ParseNumber(in, a))
+            {
+                ParseNumber(in, b);
+            }
+            debugger.WriteDisassembly(std::cout, a, b);
+        }
+        else if(command == "p")
+        {
+            debugger.WriteState(std::cout);
+        }
+        else if(command == "x" && ParseNumber(in, a))
+        {
+            b = ParseNumber(in, b) ? b : 16;
+            for(uint32_t offset = 0; offset < b; offset++)
+            {
+                const uint16_t address = (a + offset) & 0xFFFu;
+                char text[16];
+                if(offset % 16 == 0)
+                {
+                    std::snprintf(text, sizeof(text), "0x%03X ", address);
+                    std::cout << text;
+                }
+                std::snprintf(text, sizeof(text), " %02X", chip8.Peek(address));
+                std::cout << text << (offset % 16 == 15 || offset + 1 == b ? "\n" : "");
+            }
+        }
+        else if(command == "k" && ParseNumber(in, a))
+        {
+            timeline.SetKey(a & 0xFu, !chip8.keypad[a & 0xFu]);
+            std::cout << "Key " << std::hex << (a & 0xFu) << std::dec << (chip8.keypad[a & 0xFu] ? " down" : " up") << "\n";
+        }
+        else if(command == "i")
+        {
+            debugger.WriteBreakpoints(std::cout);
+            std::cout << timeline.CheckpointCount() << " checkpoints, " << timeline.MemoryUsed() / 1024 << " KB of history\n";
+        }
+        else if(command == "reset")
+        {
+            timeline.Reset();
+            debugger.WriteDisassembly(std::cout, chip8.GetPC(), 1);
+        }
+        else if(command == "bs")
+        {
+            uint64_t count = 1;
+            in >> count;
+            if(!timeline.StepBack(count))
+            {
+                std::cout << "Already at the start\n";
+            }
+            PrintPosition(chip8, debugger, timeline);
+        }
+        else if(command == "bc" || (command == "bw" && ParseNumber(in, a)))
+        {
+            const bool found = command == "bc" ? timeline.ReverseContinue() : timeline.ReverseToWrite(a);
+            std::cout << (found ? "Went back to " : "Nothing earlier, still at ");
+            PrintPosition(chip8, debugger, timeline);
+        }
+        else
+        {
+            std::cout << "Unknown command, h lists them\n";
+        }
+    }
+    return 0;
+}
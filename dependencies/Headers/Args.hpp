@@ -0,0 +1,28 @@
+#ifndef ARGS_HPP
+#define ARGS_HPP
+#include <cctype>
+#include <cerrno>
+#include <cstdlib>
+#include <iostream>
+#include <limits>
+
+// Parses a whole command line argument as a number that fits in T. Unlike
+// std::stoul this never throws, and rejects signs, spaces and trailing
+// characters instead of ignoring them. base 0 also takes 0x hex and 0 octal.
+// Returns false (with a message) if text isn't such a number
+template <typename T>
+bool ParseArg(const char *text, T &value, int base = 10)
+{
+    char *end = nullptr;
+    errno = 0;
+    const unsigned long long parsed = std::isdigit(static_cast<unsigned char>(text[0])) ? std::strtoull(text, &end, base) : 0;
+    if (!end || *end != '\0' || errno == ERANGE ||
+        parsed > static_cast<unsigned long long>(std::numeric_limits<T>::max()))
+    {
+        std::cout << "Error: " << text << " is not a valid number\n";
+        return false;
+    }
+    value = static_cast<T>(parsed);
+    return true;
+}
+#endif
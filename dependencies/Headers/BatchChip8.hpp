@@ -0,0 +1,74 @@
+#ifndef BATCHCHIP8_HPP
+#define BATCHCHIP8_HPP
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "Chip8.hpp"
+
+// Runs many machines of the same ROM in lockstep, one instruction per lane
+// per Step. State is stored as structure of arrays (all V0s together, all PCs
+// together, ...) so when every lane is about to execute the same opcode the
+// instruction is decoded once and applied to all lanes with vector code.
+// When lanes diverge, the ones about to run the same simple opcode (jumps,
+// loads, ALU) are grouped and each group is decoded once, the rest run lane
+// by lane until they meet again.
+// Behaves exactly like Chip8, LaneStateHash matches Chip8::StateHash
+class BatchChip8
+{
+    using byte = uint8_t;
+    using doubleByte = uint16_t;
+    static constexpr doubleByte START_ADDRESS = 0x200;
+
+    uint32_t lanes;
+    std::vector<byte> V;           // V[reg * lanes + lane]
+    std::vector<doubleByte> PC;
+    std::vector<doubleByte> Index;
+    std::vector<byte> SP;
+    std::vector<byte> delayTimer;
+    std::vector<byte> soundTimer;
+    std::vector<doubleByte> stack; // stack[level * lanes + lane]
+    std::vector<uint64_t> rngState;
+    std::vector<uint64_t> rngInitialState;
+    std::vector<byte> memory;      // sizes::memSize bytes per lane, lane after lane
+    std::vector<byte> image;       // Memory right after loading the ROM
+    std::vector<byte> video;       // 1 byte per pixel (0 or 1), lane after lane
+    std::vector<doubleByte> pending; // Divergent steps: fetched opcode of each waiting lane
+    std::vector<uint32_t> waiting;   // Divergent steps: lanes whose opcode has a kernel
+    std::vector<uint32_t> grouped;   // Divergent steps: waiting lanes sharing one opcode
+    bool avx2;
+
+    doubleByte Fetch(uint32_t lane, doubleByte address) const
+    {
+        const byte *mem = &memory[lane * sizes::memSize];
+        return static_cast<doubleByte>((mem[address & 0xFFFu] << 8u) | mem[(address + 1u) & 0xFFFu]);
+    }
+    void ExecuteUniform(doubleByte opcode);
+    // Splits the waiting lanes by opcode and runs each group at once
+    void ExecuteWaiting(uint32_t count);
+    void ExecuteGroup(doubleByte opcode, uint32_t count);
+    void ExecuteLane(uint32_t lane, doubleByte opcode);
+    void Draw(uint32_t lane, byte x, byte y, byte height);
+
+    public:
+    std::vector<byte> keypad;      // keypad[lane * sizes::numKeys + key]
+    uint64_t uniformSteps;         // Steps where every lane ran the same instruction
+    uint64_t divergentSteps;       // Steps executed lane by lane or group by group
+    uint64_t divergentGroups;      // Groups of lanes run together over all divergent steps
+
+    explicit BatchChip8(uint32_t lanes);
+    uint32_t Lanes() const { return lanes; }
+    bool UsesAvx2() const { return avx2; }
+
+    // Same limits and return value as Chip8::LoadRom, loads every lane
+    int LoadRom(const uint8_t *data, size_t size);
+    // seeds holds one seed per lane, seeded like Chip8::Seed
+    void Seed(const uint64_t *seeds);
+    void Reset();
+    // One instruction on every lane
+    void Step();
+    void UpdateTimers();
+
+    bool Pixel(uint32_t lane, int index) const { return video[lane * sizes::VIDEO_WIDTH * sizes::VIDEO_HEIGHT + index]; }
+    uint64_t LaneStateHash(uint32_t lane) const;
+};
+#endif
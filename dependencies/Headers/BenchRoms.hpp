@@ -0,0 +1,31 @@
+#ifndef BENCHROMS_HPP
+#define BENCHROMS_HPP
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Synthetic ROMs for benchmarking and profile training, built in memory so
+// no ROM files are needed.
+//
+// Opcode kernels repeat one instruction (or a CALL/RET pair) many times and
+// jump back, so nearly every cycle executes the instruction under test. Their
+// prologue sets every register to a distinct value, I to 0x800, and splits
+// the machines: one that holds key 0 executes one extra instruction and runs
+// a step behind the others for the rest of the program (BatchChip8 lanes then
+// never meet again, except in kernels that loop on a single instruction).
+//
+// Workloads are small programs that stress one hot path each
+namespace benchroms {
+    struct BenchRom
+    {
+        std::string name;
+        std::string description;
+        std::vector<uint8_t> data;
+        bool selfLoop; // Loops on one instruction, split machines meet again
+    };
+
+    std::vector<BenchRom> OpcodeKernels();
+    // alu, draw, memory and calls
+    std::vector<BenchRom> Workloads();
+}
+#endif
@@ -2,9 +2,18 @@
 #define CHIP8_HPP
 #include <bitset>
 #include <cstdio>
-#include <random>
+#include <cstdint>
 #include <functional>
 #include <string>
+#include <memory>
+#include <vector>
+#include "RomImage.hpp"
+#ifdef CHIP8_TRACK_MEMORY
+#include "MemoryTracker.hpp"
+#endif
+class Debugger;
+class Profiler;
+class MemoryTracker;
 namespace sizes {
     constexpr int numRegisters{16};
     constexpr int memSize{4096};
@@ -14,10 +23,40 @@ namespace sizes {
     constexpr int VIDEO_WIDTH{64};
 }
 
+// Registers, stack and the two address registers, everything the CPU holds
+// outside memory, video, timers and the RNG
+struct Chip8CpuState
+{
+    uint16_t PC;
+    uint16_t Index;
+    uint8_t SP;
+    uint8_t registers[sizes::numRegisters];
+    uint16_t stack[sizes::stackLevels];
+    bool operator==(const Chip8CpuState &other) const = default;
+};
+
+// A whole machine at one instant, see Chip8::Snapshot. Memory pages that
+// still come from the ROM image are kept as a reference to the image, only
+// written pages are copied, and the screen is packed to one bit per pixel,
+// so a snapshot is usually well under a kilobyte
+struct Chip8Snapshot
+{
+    Chip8CpuState cpu;
+    uint8_t delayTimer;
+    uint8_t soundTimer;
+    uint8_t screenUpdate;
+    uint8_t keypad[sizes::numKeys];
+    uint64_t rngState;
+    uint8_t video[sizes::VIDEO_WIDTH * sizes::VIDEO_HEIGHT / 8];
+    std::shared_ptr<const RomImage> image;
+    uint16_t writtenPages; // Bit p set: page p is the next pageSize bytes of pages
+    std::vector<uint8_t> pages;
+};
+
 class Chip8 {
     using byte = uint8_t;
     using doubleByte = uint16_t;
-    const doubleByte START_ADDRESS = 0x200;
+    static constexpr doubleByte START_ADDRESS = 0x200;
     doubleByte Index; // Index Register
     doubleByte PC; // Program Counter
     byte SP; // Stack Pointer
@@ -26,18 +65,32 @@ class Chip8 {
     doubleByte IP; // Instruction Pointer - Opcode
     doubleByte stack[sizes::stackLevels];
     byte registers[sizes::numRegisters]; // 16 8 bit registers - Stack Allocated
-    byte* memory; // Addressable locations 4096 - Heap Allocated
+    // Addressable locations 4096, split into pages. Pages are read from the
+    // shared ROM image until the first write copies them into ownPages
+    const byte* readPages[sizes::numPages];
+    byte* ownPages[sizes::numPages]; // Private copies, allocated on first write
+    bool externalPages; // ownPages point into storage handed to the constructor
+    std::shared_ptr<const RomImage> image; // Memory right after loading the ROM
 
     public:
     byte screenUpdate;
     byte keypad[sizes::numKeys];
-    uint32_t* video;
+    uint32_t video[sizes::VIDEO_WIDTH * sizes::VIDEO_HEIGHT];
 
     private:
-    std::mt19937 mt;
-    std::uniform_int_distribution<uint8_t> rand;
+    uint64_t rngState; // PCG32 state, restored from rngInitialState on Reset
+    uint64_t rngInitialState;
+    uint64_t rngSeed;
+    Profiler *profiler; // Only fed in builds with CHIP8_PROFILE
+    Debugger *debugger;
+    const std::bitset<sizes::memSize> *breakpoints; // Set while only breakpoints are armed
+    #ifdef CHIP8_TRACK_MEMORY
+    MemoryTracker memoryAccess;
+    #endif
 
     void OP_NULL();
+    void OP_TRAP(); // Every entry of trapTable, runs the opcode between debugger checks
+    void OP_BREAK(); // Every entry of breakTable, traps only on breakpoint addresses
     void OP_00E0(); // CLS
     void OP_00EE(); // RET
     void OP_1nnn(); // JP nnn
@@ -75,6 +128,31 @@ class Chip8 {
 
 
     // Helpers
+    byte ReadMemory(doubleByte address) const
+    {
+        return readPages[(address >> 8u) & 0xFu][address & 0xFFu];
+    }
+    // Reads made by instructions (Dxyn, Fx65), tracked unlike fetches and Peek
+    byte LoadMemory(doubleByte address)
+    {
+        #ifdef CHIP8_TRACK_MEMORY
+        memoryAccess.Read(address);
+        #endif
+        return ReadMemory(address);
+    }
+    void WriteMemory(doubleByte address, byte value)
+    {
+        #ifdef CHIP8_TRACK_MEMORY
+        memoryAccess.Written(address);
+        #endif
+        const int page = (address >> 8u) & 0xFu;
+        if (readPages[page] != ownPages[page])
+        {
+            copyPage(page);
+        }
+        ownPages[page][address & 0xFFu] = value;
+    }
+    void copyPage(int page);
     byte D_Opd_00x0();
     byte D_Opd_000x();
     byte D_Opd_0x00();
@@ -83,29 +161,95 @@ class Chip8 {
     byte D_Opd_00xx();
     byte D_Opd_0xx0();
     doubleByte D_Opd_0xxx();
-    void initFuncPointerTable();
+    static void initFuncPointerTable();
     void printState();
     void printByte(byte x);
+    void dumpRom();
+    bool checkRomSize(size_t size);
+    byte NextRandom();
 
-    // Function Pointer Table
+    // Function Pointer Table, shared by all instances
     typedef void (Chip8::*Chip8func)();
     // using Chip8func = std::function<void(Chip8*)>;
-    Chip8func table[0xF + 1];
-    Chip8func table0[0xE + 1];
-    Chip8func table8[0xE + 1];
-    Chip8func tableE[0xE + 1];
-    Chip8func tableF[0x65 + 1];
+    static Chip8func table[0xF + 1];
+    // Sized for every index the opcode can produce, unused entries are OP_NULL
+    static Chip8func table0[0xF + 1];
+    static Chip8func table8[0xF + 1];
+    static Chip8func tableE[0xF + 1];
+    static Chip8func tableF[0xFF + 1];
+    static Chip8func trapTable[0xF + 1];
+    static Chip8func breakTable[0xF + 1];
+    const Chip8func *dispatch; // table, or trapTable/breakTable while a debugger is attached
     void Table0();
     void Table8();
     void TableE();
     void TableF();
 
     public:
-    Chip8();
+    // pageStorage (sizes::memSize bytes) is used for the private copies of
+    // written pages instead of heap allocations, see Chip8Pool
+    explicit Chip8(uint8_t *pageStorage = nullptr);
+    Chip8(const Chip8 &) = delete;
+    Chip8 &operator=(const Chip8 &) = delete;
     void Reset(bool shouldLoadRom = false, std::string filename = "");
+    void Seed(uint64_t seed);
+    uint64_t GetSeed() const;
+    uint64_t RomHash() const;
+    uint64_t StateHash() const;
+    // Read only access for tools (reward probes, debuggers, ...)
+    uint8_t Peek(uint16_t address) const { return ReadMemory(address); }
+    uint8_t PeekRegister(int index) const { return registers[index & 0xF]; }
+    uint16_t GetPC() const { return PC; }
+    uint8_t GetSP() const { return SP; }
+    static constexpr uint16_t StartAddress() { return START_ADDRESS; }
+    // Memory right after LoadRom, shared by every machine running the ROM
+    std::shared_ptr<const RomImage> Image() const { return image; }
+    Chip8CpuState GetCpuState() const;
+    // Debugger writes. Poke goes through copy on write like Fx55 does
+    void Poke(uint16_t address, uint8_t value) { WriteMemory(address & 0xFFFu, value); }
+    void SetCpuState(const Chip8CpuState &state);
+    void SetTimers(uint8_t delay, uint8_t sound) { delayTimer = delay; soundTimer = sound; }
+    // Restore puts back everything Snapshot saved (the seed, an attached
+    // profiler or debugger stay as they are)
+    void Snapshot(Chip8Snapshot &snapshot) const;
+    void Restore(const Chip8Snapshot &snapshot);
+    uint8_t GetDelayTimer() const { return delayTimer; }
+    uint8_t GetSoundTimer() const { return soundTimer; }
+    bool TimersRunning() const { return delayTimer > 0 || soundTimer > 0; }
+    // True when the machine can make no progress until a key is pressed:
+    // waiting in LD Vx, K (Fx0A) or jumping to itself. Only the timers change
+    bool Idle() const;
     bool UpdateTimers();
-    int LoadRom(const char *filename);
+    // Loading builds the reset image and resets the machine to it.
+    // Both return the ROM size in bytes, or -1 (with a message) if the ROM
+    // can't be read or doesn't fit between START_ADDRESS and the end of memory
+    int LoadRom(const char *filename, bool dumpRom = false);
+    int LoadRom(const uint8_t *data, size_t size, bool dumpRom = false);
     void Cycle();
+    // Every following Cycle is recorded in profiler (nullptr detaches).
+    // Without CHIP8_PROFILE nothing is recorded, see ProfilerBuilt
+    void AttachProfiler(Profiler *profiler) { this->profiler = profiler; }
+    static bool ProfilerBuilt();
+    // Routes every following Cycle through debugger (nullptr detaches and
+    // restores the plain dispatch). With breakpoints only the instructions
+    // at the addresses set in it go through debugger, the rest run at full
+    // speed. Debugger attaches itself only while it has something to stop for
+    void AttachDebugger(Debugger *debugger, const std::bitset<sizes::memSize> *breakpoints = nullptr)
+    {
+        this->debugger = debugger;
+        this->breakpoints = breakpoints;
+        dispatch = !debugger ? table : breakpoints ? breakTable : trapTable;
+    }
+    // Which addresses were executed, read and written since construction
+    // (or MemoryTracker::Clear). nullptr without CHIP8_TRACK_MEMORY
+    MemoryTracker *MemoryAccess()
+    {
+        #ifdef CHIP8_TRACK_MEMORY
+        return &memoryAccess;
+        #else
+        return nullptr;
+        #endif
+    }
     ~Chip8();
 };
 #endif
\ No newline at end of file
@@ -0,0 +1,80 @@
+#ifndef CHIP8ENV_HPP
+#define CHIP8ENV_HPP
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <vector>
+#include "Chip8.hpp"
+#include "Chip8Pool.hpp"
+#include "FrameCodec.hpp"
+#include "ThreadPool.hpp"
+
+struct Chip8EnvConfig
+{
+    uint32_t numEnvs = 1;
+    uint32_t cyclesPerFrame = 10; // IPS / 60
+    uint32_t frameskip = 4;       // Frames emulated per Step, the action is held for all of them
+    uint32_t maxSteps = 27000;    // Steps before an episode is truncated
+    uint32_t threads = 0;         // 0 = one per core
+    // Read by the user supplied probes. score is turned into a reward by
+    // taking the difference between steps, gameOver ends the episode. Both
+    // are called from the worker threads
+    std::function<float(const Chip8 &)> score;
+    std::function<bool(const Chip8 &)> gameOver;
+};
+
+// Batch of environments over one ROM with a gym style interface. Every
+// environment is a Chip8 from a Chip8Pool, stepped in parallel.
+//
+// Observations are zero copy: Frame(i) points straight at the machine's
+// framebuffer, or SetObservationBuffer makes Step write each frame packed to
+// 1 bit per pixel (256 bytes, row major, MSB first) into its slot of one
+// caller provided contiguous buffer
+class Chip8Env
+{
+    Chip8EnvConfig config;
+    Chip8Pool pool;
+    ThreadPool threads;
+    std::vector<Chip8 *> machines;
+    std::vector<float> lastScore;
+    std::vector<uint32_t> steps;
+    std::vector<float> rewards;
+    std::vector<uint8_t> terminated;
+    std::vector<uint8_t> truncated;
+    uint8_t *observations;
+
+    void ResetEnv(uint32_t env, uint64_t seed);
+    void StepEnv(uint32_t env, uint16_t action);
+    void PackFrame(uint32_t env);
+
+    explicit Chip8Env(const Chip8EnvConfig &config);
+
+    public:
+    static constexpr size_t PACKED_FRAME_SIZE = framecodec::PACKED_SIZE;
+
+    // Returns nullptr (with a message) for a config without environments
+    static std::unique_ptr<Chip8Env> Create(const Chip8EnvConfig &config);
+    Chip8Env(const Chip8Env &) = delete;
+    Chip8Env &operator=(const Chip8Env &) = delete;
+    // Returns false if the ROM is invalid
+    bool LoadRom(const uint8_t *data, size_t size);
+    // buffer must hold NumEnvs() * PACKED_FRAME_SIZE bytes, nullptr turns it off
+    void SetObservationBuffer(uint8_t *buffer);
+
+    // seeds holds one seed per environment
+    void Reset(const uint64_t *seeds);
+    void Reset(uint32_t env, uint64_t seed);
+    // actions holds one keypad bit mask per environment (bit k = key k held).
+    // Finished environments are skipped until they are reset
+    void Step(const uint16_t *actions);
+
+    uint32_t NumEnvs() const { return config.numEnvs; }
+    const uint32_t *Frame(uint32_t env) const { return machines[env]->video; }
+    const Chip8 &Machine(uint32_t env) const { return *machines[env]; }
+    const float *Rewards() const { return rewards.data(); }
+    const uint8_t *Terminated() const { return terminated.data(); }
+    const uint8_t *Truncated() const { return truncated.data(); }
+    bool Done(uint32_t env) const { return terminated[env] || truncated[env]; }
+};
+#endif
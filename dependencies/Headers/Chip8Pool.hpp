@@ -0,0 +1,59 @@
+#ifndef CHIP8POOL_HPP
+#define CHIP8POOL_HPP
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "Chip8.hpp"
+
+// Fixed number of Chip8 machines placed in one contiguous arena. Each slot
+// holds the page storage used for copy on write followed by the Chip8
+// itself, so acquiring a machine never touches the general purpose heap.
+//
+// Not thread safe: Acquire and Release change the free list without any
+// locking, callers sharing a pool between threads must serialize them
+class Chip8Pool
+{
+    uint8_t *arena;
+    size_t arenaSize;
+    size_t slotSize;
+    uint32_t capacity;
+    uint32_t liveCount;
+    std::vector<uint32_t> freeSlots; // Stack of free slot indices
+    std::vector<uint8_t> live;       // 1 for slots holding a machine
+
+    uint8_t *SlotPages(uint32_t slot) const { return arena + slot * slotSize; }
+    Chip8 *SlotMachine(uint32_t slot) const
+    {
+        return reinterpret_cast<Chip8 *>(arena + slot * slotSize + sizes::memSize);
+    }
+
+    public:
+    // A capacity of 0 maps nothing and hands out no machines
+    explicit Chip8Pool(uint32_t capacity);
+    Chip8Pool(const Chip8Pool &) = delete;
+    Chip8Pool &operator=(const Chip8Pool &) = delete;
+    ~Chip8Pool();
+
+    // O(1). Returns nullptr when every slot is in use
+    Chip8 *Acquire();
+    // O(1). machine must come from this pool
+    void Release(Chip8 *machine);
+
+    uint32_t Capacity() const { return capacity; }
+    uint32_t LiveCount() const { return liveCount; }
+    size_t SlotSize() const { return slotSize; }
+
+    // Visits live machines in address order
+    template <typename Func>
+    void ForEach(Func func)
+    {
+        for (uint32_t slot = 0; slot < capacity; slot++)
+        {
+            if (live[slot])
+            {
+                func(*SlotMachine(slot));
+            }
+        }
+    }
+};
+#endif
@@ -0,0 +1,104 @@
+#ifndef COROUTINESCHEDULER_HPP
+#define COROUTINESCHEDULER_HPP
+#include <coroutine>
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include "Chip8.hpp"
+#include "Chip8Pool.hpp"
+
+// Runs sessions as C++20 coroutines on the calling thread. Each session
+// runs one frame per Tick (60 Hz) and then co_awaits the next event:
+//  - the next timer tick, or
+//  - a keypad change, when it can't progress without one and its timers
+//    are stopped. Such a session costs nothing until PressKeys, which only
+//    replays how far into its loop the skipped frames would have got it.
+// Within a frame, a session that spins (Fx0A without a key, or a loop that
+// returns to the same CPU state without touching memory, video, timers or
+// the RNG, like a delay timer wait) skips the rest of its cycles. Only the
+// remainder of a whole number of loop iterations is executed, so the machine
+// ends the frame in exactly the state plain Cycle() calls would produce.
+// Use one scheduler per thread
+class CoroutineScheduler
+{
+    struct Session;
+
+    struct SessionTask
+    {
+        struct promise_type
+        {
+            SessionTask get_return_object() { return SessionTask{std::coroutine_handle<promise_type>::from_promise(*this)}; }
+            std::suspend_always initial_suspend() noexcept { return {}; }
+            std::suspend_always final_suspend() noexcept { return {}; }
+            void return_void() {}
+            void unhandled_exception() { throw; }
+        };
+        std::coroutine_handle<promise_type> handle;
+    };
+
+    struct TickEvent
+    {
+        CoroutineScheduler *scheduler;
+        Session *session;
+        bool await_ready() const noexcept { return false; }
+        void await_suspend(std::coroutine_handle<> handle);
+        void await_resume() const noexcept {}
+    };
+
+    struct KeyEvent
+    {
+        CoroutineScheduler *scheduler;
+        Session *session;
+        bool await_ready() const noexcept { return false; }
+        void await_suspend(std::coroutine_handle<> handle);
+        void await_resume() const noexcept {}
+    };
+
+    struct Session
+    {
+        Chip8 *machine;
+        uint32_t cyclesPerFrame;
+        uint16_t pendingKeys;
+        uint16_t appliedKeys;
+        bool spinning;
+        bool waitingForKey;
+        uint64_t parkedAt;   // First tick not yet caught up while waiting for a key
+        uint32_t loopLength; // Cycles per iteration of the loop it spins in
+        std::coroutine_handle<> resume;
+        SessionTask task;
+        uint64_t cyclesExecuted;
+        uint64_t cyclesSkipped;
+    };
+
+    Chip8Pool pool;
+    std::vector<std::unique_ptr<Session>> sessions;
+    std::vector<Session *> tickWaiters;
+    std::vector<Session *> running; // tickWaiters of the tick being processed
+    uint32_t keyWaiters;
+    uint64_t ticks;
+
+    SessionTask SessionBody(Session *session);
+    bool RunFrame(Session &session);
+    void CatchUp(Session &session);
+
+    public:
+    explicit CoroutineScheduler(uint32_t capacity);
+    CoroutineScheduler(const CoroutineScheduler &) = delete;
+    CoroutineScheduler &operator=(const CoroutineScheduler &) = delete;
+    ~CoroutineScheduler();
+
+    // Returns the session id, or -1 if the ROM is invalid, IPS is below one
+    // instruction per frame (60) or there is no room
+    int AddSession(const uint8_t *rom, size_t size, uint32_t IPS, uint64_t seed);
+    // Applied at the start of the session's next frame, wakes it if needed
+    void PressKeys(int session, uint16_t keys);
+    // One 60 Hz frame for every session that is not waiting for a key
+    void Tick();
+
+    // Brings a session that waits for a key up to the current tick first
+    const Chip8 &Machine(int session);
+    uint32_t WaitingForKey() const { return keyWaiters; }
+    uint64_t CyclesExecuted() const;
+    uint64_t CyclesSkipped() const;
+};
+#endif
@@ -0,0 +1,111 @@
+#ifndef DEBUGGER_HPP
+#define DEBUGGER_HPP
+#include <bitset>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+#include "Chip8.hpp"
+
+// Breakpoints, watchpoints and stepping for one Chip8. The machine runs its
+// normal dispatch table until something is set; then the debugger swaps in
+// a table whose every entry traps into BeforeInstruction/AfterInstruction,
+// and swaps the normal one back once nothing is left. With only breakpoints
+// set, the table checks the address against them and traps just there.
+// A machine without breakpoints, watchpoints, conditions or a step in
+// progress pays nothing.
+//
+// Drive the machine with Chip8::Cycle as usual and test Stopped() after
+// each one. A breakpoint stops before its instruction runs (PC is left on
+// it), a watchpoint or register condition right after the instruction that
+// triggered it
+class Debugger
+{
+    public:
+    enum Mode
+    {
+        CONTINUE,
+        STEP,      // Stop before the next instruction
+        STEP_OVER, // Like STEP, but a CALL runs until it returns
+        STEP_OUT   // Stop once the current subroutine returned
+    };
+    enum StopKind
+    {
+        NOT_STOPPED,
+        BREAKPOINT,
+        WATCHPOINT, // StopAddress() is the address written
+        REGISTER,
+        STEPPED
+    };
+
+    private:
+    struct RegisterCondition
+    {
+        uint8_t reg;
+        bool anyChange; // Otherwise: stop when it becomes value
+        uint8_t value;
+    };
+
+    Chip8 &chip8;
+    std::bitset<sizes::memSize> breakpoints;
+    std::bitset<sizes::memSize> watchpoints; // Written by Fx33 or Fx55
+    std::vector<RegisterCondition> conditions;
+    uint8_t registersBefore[sizes::numRegisters];
+    Mode mode;
+    bool skipNext;      // The first trap after resuming doesn't stop, if it is at resumedAt
+    uint16_t resumedAt; // PC when resuming
+    uint16_t stepUntil; // STEP_OVER: return address of the CALL being stepped over
+    uint8_t stepDepth;  // SP the step started at
+    StopKind stopKind;
+    uint16_t stopAddress;
+    std::string stopReason;
+
+    void Stop(StopKind kind, const std::string &reason, uint16_t address = 0);
+
+    public:
+    explicit Debugger(Chip8 &chip8);
+    Debugger(const Debugger &) = delete;
+    Debugger &operator=(const Debugger &) = delete;
+    ~Debugger();
+
+    void SetBreakpoint(uint16_t address);
+    void ClearBreakpoint(uint16_t address);
+    bool IsBreakpoint(uint16_t address) const { return breakpoints[address & 0xFFFu]; }
+    // Stop after any instruction that writes one of [address, address + length)
+    void SetWatchpoint(uint16_t address, uint16_t length = 1);
+    void ClearWatchpoint(uint16_t address, uint16_t length = 1);
+    // Stop after Vreg changed, or after it became value
+    void BreakOnChange(uint8_t reg);
+    void BreakOnValue(uint8_t reg, uint8_t value);
+    void ClearConditions();
+    void ClearAll();
+    // Lists breakpoints, watched ranges and conditions
+    void WriteBreakpoints(std::ostream &out) const;
+
+    // Resumes in mode: clears the stop, lets the instruction at PC run even
+    // if it has a breakpoint, then Cycle until Stopped(). STEP_OUT at the
+    // top level (SP 0) behaves like STEP
+    void Resume(Mode mode = CONTINUE);
+    // Forgets the last stop without moving past it, a breakpoint at PC
+    // stops again
+    void ClearStop();
+    // Re-attaches the trap table when anything is set, e.g. after replaying
+    // with the debugger detached (Chip8::AttachDebugger(nullptr))
+    void Arm();
+    bool Stopped() const { return stopKind != NOT_STOPPED; }
+    // Breakpoints and steps stop before the instruction at PC ran
+    bool StoppedBefore() const { return stopKind == BREAKPOINT || stopKind == STEPPED; }
+    StopKind Kind() const { return stopKind; }
+    uint16_t StopAddress() const { return stopAddress; }
+    const std::string &StopReason() const { return stopReason; }
+
+    // count instructions from address, "> " marks PC and "* " breakpoints
+    void WriteDisassembly(std::ostream &out, uint16_t address, int count) const;
+    // PC, I, SP, registers, timers and the call stack
+    void WriteState(std::ostream &out) const;
+
+    // Called by the trap table, true stops the machine before the opcode
+    bool BeforeInstruction(uint16_t address, uint16_t opcode);
+    void AfterInstruction(uint16_t address, uint16_t opcode, uint16_t indexBefore);
+};
+#endif
@@ -0,0 +1,26 @@
+#ifndef DISASSEMBLER_HPP
+#define DISASSEMBLER_HPP
+#include <cstdint>
+#include <string>
+
+// Opcode classes and mnemonics as Chip8 dispatches them: the tables only
+// look at some nibbles, so e.g. 0x0120 runs CLS and 0xE5F1 runs SKNP.
+// Anything that ends up in OP_NULL is UNDECODED
+namespace disasm {
+    enum OpcodeClass : uint8_t
+    {
+        OPC_00E0, OPC_00EE, OPC_1nnn, OPC_2nnn, OPC_3xkk, OPC_4xkk, OPC_5xy0, OPC_6xkk,
+        OPC_7xkk, OPC_8xy0, OPC_8xy1, OPC_8xy2, OPC_8xy3, OPC_8xy4, OPC_8xy5, OPC_8xy6,
+        OPC_8xy7, OPC_8xyE, OPC_9xy0, OPC_Annn, OPC_Bnnn, OPC_Cxkk, OPC_Dxyn, OPC_Ex9E,
+        OPC_ExA1, OPC_Fx07, OPC_Fx0A, OPC_Fx15, OPC_Fx18, OPC_Fx1E, OPC_Fx29, OPC_Fx33,
+        OPC_Fx55, OPC_Fx65, OPC_UNDECODED,
+        NUM_OPCODE_CLASSES
+    };
+
+    OpcodeClass Classify(uint16_t opcode);
+    // "8xy4", "Fx55", ..., "????" for UNDECODED
+    const char *ClassName(OpcodeClass opcodeClass);
+    // "ADD V3, V4", "JP 0x2A4", ..., "DW 0x0123" for undecoded words
+    std::string Disassemble(uint16_t opcode);
+}
+#endif
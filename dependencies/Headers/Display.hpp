@@ -1,8 +1,14 @@
 #ifndef DISPLAY_HPP
 #define DISPLAY_HPP
+#include <atomic>
 #include <string>
 #include "SDL2/SDL.h"
 #include "Chip8.hpp"
+#include "FrameRing.hpp"
+#include "InputLatency.hpp"
+#include "Movie.hpp"
+#include "Telemetry.hpp"
+#include "VideoRecorder.hpp"
 class Color
 {
     public:
@@ -14,9 +20,18 @@ class Options
 public:
     Color bgColor, fgColor;
     std::string romFile;
+    std::string recordFile; // Record keypad input to this movie file
+    std::string playFile;   // Feed keypad input from this movie file
+    std::string shmName;    // Publish every frame to this shared memory ring
+    std::string videoFile;  // Record the screen to this file, see vidconvert
     int scaleFactor;
     uint32_t IPS;
     uint32_t toneFreq;
+    bool dumpRom; // Print the ROM as hex while loading it
+    uint64_t seed; // Seed for RND (Cxkk), the same seed replays the same random numbers
+    uint32_t statsInterval; // Print a telemetry line every this many seconds and a report on exit, 0 = off
+    bool overlay; // Start with the telemetry overlay shown, F1 toggles it
+    bool latency; // Measure key press to screen latency and report it on exit
     Options(uint32_t bgColor = 0x000000ff, uint32_t fgColor = 0xffffffff, uint32_t IPS = 500, 
             uint32_t toneFreq = 440);
 };
@@ -35,11 +50,32 @@ class Display
     uint32_t sampleRate;
     int16_t volume;
     SDL_AudioDeviceID devId;
+    Movie movie;
+    uint32_t frame; // Emulated frames executed so far, used to tag movie events
+    size_t movieCursor;
+    bool recording;
+    bool playing;
+    FrameRingWriter frameRing;
+    VideoRecorder videoRecorder;
+    Telemetry telemetry;
+    uint64_t lastFrameStart;  // 0 after a pause, the next frame time is not recorded
+    uint64_t nextStatsTick;   // Once per second: achieved IPS, title, stats line
+    uint32_t statsTicks;
+    double achievedIPS;
+    std::atomic<uint64_t> lastAudioCallback; // Written by the audio thread, 0 while paused
+    uint64_t audioBufferNs;
+    bool audioPlaying;
+    static constexpr int OVERLAY_FRAMES = 128;
+    uint64_t recentFrameNs[OVERLAY_FRAMES]; // Frame times drawn by the overlay
+    int recentFrame;
+    InputLatency inputLatency;
 
     static void audioCallback(void* userdata, Uint8* stream, int len);
     void RenderAudio(Uint8* stream, int len);
     void ProcessInput();
     void Render();
+    void DrawOverlay();
+    void UpdateStats(uint64_t now);
     void ClearScreen();
 public:
     Display(Options options);
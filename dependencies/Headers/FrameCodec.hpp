@@ -0,0 +1,25 @@
+#ifndef FRAMECODEC_HPP
+#define FRAMECODEC_HPP
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "Chip8.hpp"
+
+// Frames packed to one bit per pixel (row major, MSB first) and deltas
+// between them. A delta is the XOR of two packed frames with its runs of
+// zero bytes collapsed, so unchanged areas cost almost nothing:
+//   control < 0x80: control + 1 literal bytes follow
+//   control >= 0x80: control - 0x7F zero bytes
+// A keyframe is a delta against an all black frame
+namespace framecodec {
+    constexpr size_t PACKED_SIZE = sizes::VIDEO_WIDTH * sizes::VIDEO_HEIGHT / 8;
+
+    void Pack(const uint32_t *video, uint8_t *packed);
+    void Unpack(const uint8_t *packed, uint32_t *video, uint32_t onColour = 0xFFFFFFFF);
+
+    // Appends the delta from previous to current to out
+    void EncodeDelta(const uint8_t *previous, const uint8_t *current, std::vector<uint8_t> &out);
+    // XORs a delta into frame. Returns false if it is malformed
+    bool ApplyDelta(const uint8_t *delta, size_t size, uint8_t *frame);
+}
+#endif
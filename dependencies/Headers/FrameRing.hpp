@@ -0,0 +1,89 @@
+#ifndef FRAMERING_HPP
+#define FRAMERING_HPP
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include "Chip8.hpp"
+#include "FrameCodec.hpp"
+
+// One published frame: the screen (framecodec::Pack layout) and the machine
+// state after it
+struct FrameRecord
+{
+    uint64_t frame;       // Emulated frame number, counts from 0
+    uint64_t timeNs;      // steady_clock time of publishing
+    Chip8CpuState cpu;
+    uint8_t delayTimer;
+    uint8_t soundTimer;
+    uint16_t keys;        // Bit k = key k held
+    uint8_t screen[framecodec::PACKED_SIZE];
+};
+
+// Layout of the shared memory object. The writer never waits for readers:
+// every slot is a seqlock, its sequence is odd while the slot is written
+namespace framering {
+    constexpr char MAGIC[4] = {'C', '8', 'F', 'R'};
+    constexpr uint32_t VERSION = 1;
+
+    struct alignas(64) Slot
+    {
+        std::atomic<uint64_t> sequence;
+        FrameRecord record;
+    };
+
+    struct alignas(64) Header
+    {
+        char magic[4];
+        uint32_t version;
+        uint32_t slotCount;
+        uint32_t slotSize;
+        std::atomic<uint64_t> published; // Frames written so far
+    };
+}
+
+// Publishes every completed frame into a POSIX shared memory ring named
+// name (shm_open rules, e.g. "/chip8"). Publishing is a few stores and a
+// 256 byte copy, no syscalls
+class FrameRingWriter
+{
+    std::string name;
+    framering::Header *header;
+    framering::Slot *slots;
+    size_t mappedSize;
+
+    public:
+    FrameRingWriter();
+    FrameRingWriter(const FrameRingWriter &) = delete;
+    FrameRingWriter &operator=(const FrameRingWriter &) = delete;
+    ~FrameRingWriter(); // Unlinks the shared memory object
+
+    bool Create(const std::string &name, uint32_t slotCount = 64);
+    bool IsOpen() const { return header != nullptr; }
+    void Publish(const Chip8 &chip8, uint64_t frame);
+};
+
+// Maps a ring read only. Reads copy out of the mapping directly, a reader
+// that is lapped by the writer just misses frames
+class FrameRingReader
+{
+    const framering::Header *header;
+    const framering::Slot *slots;
+    size_t mappedSize;
+
+    public:
+    FrameRingReader();
+    FrameRingReader(const FrameRingReader &) = delete;
+    FrameRingReader &operator=(const FrameRingReader &) = delete;
+    ~FrameRingReader();
+
+    bool Open(const std::string &name);
+    // Number of frames published so far
+    uint64_t Published() const;
+    // Copies frame index (0 based publish order) into out. False if it was
+    // not published yet or has already been overwritten
+    bool Read(uint64_t index, FrameRecord &out) const;
+    // Copies the newest frame, false if there is none yet
+    bool ReadLatest(FrameRecord &out) const;
+};
+#endif
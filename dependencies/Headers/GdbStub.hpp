@@ -0,0 +1,70 @@
+#ifndef GDBSTUB_HPP
+#define GDBSTUB_HPP
+#include <cstdint>
+#include <string>
+#include "Chip8.hpp"
+#include "Debugger.hpp"
+#include "Timeline.hpp"
+
+// GDB remote serial protocol server for one Chip8, one client at a time.
+// Registers are V0-VF, I, PC, SP, DT and ST, described to the client by
+// target.xml (qXfer:features:read); memory is the 4 KB address space.
+// Supports software breakpoints (Z0/z0), write watchpoints (Z2/z2, on
+// Fx33/Fx55), step, continue, reverse step and continue (bs/bc, through a
+// Timeline), Ctrl-C, register and memory reads and writes.
+//
+// The emulation loop calls Poll once per frame and, while Running(), Cycle
+// instead of Chip8::Cycle: breakpoints and stepping trap through Debugger,
+// so a running target only costs one test per instruction on top of the
+// timeline. Packets are only read in Poll. The target starts halted
+class GdbStub
+{
+    Chip8 &chip8;
+    Debugger debugger;
+    Timeline timeline;
+    int listenFd;
+    int fd; // The client, -1 while waiting for one
+    std::string unixPath;
+    std::string inbox;
+    bool noAck;
+    bool swbreak; // The client understands swbreak stop reasons
+    bool running;
+
+    void Accept();
+    bool Read();
+    void Handle(const std::string &packet);
+    void Send(const std::string &payload);
+    void SendRaw(const std::string &bytes);
+    void ReportStop();
+    void Disconnect();
+    std::string StopReply() const;
+    std::string ReadRegisters() const;
+    bool WriteRegisters(const std::string &hex);
+    std::string ReadRegister(int reg) const;
+    bool WriteRegister(int reg, const std::string &hex);
+
+    public:
+    // chip8 must have its ROM loaded, cyclesPerFrame paces the timers
+    GdbStub(Chip8 &chip8, uint32_t cyclesPerFrame);
+    GdbStub(const GdbStub &) = delete;
+    GdbStub &operator=(const GdbStub &) = delete;
+    ~GdbStub();
+
+    // address is a UNIX socket path or a port on 127.0.0.1, like stream
+    bool Listen(const std::string &address);
+    // Accepts a client and answers its packets. While halted waits up to
+    // timeoutMs for one to arrive, so a halted target doesn't spin
+    void Poll(int timeoutMs);
+    bool Running() const { return running; }
+    bool Connected() const { return fd >= 0; }
+    void Cycle()
+    {
+        timeline.Cycle();
+        if (debugger.Stopped())
+        {
+            ReportStop();
+        }
+    }
+    uint64_t Instruction() const { return timeline.Instruction(); }
+};
+#endif
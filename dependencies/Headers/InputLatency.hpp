@@ -0,0 +1,60 @@
+#ifndef INPUTLATENCY_HPP
+#define INPUTLATENCY_HPP
+#include <cstdint>
+#include <ostream>
+#include "Chip8.hpp"
+#include "Telemetry.hpp"
+
+// Follows one key press at a time from the frontend to the screen:
+// the SDL_KEYDOWN, the first instruction that reads that key (SKP/SKNP with
+// the key in Vx, or LD Vx, K while it is held), the first DRW after that
+// and the present that shows it. Each stage gets its own histogram. Presses
+// arriving while one is in flight are not measured, a press stuck in one
+// stage for a second is dropped
+class InputLatency
+{
+    enum Stage
+    {
+        IDLE,
+        PRESSED,
+        READ,
+        DRAWN
+    };
+    static constexpr uint64_t GIVE_UP_NS = 1000000000u;
+    Stage stage;
+    uint8_t key;
+    uint64_t pressedAt;
+    uint64_t readAt;
+    uint64_t drawnAt;
+
+    public:
+    LatencyHistogram toRead;    // Key down to the instruction reading it
+    LatencyHistogram toDraw;    // Read to the next DRW
+    LatencyHistogram toPresent; // DRW to SDL_RenderPresent returning
+    LatencyHistogram total;     // Key down to present
+    uint64_t overlapped;        // Presses ignored, another was in flight
+    uint64_t unread;            // Presses no instruction read in time
+    uint64_t undrawn;           // Presses read but not drawn in time
+    uint64_t unpresented;       // Presses drawn but not presented in time
+
+    InputLatency();
+
+    void KeyDown(uint8_t key, uint64_t now);
+    // Before every Cycle, looks at the instruction about to run. Only
+    // decodes it while a press is in flight
+    void BeforeCycle(const Chip8 &chip8)
+    {
+        if (stage == PRESSED || stage == READ)
+        {
+            Inspect(chip8);
+        }
+    }
+    void Presented(uint64_t now);
+    // A reset loses whatever the ROM was about to do with the key
+    void Cancel() { stage = IDLE; }
+    void WriteReport(std::ostream &out) const;
+
+    private:
+    void Inspect(const Chip8 &chip8);
+};
+#endif
@@ -0,0 +1,64 @@
+#ifndef MEMORYTRACKER_HPP
+#define MEMORYTRACKER_HPP
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include "RomImage.hpp"
+
+// One bit per address for each kind of access to Chip8 memory: executed
+// (fetched as an opcode), read (Dxyn, Fx65) and written (Fx33, Fx55). Every
+// access costs a single OR. Chip8 only carries a tracker in builds with
+// CHIP8_TRACK_MEMORY (make TRACK_MEMORY=1), see Chip8::MemoryAccess
+class MemoryTracker
+{
+    static constexpr int WORDS = sizes::numPages * sizes::pageSize / 64;
+    uint64_t executed[WORDS];
+    uint64_t read[WORDS];
+    uint64_t written[WORDS];
+
+    static bool Test(const uint64_t *bits, uint16_t address)
+    {
+        address &= 0xFFFu;
+        return (bits[address >> 6u] >> (address & 63u)) & 1u;
+    }
+    static void Set(uint64_t *bits, uint16_t address)
+    {
+        address &= 0xFFFu;
+        bits[address >> 6u] |= uint64_t{1} << (address & 63u);
+    }
+
+    public:
+    // What a page (sizes::pageSize bytes) was used for
+    enum PageKind
+    {
+        UNUSED,
+        CODE,           // Only executed, safe to predecode
+        DATA,           // Only read or written
+        MIXED,          // Executed and read, e.g. sprites between routines
+        SELF_MODIFYING  // Some executed address was also written
+    };
+
+    MemoryTracker() { Clear(); }
+    void Clear();
+
+    void Executed(uint16_t address) { Set(executed, address); }
+    void Read(uint16_t address) { Set(read, address); }
+    void Written(uint16_t address) { Set(written, address); }
+
+    bool WasExecuted(uint16_t address) const { return Test(executed, address); }
+    bool WasRead(uint16_t address) const { return Test(read, address); }
+    bool WasWritten(uint16_t address) const { return Test(written, address); }
+
+    PageKind Page(int page) const;
+    // True when any address was both executed and written
+    bool SelfModifying() const;
+
+    // 64 rows of 64 addresses, one character each, with a legend
+    void WriteHeatmap(std::ostream &out) const;
+    // Accesses per page
+    void WritePageSummary(std::ostream &out) const;
+    // 64x64 pixels (scale x scale each) PPM image, red = written,
+    // green = executed, blue = read. Returns false with a message on failure
+    bool WriteImage(const std::string &filename, int scale = 8) const;
+};
+#endif
@@ -0,0 +1,46 @@
+#ifndef MOVIE_HPP
+#define MOVIE_HPP
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "Chip8.hpp"
+#include "Trace.hpp"
+
+// One keypad transition (or machine reset) that happened before the given
+// emulated frame was executed
+struct MovieEvent
+{
+    uint32_t frame;
+    uint8_t key;     // Keypad index 0x0 - 0xF, ignored for resets
+    uint8_t pressed;
+    uint8_t reset;
+};
+
+class Movie
+{
+public:
+    uint64_t romHash;
+    uint64_t seed;
+    uint64_t finalHash; // Chip8::StateHash() after the last frame, 0 if unknown
+    uint32_t IPS;
+    uint32_t frameCount;
+    uint8_t quirks; // Quirk profile, 0 = original CHIP-8 (the only one implemented)
+    std::vector<MovieEvent> events;
+
+    Movie();
+    void Begin(const Chip8 &chip8, uint32_t IPS);
+    void RecordKey(uint32_t frame, uint8_t key, bool pressed);
+    void RecordReset(uint32_t frame);
+    void End(const Chip8 &chip8, uint32_t frameCount);
+
+    bool Save(const std::string &filename) const;
+    bool Load(const std::string &filename);
+
+    // Feeds every event tagged with frame into chip8, starting at event index
+    // next. Returns the index of the first event belonging to a later frame
+    size_t ApplyEvents(Chip8 &chip8, uint32_t frame, size_t next) const;
+    // Runs the whole movie without a frontend as fast as possible and returns
+    // the final state hash. With a trace every instruction is recorded
+    uint64_t PlayHeadless(Chip8 &chip8, TraceWriter *trace = nullptr) const;
+};
+#endif
@@ -0,0 +1,71 @@
+#ifndef PROFILER_HPP
+#define PROFILER_HPP
+#include <cstdint>
+#include <ostream>
+#include <unordered_map>
+#include <vector>
+#include "Chip8.hpp"
+#include "Disassembler.hpp"
+
+// Counts what a Chip8 executes: instructions per opcode class, per address
+// and per call stack, CALL edges and opcodes that fell through to OP_NULL.
+// Chip8::Cycle only feeds an attached profiler in builds with CHIP8_PROFILE
+// (make PROFILE=1), other builds don't even test for one.
+//
+// Call stacks are tracked from CALL and RET alone, a frame is named after
+// the address it was called at ("sub_2A4", the bottom one is "main")
+class Profiler
+{
+    struct StackNode
+    {
+        uint32_t parent;
+        uint16_t function;
+        uint32_t depth;
+        uint64_t instructions; // Executed while this was the innermost frame
+    };
+
+    struct Undecoded
+    {
+        uint64_t count;
+        uint16_t firstPC;
+    };
+
+    uint64_t instructions;
+    uint64_t pcCounts[sizes::memSize];
+    uint16_t pcOpcodes[sizes::memSize]; // Last opcode executed at each address
+    uint64_t classCounts[disasm::NUM_OPCODE_CLASSES];
+    std::unordered_map<uint16_t, Undecoded> undecoded;
+    std::unordered_map<uint32_t, uint64_t> callEdges; // call site << 16 | target
+    std::vector<StackNode> nodes;                     // nodes[0] is main
+    std::unordered_map<uint64_t, uint32_t> children;  // parent << 16 | function
+    uint32_t current;
+    uint64_t unmatchedReturns;
+
+    void WriteStack(std::ostream &out, uint32_t node) const;
+
+    public:
+    Profiler();
+    void Clear();
+
+    // Called by Chip8 before it executes opcode from pc
+    void Record(uint16_t pc, uint16_t opcode);
+    // Called by Chip8::Reset, the call stack starts over at main
+    void OnReset() { current = 0; }
+
+    uint64_t Instructions() const { return instructions; }
+    uint64_t ClassCount(disasm::OpcodeClass opcodeClass) const { return classCounts[opcodeClass]; }
+    uint64_t AddressCount(uint16_t address) const { return pcCounts[address & 0xFFFu]; }
+
+    // Instructions per opcode class, most executed first
+    void WriteOpcodeClasses(std::ostream &out) const;
+    // The top most executed addresses with their disassembly
+    void WriteHotSpots(std::ostream &out, size_t top = 20) const;
+    // Call site -> target edges with how often they were taken
+    void WriteCallGraph(std::ostream &out) const;
+    // Opcodes that ran as OP_NULL, with where each was first seen
+    void WriteUndecoded(std::ostream &out) const;
+    // One "main;sub_2A4;sub_300 count" line per call stack, the input of
+    // flamegraph.pl and speedscope
+    void WriteCollapsedStacks(std::ostream &out) const;
+};
+#endif
@@ -0,0 +1,28 @@
+#ifndef RANDOM_HPP
+#define RANDOM_HPP
+#include <cstdint>
+
+// PCG32 (XSH RR) with a fixed stream. The whole generator is one uint64_t,
+// so it can live inside machine state and be copied with it
+namespace pcg32 {
+    inline uint8_t Next(uint64_t &state)
+    {
+        // Uses the low byte of each 32 bit output
+        const uint64_t oldState = state;
+        state = oldState * 6364136223846793005ULL + 1442695040888963407ULL;
+        const uint32_t xorShifted = static_cast<uint32_t>(((oldState >> 18u) ^ oldState) >> 27u);
+        const uint32_t rot = static_cast<uint32_t>(oldState >> 59u);
+        return static_cast<uint8_t>((xorShifted >> rot) | (xorShifted << ((32u - rot) & 31u)));
+    }
+
+    // Standard PCG32 seeding, returns the state to start the sequence from
+    inline uint64_t InitialState(uint64_t seed)
+    {
+        uint64_t state = 0u;
+        Next(state);
+        state += seed;
+        Next(state);
+        return state;
+    }
+}
+#endif
@@ -0,0 +1,156 @@
+#ifndef ROMANALYSIS_HPP
+#define ROMANALYSIS_HPP
+#include <cstdint>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
+#include "Chip8.hpp"
+
+// Static analysis of a ROM image as LoadRom leaves it: recursive descent
+// from the start address through 1nnn, 2nnn (assumed to return), the skips
+// and 00EE, decoding opcodes the way Chip8 dispatches them. Recovers basic
+// blocks and the control flow graph between them, and on top of that lists
+// what can't be followed statically (Bnnn), the ROM bytes never reached as
+// code, writes that land on code, and guesses which quirk profile the ROM
+// was written for.
+//
+// Everything is conservative in one direction only: code found is reachable
+// (unless a skip is never taken), but code reached through Bnnn or written
+// at run time is missing, see Indirect and SelfModifying
+class RomAnalysis
+{
+    public:
+    enum EdgeKind : uint8_t
+    {
+        NEXT, // Falling through, including a skip not taken and returning from a call
+        JUMP, // 1nnn
+        CALL, // 2nnn
+        SKIP  // Skip taken, to the instruction after next
+    };
+
+    struct Edge
+    {
+        uint16_t from; // Start of the source block
+        uint16_t to;
+        EdgeKind kind;
+    };
+
+    struct BasicBlock
+    {
+        uint16_t start;
+        uint16_t end; // One past the last instruction
+        uint16_t last; // Address of the last instruction
+    };
+
+    // Address ranges of the ROM no instruction was found in
+    struct DataRange
+    {
+        uint16_t start;
+        uint16_t end;
+        bool referenced; // Some LD I, nnn points into it, e.g. sprites
+    };
+
+    // Interpreters disagree on these, a ROM only works on the right ones
+    enum Quirk
+    {
+        QUIRK_SHIFT,      // 8xy6/8xyE: CHIP-8 shifts Vy into Vx, SCHIP shifts Vx
+        QUIRK_LOAD_STORE, // Fx55/Fx65: CHIP-8 leaves I past the last register
+        QUIRK_JUMP,       // Bnnn: CHIP-8 adds V0, SCHIP (Bxnn) adds Vx
+        NUM_QUIRKS
+    };
+
+    enum Profile
+    {
+        ANY,   // No evidence either way
+        CHIP8, // The original COSMAC VIP interpreter
+        SCHIP  // CHIP-48 / SUPER-CHIP
+    };
+
+    enum Modification
+    {
+        NONE,     // Every write has a known address and none of them is code
+        POSSIBLE, // Some Fx33/Fx55 write through an I that isn't a known constant
+        CERTAIN   // A write with a known address lands on code
+    };
+
+    // Analyses the image chip8 loaded. One analysis per ROM, shared while
+    // anything holds it, like RomImage
+    static std::shared_ptr<const RomAnalysis> Get(const Chip8 &chip8);
+
+    RomAnalysis(std::shared_ptr<const RomImage> image, uint16_t romAddress);
+
+    uint64_t RomHash() const { return image->RomHash(); }
+    // An instruction starts at address
+    bool IsCode(uint16_t address) const { return flags[address & 0xFFFu] & CODE; }
+    // The instruction at address shares a byte with another one found
+    bool Overlaps(uint16_t address) const { return flags[address & 0xFFFu] & OVERLAP; }
+    // The block containing the instruction at address, nullptr if it isn't code
+    const BasicBlock *BlockAt(uint16_t address) const;
+    const std::vector<BasicBlock> &Blocks() const { return blocks; }
+    const std::vector<Edge> &Edges() const { return edges; }
+    const std::vector<uint16_t> &Functions() const { return functions; }   // 2nnn targets
+    const std::vector<uint16_t> &Indirect() const { return indirect; }     // Bnnn addresses
+    const std::vector<uint16_t> &Undecoded() const { return undecoded; }   // Run as no-ops by Chip8
+    const std::vector<uint16_t> &LeavesRom() const { return leavesRom; }   // Control flow out of the ROM
+    const std::vector<DataRange> &Data() const { return data; }
+
+    Modification SelfModifying() const;
+    // Writer and written address of every write known to land on code
+    const std::vector<std::pair<uint16_t, uint16_t>> &CodeWrites() const { return codeWrites; }
+
+    // Instructions suggesting the ROM expects a quirk the CHIP-8 (first) or
+    // SCHIP (second) way
+    std::pair<uint32_t, uint32_t> Evidence(Quirk quirk) const { return {votes[quirk][0], votes[quirk][1]}; }
+    // SCHIP only opcodes (scrolling, hires, big font, flags), Chip8 runs them as no-ops
+    uint32_t SchipOpcodes() const { return schipOpcodes; }
+    Profile GuessProfile() const;
+    static const char *ProfileName(Profile profile);
+    static const char *QuirkName(Quirk quirk);
+
+    void WriteSummary(std::ostream &out) const;
+    // Every block with its disassembly and successors, data ranges as hex
+    void WriteListing(std::ostream &out) const;
+    // Graphviz CFG, one node per block. Returns false with a message on failure
+    bool WriteDot(const std::string &filename) const;
+
+    private:
+    enum Flag : uint8_t
+    {
+        CODE = 1,
+        LEADER = 2,
+        OVERLAP = 4,
+        DATA_REF = 8
+    };
+
+    std::shared_ptr<const RomImage> image;
+    uint16_t romStart;
+    uint16_t romEnd;
+    uint8_t flags[sizes::memSize];
+    uint16_t blockIndex[sizes::memSize]; // Block of the instruction at each address
+    std::vector<BasicBlock> blocks; // Ascending
+    std::vector<Edge> edges;
+    std::vector<uint16_t> functions;
+    std::vector<uint16_t> indirect;
+    std::vector<uint16_t> undecoded;
+    std::vector<uint16_t> leavesRom;
+    std::vector<DataRange> data;
+    std::vector<std::pair<uint16_t, uint16_t>> codeWrites;
+    uint32_t unresolvedWrites;
+    uint32_t votes[NUM_QUIRKS][2];
+    uint32_t schipOpcodes;
+
+    uint8_t Byte(uint16_t address) const;
+    uint16_t Opcode(uint16_t address) const { return static_cast<uint16_t>(Byte(address) << 8u | Byte(address + 1)); }
+    bool InRom(uint16_t address) const { return address >= romStart && address + 1 < romEnd; }
+    void Traverse();
+    void BuildBlocks();
+    // I after running block when entered with index (-1 for not constant)
+    int32_t IndexAfter(const BasicBlock &block, int32_t index) const;
+    // I each block is entered with, -1 where it isn't a known constant
+    void PropagateIndex(std::vector<int32_t> &entry) const;
+    void ScanBlocks();
+    void FindData();
+};
+#endif
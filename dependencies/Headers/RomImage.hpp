@@ -0,0 +1,34 @@
+#ifndef ROMIMAGE_HPP
+#define ROMIMAGE_HPP
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+namespace sizes {
+    constexpr int pageSize{256};
+    constexpr int numPages{4096 / pageSize};
+}
+
+uint64_t Fnv1a(const void *data, size_t size, uint64_t hash = 14695981039346656037ULL);
+
+// Read only memory contents of a machine right after loading a ROM (fontset +
+// ROM). Every Chip8 running the same ROM shares one image and maps its pages
+// until it writes to them
+class RomImage
+{
+    using byte = uint8_t;
+    alignas(64) byte data[sizes::pageSize * sizes::numPages];
+    uint64_t romHash;
+    size_t romSize;
+
+    public:
+    RomImage(const byte *rom, size_t size, uint16_t romAddress);
+    const byte *Page(int page) const { return data + page * sizes::pageSize; }
+    uint64_t RomHash() const { return romHash; }
+    size_t RomSize() const { return romSize; }
+
+    // Returns the image for this ROM, shared with every other caller that
+    // asked for the same bytes while it is still in use
+    static std::shared_ptr<const RomImage> Get(const byte *rom, size_t size, uint16_t romAddress);
+};
+#endif
@@ -0,0 +1,116 @@
+#ifndef SESSIONSCHEDULER_HPP
+#define SESSIONSCHEDULER_HPP
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "Chip8.hpp"
+#include "Chip8Pool.hpp"
+
+struct SessionStats
+{
+    uint64_t frames;        // Frames executed
+    uint64_t idleFrames;    // Frames where only the timers were updated
+    uint64_t missed;        // Frames that finished after their deadline or were dropped
+    double maxLatenessMs;   // Worst finish time past a deadline
+    bool parked;
+};
+
+// Hosts many Chip8 sessions in one process. Each session emulates 60 frames
+// per second at its own IPS; one frame (IPS / 60 cycles + UpdateTimers) is
+// one task. Frames waiting for their release time share one timer heap;
+// once released they move to the ready heap (earliest deadline first) of the
+// worker that last ran them. A worker with nothing ready steals the most
+// urgent ready task of another worker.
+//
+// Workers with nothing to do sleep on one shared condition and are only
+// woken when a session becomes ready. One of them at a time waits for the
+// earliest release and moves due frames to the ready heaps.
+//
+// Sessions that can't progress without input (Chip8::Idle) stop executing
+// cycles; once their timers run out they are parked and cost nothing until
+// SetKeys changes their keypad
+class SessionScheduler
+{
+    using clock = std::chrono::steady_clock;
+
+    struct Session
+    {
+        Chip8 *machine;
+        uint32_t cyclesPerFrame;
+        uint32_t home;                // Worker that queues this session
+        clock::time_point release;    // When the next frame may start
+        std::atomic<uint16_t> keys;   // Written by SetKeys, applied at frame start
+        uint16_t appliedKeys;
+        std::atomic<bool> parked;
+        bool idle;
+        std::atomic<uint64_t> frames;
+        std::atomic<uint64_t> idleFrames;
+        std::atomic<uint64_t> missed;
+        std::atomic<int64_t> maxLatenessUs;
+    };
+
+    struct Worker
+    {
+        std::mutex lock;
+        std::vector<Session *> ready;       // Heap, earliest deadline on top
+        std::atomic<uint32_t> readyCount;   // Size of ready, read without the lock
+    };
+
+    Chip8Pool pool;
+    std::mutex sessionsLock;
+    std::vector<std::unique_ptr<Session>> sessions;
+    std::vector<std::unique_ptr<Worker>> workers;
+    std::vector<std::thread> threads;
+    std::atomic<bool> running;
+    std::atomic<uint64_t> steals;
+
+    std::mutex timerLock;                  // Guards sleeping and timekeeper, taken before any Worker::lock
+    std::condition_variable idleWake;      // Idle workers wait here for a ready session
+    std::condition_variable timerWake;     // The timekeeper waits here for the earliest release
+    std::vector<Session *> sleeping;       // Heap, earliest release on top
+    std::atomic<clock::rep> nextRelease;   // Release of sleeping.front(), max if empty
+    std::atomic<uint32_t> readyTotal;      // Sessions in all ready heaps
+    std::atomic<uint32_t> idleWorkers;
+    bool timekeeper;
+
+    static clock::duration FramePeriod();
+    static bool ReleaseLater(const Session *a, const Session *b) { return a->release > b->release; }
+    void Enqueue(Session *session, clock::time_point release);
+    // Returns true if an idle worker should be woken for it
+    bool MakeReady(Session *session);
+    void WakeIdle();
+    // Caller holds timerLock
+    void PromoteDue(clock::time_point now);
+    Session *TakeReady(uint32_t self);
+    void Park();
+    void RunFrame(Session *session);
+    void WorkerLoop(uint32_t self);
+
+    public:
+    // capacity is the maximum number of sessions, threads == 0 uses every core
+    SessionScheduler(uint32_t capacity, uint32_t threads = 0);
+    SessionScheduler(const SessionScheduler &) = delete;
+    SessionScheduler &operator=(const SessionScheduler &) = delete;
+    ~SessionScheduler();
+
+    // Returns the session id, or -1 if the ROM is invalid, IPS is below one
+    // instruction per frame (60) or there is no room. Can be called while running
+    int AddSession(const uint8_t *rom, size_t size, uint32_t IPS, uint64_t seed);
+    // Thread safe, bit k = key k held. Ignored for an unknown session id
+    void SetKeys(int session, uint16_t keys);
+
+    void Start();
+    void Stop();
+
+    uint32_t Threads() const { return static_cast<uint32_t>(workers.size()); }
+    uint64_t Steals() const { return steals; }
+    // All zero for an unknown session id
+    SessionStats Stats(int session);
+    uint32_t SessionCount();
+};
+#endif
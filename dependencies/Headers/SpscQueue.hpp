@@ -0,0 +1,70 @@
+#ifndef SPSCQUEUE_HPP
+#define SPSCQUEUE_HPP
+#include <atomic>
+#include <cstddef>
+#include <vector>
+
+// Bounded lock free queue for exactly one producer thread and one consumer
+// thread. Neither side ever blocks or makes a syscall; each keeps a cached
+// copy of the other side's index so the shared cache lines are only read
+// when the queue looks full or empty
+template <typename T>
+class SpscQueue
+{
+    std::vector<T> items;
+    size_t mask;
+    alignas(64) std::atomic<size_t> head; // Next item to pop, written by the consumer
+    alignas(64) std::atomic<size_t> tail; // Next free slot, written by the producer
+    alignas(64) size_t cachedHead;        // Producer's view of head
+    alignas(64) size_t cachedTail;        // Consumer's view of tail
+
+    public:
+    // capacity is rounded up to a power of two
+    explicit SpscQueue(size_t capacity) : head{0}, tail{0}, cachedHead{0}, cachedTail{0}
+    {
+        size_t size = 1;
+        while (size < capacity)
+        {
+            size <<= 1u;
+        }
+        items.resize(size);
+        mask = size - 1;
+    }
+    SpscQueue(const SpscQueue &) = delete;
+    SpscQueue &operator=(const SpscQueue &) = delete;
+
+    // Producer only. Returns false when the queue is full
+    bool TryPush(const T &item)
+    {
+        const size_t position = tail.load(std::memory_order_relaxed);
+        if (position - cachedHead > mask)
+        {
+            cachedHead = head.load(std::memory_order_acquire);
+            if (position - cachedHead > mask)
+            {
+                return false;
+            }
+        }
+        items[position & mask] = item;
+        tail.store(position + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer only. Returns false when the queue is empty
+    bool TryPop(T &item)
+    {
+        const size_t position = head.load(std::memory_order_relaxed);
+        if (position == cachedTail)
+        {
+            cachedTail = tail.load(std::memory_order_acquire);
+            if (position == cachedTail)
+            {
+                return false;
+            }
+        }
+        item = items[position & mask];
+        head.store(position + 1, std::memory_order_release);
+        return true;
+    }
+};
+#endif
@@ -0,0 +1,106 @@
+#ifndef STREAM_HPP
+#define STREAM_HPP
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "Chip8.hpp"
+#include "FrameCodec.hpp"
+
+// Wire protocol between StreamServer and StreamClient. Every message is
+//   type u8 | payload length u16 LE | payload
+namespace stream {
+    constexpr uint8_t MSG_KEYFRAME = 'K'; // Server to viewer, framecodec keyframe
+    constexpr uint8_t MSG_DELTA = 'D';    // Server to viewer, delta to the previous frame
+    constexpr uint8_t MSG_KEYS = 'k';     // Viewer to server, u16 LE keypad mask (bit k = key k)
+    constexpr size_t HEADER_SIZE = 3;
+
+    // address is either a UNIX socket path or a port number, which uses TCP
+    // on 127.0.0.1. Both return a non blocking socket, or -1 on error
+    int Listen(const std::string &address);
+    int Connect(const std::string &address);
+}
+
+// Publishes the screen of one machine to any number of viewers. Each frame
+// is encoded once and the same bytes are queued for every viewer. A viewer
+// that can't keep up skips deltas and gets a keyframe once its backlog has
+// drained, so it never slows down emulation or the other viewers. Viewers
+// send their keypad back; the machine sees the OR of all of them.
+// Nothing here blocks, call Poll and Publish from the emulation loop
+class StreamServer
+{
+    struct Viewer
+    {
+        int fd;
+        std::vector<uint8_t> outbox;
+        size_t sent;
+        std::vector<uint8_t> inbox;
+        uint16_t keys;
+        bool needsKeyframe;
+    };
+
+    int listenFd;
+    std::string unixPath;
+    std::vector<Viewer> viewers;
+    uint8_t lastFrame[framecodec::PACKED_SIZE];
+    std::vector<uint8_t> delta;
+    std::vector<uint8_t> keyframe; // Empty until a viewer needs it for lastFrame
+    uint64_t bytesSent;
+    uint64_t framesPublished;
+
+    void Accept();
+    bool Read(Viewer &viewer);
+    bool Flush(Viewer &viewer);
+    void Close(Viewer &viewer);
+
+    public:
+    StreamServer();
+    StreamServer(const StreamServer &) = delete;
+    StreamServer &operator=(const StreamServer &) = delete;
+    ~StreamServer();
+
+    bool Listen(const std::string &address);
+    // Accepts new viewers, reads keypad messages and sends what is queued
+    void Poll();
+    // Queues the screen for every viewer when screenUpdate is set and the
+    // picture changed
+    void Publish(const Chip8 &chip8);
+    uint16_t Keys() const;
+    void ApplyKeys(Chip8 &chip8) const;
+
+    size_t ViewerCount() const { return viewers.size(); }
+    uint64_t BytesSent() const { return bytesSent; }
+    uint64_t FramesPublished() const { return framesPublished; }
+};
+
+// Receives the frames of a StreamServer and sends keypad changes back
+class StreamClient
+{
+    int fd;
+    std::vector<uint8_t> inbox;
+    std::vector<uint8_t> outbox; // A keys message, sent across Polls if the socket is full
+    size_t sent;
+    uint8_t frame[framecodec::PACKED_SIZE];
+    uint16_t keys;
+    bool keysChanged;
+    uint64_t bytesReceived;
+
+    public:
+    StreamClient();
+    StreamClient(const StreamClient &) = delete;
+    StreamClient &operator=(const StreamClient &) = delete;
+    ~StreamClient();
+
+    bool Connect(const std::string &address);
+    // Sends the keypad if it changed and decodes every complete message.
+    // Returns the number of frames received, or -1 once the server is gone
+    int Poll();
+    // Key changes between two Polls go out as one message
+    void SetKeys(uint16_t newKeys);
+
+    int Fd() const { return fd; }
+    uint16_t Keys() const { return keys; }
+    const uint8_t *Frame() const { return frame; }
+    uint64_t BytesReceived() const { return bytesReceived; }
+};
+#endif
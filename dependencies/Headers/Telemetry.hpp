@@ -0,0 +1,81 @@
+#ifndef TELEMETRY_HPP
+#define TELEMETRY_HPP
+#include <atomic>
+#include <cstdint>
+#include <ostream>
+#include <string>
+
+// Histogram of durations in nanoseconds with HDR style log-linear buckets:
+// every power of two is split into 32 linear sub-buckets, so any recorded
+// value is reported within ~3% from 1 ns to 2^41 ns (about 36.6 minutes).
+// Recording is a few relaxed atomic adds, one thread may record while
+// others read
+class LatencyHistogram
+{
+    static constexpr int SUB_BITS = 5;
+    static constexpr int SUB_BUCKETS = 1 << SUB_BITS;
+    static constexpr int OCTAVES = 41 - SUB_BITS;
+    static constexpr int BUCKETS = SUB_BUCKETS + OCTAVES * SUB_BUCKETS;
+
+    std::atomic<uint64_t> counts[BUCKETS];
+    std::atomic<uint64_t> count;
+    std::atomic<uint64_t> sum;
+    std::atomic<uint64_t> max;
+
+    static int BucketOf(uint64_t value);
+    static uint64_t BucketTop(int bucket);
+
+    public:
+    LatencyHistogram();
+    LatencyHistogram(const LatencyHistogram &) = delete;
+    LatencyHistogram &operator=(const LatencyHistogram &) = delete;
+
+    void Record(uint64_t ns);
+    // Not safe against concurrent Record calls
+    void Reset();
+
+    uint64_t Count() const { return count.load(std::memory_order_relaxed); }
+    uint64_t Max() const { return max.load(std::memory_order_relaxed); }
+    double Mean() const;
+    // Smallest bucket bound that at least fraction (0.5, 0.99, 0.999) of the
+    // values are below, 0 when empty
+    uint64_t Percentile(double fraction) const;
+};
+
+// Everything a frontend measures about its frame loop. The frame loop
+// records frames, Cycle and render times and how late sleeps woke up; the
+// audio callback (another thread) records the gaps between its calls and
+// counts underruns, gaps so long the device must have run dry
+class Telemetry
+{
+    uint64_t windowStart;        // StatsLine window, main thread only
+    uint64_t windowInstructions;
+
+    public:
+    LatencyHistogram frameTime;      // Start of one frame to the next
+    LatencyHistogram cycleTime;      // Running the frame's Cycle() calls
+    LatencyHistogram renderTime;     // Drawing and presenting, when the screen changed
+    LatencyHistogram sleepOvershoot; // How much longer than requested a sleep took
+    LatencyHistogram audioGap;       // Between audio callbacks while playing
+    std::atomic<uint64_t> frames;
+    std::atomic<uint64_t> instructions;
+    std::atomic<uint64_t> audioUnderruns;
+    uint32_t targetIPS;
+
+    explicit Telemetry(uint32_t targetIPS = 0);
+
+    // steady_clock in nanoseconds
+    static uint64_t Now();
+
+    void AddFrame(uint64_t cycles) { frames.fetch_add(1, std::memory_order_relaxed); instructions.fetch_add(cycles, std::memory_order_relaxed); }
+    // bufferNs is how long one callback's buffer plays for
+    void AudioCallback(uint64_t gapNs, uint64_t bufferNs);
+
+    // Achieved IPS since the previous call (or construction)
+    double WindowIPS();
+    // "IPS 600/600 | frame p50 16.67 p99 17.10 p999 18.02 ms | cycle p99 ..."
+    std::string StatsLine(double achievedIPS) const;
+    // Count, mean, p50, p99, p999 and max of every histogram
+    void WriteReport(std::ostream &out) const;
+};
+#endif
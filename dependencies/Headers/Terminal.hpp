@@ -0,0 +1,66 @@
+#ifndef TERMINAL_HPP
+#define TERMINAL_HPP
+#include <cstdint>
+#include <string>
+#include <termios.h>
+#include "Chip8.hpp"
+
+// Draws the screen on an ANSI terminal, two pixel rows per character cell
+// with the Unicode half blocks. Only cells that changed since the last
+// frame are sent, each run of changed cells behind one cursor move, and a
+// frame goes out in a single write()
+class TerminalRenderer
+{
+    static constexpr int ROWS = sizes::VIDEO_HEIGHT / 2;
+    static constexpr int COLUMNS = sizes::VIDEO_WIDTH;
+
+    uint8_t cells[ROWS * COLUMNS]; // Bit 0 top pixel, bit 1 bottom pixel, 0xFF unknown
+    std::string buffer;
+    int fd;
+    bool started;
+
+    public:
+    explicit TerminalRenderer(int fd = 1);
+    TerminalRenderer(const TerminalRenderer &) = delete;
+    TerminalRenderer &operator=(const TerminalRenderer &) = delete;
+    ~TerminalRenderer(); // Shows the cursor again below the picture
+
+    // Returns the number of bytes written
+    size_t Render(const uint32_t *video, bool beep = false);
+    // The next Render redraws every cell
+    void Invalidate();
+    // Writes text on the line below the picture
+    void Status(const std::string &text);
+};
+
+// Reads the keyboard from stdin in raw mode, with the same layout as the
+// window (1234 / qwer / asdf / zxcv). Terminals only report presses, so a
+// key counts as held until HOLD_FRAMES frames pass without another press
+// or auto repeat of it
+class TerminalInput
+{
+    static constexpr int HOLD_FRAMES = 30;
+
+    termios saved;
+    bool raw;
+    uint16_t holdFrames[sizes::numKeys];
+
+    public:
+    enum Command
+    {
+        NONE,
+        QUIT,  // Esc or Ctrl-C
+        PAUSE, // Space
+        RESET  // '='
+    };
+
+    TerminalInput();
+    TerminalInput(const TerminalInput &) = delete;
+    TerminalInput &operator=(const TerminalInput &) = delete;
+    ~TerminalInput(); // Restores the terminal mode
+
+    // Call once per frame. Reads everything pending without blocking and
+    // updates the keypad
+    Command Poll(Chip8 &chip8);
+};
+#endif
@@ -0,0 +1,40 @@
+#ifndef THREADPOOL_HPP
+#define THREADPOOL_HPP
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed set of worker threads for data parallel loops. ParallelFor hands out
+// indices from a shared counter, so uneven work per index still balances
+class ThreadPool
+{
+    std::vector<std::thread> workers;
+    std::mutex lock;
+    std::condition_variable wake;
+    std::condition_variable finished;
+    const std::function<void(uint32_t)> *job;
+    uint32_t jobSize;
+    std::atomic<uint32_t> nextIndex;
+    uint32_t doneWorkers; // Workers finished with the current generation
+    uint64_t generation;
+    bool stopping;
+
+    void WorkerLoop();
+    void RunJob();
+
+    public:
+    // threads == 0 uses one thread per core. The calling thread also works
+    explicit ThreadPool(uint32_t threads = 0);
+    ThreadPool(const ThreadPool &) = delete;
+    ThreadPool &operator=(const ThreadPool &) = delete;
+    ~ThreadPool();
+
+    uint32_t Threads() const { return static_cast<uint32_t>(workers.size()) + 1; }
+    // Calls func(i) for every i in [0, count) and returns when all are done
+    void ParallelFor(uint32_t count, const std::function<void(uint32_t)> &func);
+};
+#endif
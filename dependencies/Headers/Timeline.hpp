@@ -0,0 +1,88 @@
+#ifndef TIMELINE_HPP
+#define TIMELINE_HPP
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "Chip8.hpp"
+#include "Debugger.hpp"
+
+// Time travel for one Chip8: runs it instruction by instruction with the
+// frame clock (a timer tick every cyclesPerFrame instructions), logs every
+// keypad change and reset against the instruction count it happened at and
+// keeps a snapshot every interval instructions. Execution is deterministic
+// (PCG32 state is part of the snapshot), so any earlier instruction is
+// reached by restoring the checkpoint before it and replaying at most
+// interval instructions with the logged input.
+//
+// Going back and then changing input drops the recorded future; going back
+// and running forward replays it, including the input
+class Timeline
+{
+    struct Checkpoint
+    {
+        uint64_t instruction;
+        size_t nextEvent; // Events before this index are already in state
+        Chip8Snapshot state;
+    };
+
+    struct InputEvent
+    {
+        uint64_t instruction; // Applied before this instruction runs
+        uint8_t key;
+        uint8_t pressed;
+        uint8_t reset;
+    };
+
+    enum Search
+    {
+        DEBUGGER_STOPS,
+        WRITES
+    };
+
+    Chip8 &chip8;
+    Debugger *debugger; // Stops are honoured and searched for, may be nullptr
+    uint32_t cyclesPerFrame;
+    uint32_t interval;
+    std::vector<Checkpoint> checkpoints; // Ascending, the first is instruction 0
+    std::vector<InputEvent> events;      // Ascending
+    uint64_t instruction;                // Executed so far
+    size_t nextEvent;
+
+    void ApplyEvents();
+    void Log(const InputEvent &event);
+    // Restores the checkpoint at or before target and replays up to it
+    // without the debugger
+    void ReplayTo(uint64_t target);
+    // Replays checkpoint intervals backwards from the current instruction
+    // and goes to the latest earlier instruction matching search
+    bool SearchBack(Search search, uint16_t address);
+
+    public:
+    // chip8 must already have its ROM loaded, it is checkpointed right away
+    Timeline(Chip8 &chip8, uint32_t cyclesPerFrame, uint32_t interval = 4096, Debugger *debugger = nullptr);
+
+    // Runs one instruction (unless the debugger stops before it)
+    void Cycle();
+    void SetKey(uint8_t key, bool pressed);
+    void Reset();
+    // Forgets everything recorded after the current instruction, e.g. before
+    // a debugger edits registers or memory. Edits themselves are not logged,
+    // going back past one undoes it
+    void DiscardFuture();
+
+    uint64_t Instruction() const { return instruction; }
+    uint64_t Frame() const { return instruction / cyclesPerFrame; }
+
+    // Goes back count instructions (to 0 at most). False when already at 0
+    bool StepBack(uint64_t count = 1);
+    // Goes back to the latest earlier point where the debugger would have
+    // stopped: before a breakpoint, after a watched write or register change
+    bool ReverseContinue();
+    // Goes back to the latest earlier Fx33/Fx55 that wrote address, left
+    // before it runs
+    bool ReverseToWrite(uint16_t address);
+
+    size_t CheckpointCount() const { return checkpoints.size(); }
+    size_t MemoryUsed() const;
+};
+#endif
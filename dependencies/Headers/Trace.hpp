@@ -0,0 +1,79 @@
+#ifndef TRACE_HPP
+#define TRACE_HPP
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include "Chip8.hpp"
+
+// Binary execution traces: a header, then one fixed size record per
+// instruction with the machine state right before it ran. All fields are
+// little endian, so traces from any two builds compare byte for byte
+//   header: "C8TR" | version u16 | record size u16 | ROM hash u64 | seed u64
+namespace trace {
+    constexpr char MAGIC[4] = {'C', '8', 'T', 'R'};
+    constexpr uint16_t VERSION = 1;
+    constexpr size_t HEADER_SIZE = 24;
+    constexpr size_t RECORD_SIZE = 28;
+
+    struct Record
+    {
+        uint16_t PC;
+        uint16_t opcode;
+        uint16_t Index;
+        uint8_t SP;
+        uint8_t delayTimer;
+        uint8_t soundTimer;
+        uint8_t registers[sizes::numRegisters];
+        uint16_t stackTop; // Return address of the innermost CALL, 0 at the top level
+    };
+
+    struct Header
+    {
+        uint16_t version;
+        uint16_t recordSize;
+        uint64_t romHash;
+        uint64_t seed;
+    };
+
+    Record Capture(const Chip8 &chip8);
+    void Encode(const Record &record, uint8_t *out);
+    Record Decode(const uint8_t *in);
+    // False when data doesn't start with a trace header
+    bool DecodeHeader(const uint8_t *data, size_t size, Header &header);
+}
+
+// Writes a binary trace through a 1 MB buffer. Call Record before every
+// Chip8::Cycle
+class TraceWriter
+{
+    std::FILE *file;
+    std::vector<uint8_t> buffer;
+    size_t used;
+    uint64_t records;
+    bool failed;
+
+    void Flush();
+
+    public:
+    TraceWriter();
+    TraceWriter(const TraceWriter &) = delete;
+    TraceWriter &operator=(const TraceWriter &) = delete;
+    ~TraceWriter();
+
+    bool Open(const std::string &filename, const Chip8 &chip8);
+    void Record(const Chip8 &chip8)
+    {
+        if (used + trace::RECORD_SIZE > buffer.size())
+        {
+            Flush();
+        }
+        trace::Encode(trace::Capture(chip8), buffer.data() + used);
+        used += trace::RECORD_SIZE;
+        records++;
+    }
+    // Returns false (with a message) if anything failed to write
+    bool Close();
+    uint64_t Records() const { return records; }
+};
+#endif
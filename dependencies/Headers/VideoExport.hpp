@@ -0,0 +1,79 @@
+#ifndef VIDEOEXPORT_HPP
+#define VIDEOEXPORT_HPP
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+#include "FrameCodec.hpp"
+
+// Converters from packed screens (see VideoRecorder) to common image
+// formats, without outside libraries. Colours are 0xRRGGBB
+struct ExportOptions
+{
+    int scale = 8;
+    uint32_t fgColour = 0xFFFFFF;
+    uint32_t bgColour = 0x000000;
+};
+
+class FrameExporter
+{
+    public:
+    virtual ~FrameExporter() = default;
+    virtual bool Begin(const std::string &filename, const ExportOptions &options) = 0;
+    // screen stays visible for frames 60 Hz frames
+    virtual void AddFrame(const uint8_t *screen, uint32_t frames) = 0;
+    virtual bool End() = 0;
+};
+
+// Animated GIF, LZW compressed. GIF delays are in 1/100 s and most viewers
+// treat delays under 2 as 10, so screens shown for less than 2/100 s are
+// folded into the next one
+class GifExporter : public FrameExporter
+{
+    std::ofstream out;
+    ExportOptions options;
+    uint8_t pending[framecodec::PACKED_SIZE];
+    bool hasPending;
+    uint64_t pendingStart; // Frame the pending screen appears on
+    uint64_t now;          // Frame after the pending screen
+
+    void WriteFrame(const uint8_t *screen, uint16_t delay);
+
+    public:
+    bool Begin(const std::string &filename, const ExportOptions &options) override;
+    void AddFrame(const uint8_t *screen, uint32_t frames) override;
+    bool End() override;
+};
+
+// Animated PNG, 1 bit palette images in stored (uncompressed) deflate blocks.
+// Frame timing is exact
+class ApngExporter : public FrameExporter
+{
+    std::ofstream out;
+    ExportOptions options;
+    std::streampos actlPosition;
+    uint32_t frameCount;
+    uint32_t sequence;
+
+    void WriteChunk(const char *type, const std::vector<uint8_t> &data);
+
+    public:
+    bool Begin(const std::string &filename, const ExportOptions &options) override;
+    void AddFrame(const uint8_t *screen, uint32_t frames) override;
+    bool End() override;
+};
+
+// One 1 bit BMP per distinct screen, named <prefix>_<first frame>.bmp
+class BmpSequenceExporter : public FrameExporter
+{
+    std::string prefix;
+    ExportOptions options;
+    uint64_t now;
+    bool ok;
+
+    public:
+    bool Begin(const std::string &filename, const ExportOptions &options) override;
+    void AddFrame(const uint8_t *screen, uint32_t frames) override;
+    bool End() override;
+};
+#endif
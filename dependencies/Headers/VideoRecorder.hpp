@@ -0,0 +1,73 @@
+#ifndef VIDEORECORDER_HPP
+#define VIDEORECORDER_HPP
+#include <atomic>
+#include <cstdint>
+#include <fstream>
+#include <functional>
+#include <string>
+#include <thread>
+#include <vector>
+#include "Chip8.hpp"
+#include "FrameCodec.hpp"
+#include "SpscQueue.hpp"
+
+// Records the screen once per emulated frame. The emulation thread only
+// packs the screen into a lock free queue; a background thread encodes and
+// writes it. File layout (numbers are LEB128):
+//   "C8VD" | version u8 | fps u8 | width u8 | height u8 | records...
+// Records:
+//   'K' size payload   keyframe, framecodec delta against a black frame
+//   'D' size payload   framecodec delta to the previous frame
+//   'R' count          the previous frame stays on screen count more frames
+//   'E' frameCount     end of the recording
+// A keyframe is written at least every 10 seconds so a damaged file can
+// still be read up to the damage
+class VideoRecorder
+{
+    struct QueuedFrame
+    {
+        uint32_t dropped; // Frames lost to a full queue right before this one
+        uint8_t screen[framecodec::PACKED_SIZE];
+    };
+
+    SpscQueue<QueuedFrame> queue;
+    std::thread encoder;
+    std::atomic<bool> stopping;
+    std::atomic<uint64_t> droppedFrames;
+    uint32_t droppedPending; // Emulation thread only
+
+    // Encoder thread only
+    std::ofstream out;
+    uint8_t previous[framecodec::PACKED_SIZE];
+    uint64_t frameCount;
+    uint32_t repeats;
+    uint32_t sinceKeyframe;
+    std::vector<uint8_t> record;
+
+    void EncoderLoop();
+    void Encode(const QueuedFrame &frame);
+    void FlushRepeats();
+
+    public:
+    VideoRecorder();
+    VideoRecorder(const VideoRecorder &) = delete;
+    VideoRecorder &operator=(const VideoRecorder &) = delete;
+    ~VideoRecorder();
+
+    bool Start(const std::string &filename);
+    // Emulation thread, once per frame. Never blocks
+    void Submit(const Chip8 &chip8);
+    // Writes everything still queued and closes the file
+    void Stop();
+
+    bool IsRecording() const { return encoder.joinable(); }
+    uint64_t FrameCount() const { return frameCount; } // Valid after Stop
+    uint64_t DroppedFrames() const { return droppedFrames; }
+};
+
+// Calls onFrame once for every distinct screen of a recording, together with
+// the number of frames it stays visible. Returns false if the file can't be
+// read or is damaged; frames before the damage have been delivered
+bool ReadVideo(const std::string &filename,
+               const std::function<void(const uint8_t *screen, uint32_t frames)> &onFrame);
+#endif
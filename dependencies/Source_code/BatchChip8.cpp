@@ -0,0 +1,641 @@
+#include "BatchChip8.hpp"
+#include <algorithm>
+#include <cstring>
+#include "Random.hpp"
+#include "RomImage.hpp"
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define BATCH_HAS_AVX2_KERNELS
+#endif
+
+using byte = uint8_t;
+using doubleByte = uint16_t;
+
+static const int VIDEO_SIZE = sizes::VIDEO_WIDTH * sizes::VIDEO_HEIGHT;
+// Groups split off per divergent step, the lanes left after that run one by
+// one. So do the lanes left once a group comes out smaller than MIN_GROUP,
+// each split goes over every waiting lane and doesn't pay off for a few
+static const uint32_t MAX_GROUPS = 8;
+static const uint32_t MIN_GROUP = 4;
+
+// Opcodes ExecuteUniform and ExecuteGroup run as loops over many lanes.
+// Anything else is decoded per lane by ExecuteLane anyway, so grouping
+// those lanes only costs time
+static bool HasKernel(doubleByte opcode)
+{
+    // 1nnn, 6xkk, 7xkk, Annn and 8xy0 to 8xy4 (not 8xy4 with VF)
+    const uint32_t kind = opcode >> 12u;
+    if ((0x04C2u >> kind) & 1u)
+    {
+        return true;
+    }
+    return kind == 0x8 && ((opcode & 0xFu) <= 0x3u ||
+                           ((opcode & 0xFu) == 0x4u && (opcode & 0xF00u) != 0xF00u && (opcode & 0xF0u) != 0xF0u));
+}
+
+#pragma region kernels
+// Uniform ALU kernels: every lane executes the same 8xyN / 7xkk. The plain
+// loops are written so the compiler can vectorize them, the AVX2 versions
+// are picked at runtime when the CPU supports them
+#ifdef BATCH_HAS_AVX2_KERNELS
+__attribute__((target("avx2"))) static uint32_t AddImmAvx2(byte *vx, byte kk, uint32_t n)
+{
+    const __m256i k = _mm256_set1_epi8(static_cast<char>(kk));
+    uint32_t i = 0;
+    for (; i + 32 <= n; i += 32)
+    {
+        __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(vx + i));
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(vx + i), _mm256_add_epi8(a, k));
+    }
+    return i;
+}
+
+__attribute__((target("avx2"))) static uint32_t LogicAvx2(byte *vx, const byte *vy, byte op, uint32_t n)
+{
+    uint32_t i = 0;
+    for (; i + 32 <= n; i += 32)
+    {
+        __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(vx + i));
+        __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(vy + i));
+        __m256i r = op == 0x1 ? _mm256_or_si256(a, b) : op == 0x2 ? _mm256_and_si256(a, b) : _mm256_xor_si256(a, b);
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(vx + i), r);
+    }
+    return i;
+}
+
+__attribute__((target("avx2"))) static uint32_t AddCarryAvx2(byte *vx, const byte *vy, byte *vf, uint32_t n)
+{
+    const __m256i one = _mm256_set1_epi8(1);
+    uint32_t i = 0;
+    for (; i + 32 <= n; i += 32)
+    {
+        __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(vx + i));
+        __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(vy + i));
+        __m256i sum = _mm256_add_epi8(a, b);
+        // No carry exactly when sum >= a (unsigned)
+        __m256i noCarry = _mm256_cmpeq_epi8(_mm256_max_epu8(sum, a), sum);
+        __m256i carry = _mm256_andnot_si256(noCarry, one);
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(vx + i), sum);
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(vf + i), carry);
+    }
+    return i;
+}
+#endif
+#pragma endregion kernels
+
+BatchChip8::BatchChip8(uint32_t lanes) :
+    lanes{lanes},
+    V(sizes::numRegisters * lanes),
+    PC(lanes, START_ADDRESS),
+    Index(lanes),
+    SP(lanes),
+    delayTimer(lanes),
+    soundTimer(lanes),
+    stack(sizes::stackLevels * lanes),
+    rngState(lanes),
+    rngInitialState(lanes, pcg32::InitialState(0)),
+    memory(static_cast<size_t>(sizes::memSize) * lanes),
+    image(sizes::memSize),
+    video(static_cast<size_t>(VIDEO_SIZE) * lanes),
+    pending(lanes),
+    waiting(lanes),
+    grouped(lanes),
+    avx2{false},
+    keypad(sizes::numKeys * lanes),
+    uniformSteps{0},
+    divergentSteps{0},
+    divergentGroups{0}
+{
+#ifdef BATCH_HAS_AVX2_KERNELS
+    avx2 = __builtin_cpu_supports("avx2");
+#endif
+    std::shared_ptr<const RomImage> empty = RomImage::Get(nullptr, 0, START_ADDRESS);
+    for (int page = 0; page < sizes::numPages; page++)
+    {
+        std::copy(empty->Page(page), empty->Page(page) + sizes::pageSize, &image[page * sizes::pageSize]);
+    }
+    Reset();
+}
+
+int BatchChip8::LoadRom(const uint8_t *data, size_t size)
+{
+    if (size == 0 || size > static_cast<size_t>(sizes::memSize - START_ADDRESS))
+    {
+        return -1;
+    }
+    std::shared_ptr<const RomImage> rom = RomImage::Get(data, size, START_ADDRESS);
+    for (int page = 0; page < sizes::numPages; page++)
+    {
+        std::copy(rom->Page(page), rom->Page(page) + sizes::pageSize, &image[page * sizes::pageSize]);
+    }
+    Reset();
+    return static_cast<int>(size);
+}
+
+void BatchChip8::Seed(const uint64_t *seeds)
+{
+    for (uint32_t lane = 0; lane < lanes; lane++)
+    {
+        rngInitialState[lane] = pcg32::InitialState(seeds[lane]);
+        rngState[lane] = rngInitialState[lane];
+    }
+}
+
+void BatchChip8::Reset()
+{
+    std::fill(V.begin(), V.end(), 0);
+    std::fill(PC.begin(), PC.end(), START_ADDRESS);
+    std::fill(Index.begin(), Index.end(), 0);
+    std::fill(SP.begin(), SP.end(), 0);
+    std::fill(delayTimer.begin(), delayTimer.end(), 0);
+    std::fill(soundTimer.begin(), soundTimer.end(), 0);
+    std::fill(stack.begin(), stack.end(), 0);
+    std::fill(keypad.begin(), keypad.end(), 0);
+    std::fill(video.begin(), video.end(), 0);
+    rngState = rngInitialState;
+    for (uint32_t lane = 0; lane < lanes; lane++)
+    {
+        std::memcpy(&memory[lane * sizes::memSize], image.data(), sizes::memSize);
+    }
+}
+
+void BatchChip8::Step()
+{
+    if (lanes == 0)
+    {
+        return;
+    }
+    const doubleByte pc = PC[0];
+    const doubleByte opcode = Fetch(0, pc);
+    bool uniform = true;
+    for (uint32_t lane = 1; lane < lanes; lane++)
+    {
+        // Same PC is not enough, self modifying ROMs can differ per lane
+        if (PC[lane] != pc || Fetch(lane, pc) != opcode)
+        {
+            uniform = false;
+            break;
+        }
+    }
+
+    if (uniform)
+    {
+        uniformSteps++;
+        ExecuteUniform(opcode);
+        return;
+    }
+
+    // Lanes running an opcode without a kernel go right away, the rest wait
+    // to be grouped by opcode (which includes every lane on the same PC)
+    divergentSteps++;
+    uint32_t count = 0;
+    for (uint32_t lane = 0; lane < lanes; lane++)
+    {
+        const doubleByte laneOpcode = Fetch(lane, PC[lane]);
+        PC[lane] += 2;
+        if (HasKernel(laneOpcode))
+        {
+            pending[lane] = laneOpcode;
+            waiting[count++] = lane;
+        }
+        else
+        {
+            ExecuteLane(lane, laneOpcode);
+        }
+    }
+    if (count != 0)
+    {
+        ExecuteWaiting(count);
+    }
+}
+
+void BatchChip8::ExecuteWaiting(uint32_t count)
+{
+    for (uint32_t groups = 0; count != 0 && groups < MAX_GROUPS; groups++)
+    {
+        // Moves the lanes sharing the first lane's opcode into grouped and
+        // keeps the others waiting, both in lane order. Written without a
+        // branch, which lane goes where is as random as the lanes' paths
+        const doubleByte opcode = pending[waiting[0]];
+        uint32_t members = 0;
+        uint32_t left = 0;
+        for (uint32_t i = 0; i < count; i++)
+        {
+            const uint32_t lane = waiting[i];
+            const uint32_t match = pending[lane] == opcode;
+            grouped[members] = lane;
+            waiting[left] = lane;
+            members += match;
+            left += match ^ 1u;
+        }
+        divergentGroups++;
+        ExecuteGroup(opcode, members);
+        count = left;
+        if (members < MIN_GROUP)
+        {
+            break;
+        }
+    }
+    for (uint32_t i = 0; i < count; i++)
+    {
+        ExecuteLane(waiting[i], pending[waiting[i]]);
+    }
+}
+
+void BatchChip8::ExecuteGroup(doubleByte opcode, uint32_t count)
+{
+    const uint32_t *group = grouped.data();
+    const byte x = (opcode >> 8u) & 0xFu;
+    const byte y = (opcode >> 4u) & 0xFu;
+    const byte n = opcode & 0xFu;
+    const byte kk = opcode & 0xFFu;
+    const doubleByte nnn = opcode & 0xFFFu;
+    byte *vx = &V[x * lanes];
+    byte *vy = &V[y * lanes];
+    byte *vf = &V[0xF * lanes];
+
+    // The opcodes ExecuteUniform has kernels for (see HasKernel), as
+    // loops over the group's lanes
+    switch (opcode >> 12u)
+    {
+    case 0x1: // JP nnn
+        for (uint32_t i = 0; i < count; i++)
+        {
+            PC[group[i]] = nnn;
+        }
+        return;
+    case 0x6: // LD Vx, kk
+        for (uint32_t i = 0; i < count; i++)
+        {
+            vx[group[i]] = kk;
+        }
+        return;
+    case 0x7: // ADD Vx, kk
+        for (uint32_t i = 0; i < count; i++)
+        {
+            vx[group[i]] = static_cast<byte>(vx[group[i]] + kk);
+        }
+        return;
+    case 0xA: // LD I, nnn
+        for (uint32_t i = 0; i < count; i++)
+        {
+            Index[group[i]] = nnn;
+        }
+        return;
+    case 0x8:
+        switch (n)
+        {
+        case 0x0: // LD Vx, Vy
+            for (uint32_t i = 0; i < count; i++)
+            {
+                vx[group[i]] = vy[group[i]];
+            }
+            return;
+        case 0x1: // OR Vx, Vy
+            for (uint32_t i = 0; i < count; i++)
+            {
+                vx[group[i]] |= vy[group[i]];
+            }
+            return;
+        case 0x2: // AND Vx, Vy
+            for (uint32_t i = 0; i < count; i++)
+            {
+                vx[group[i]] &= vy[group[i]];
+            }
+            return;
+        case 0x3: // XOR Vx, Vy
+            for (uint32_t i = 0; i < count; i++)
+            {
+                vx[group[i]] ^= vy[group[i]];
+            }
+            return;
+        case 0x4: // ADD Vx, Vy
+            if (x != 0xF && y != 0xF)
+            {
+                for (uint32_t i = 0; i < count; i++)
+                {
+                    const uint32_t lane = group[i];
+                    const doubleByte sum = vx[lane] + vy[lane];
+                    vx[lane] = static_cast<byte>(sum);
+                    vf[lane] = sum > 255u;
+                }
+                return;
+            }
+            break;
+        default:
+            break;
+        }
+        break;
+    default:
+        break;
+    }
+
+    for (uint32_t i = 0; i < count; i++)
+    {
+        ExecuteLane(group[i], opcode);
+    }
+}
+
+void BatchChip8::ExecuteUniform(doubleByte opcode)
+{
+    const byte x = (opcode >> 8u) & 0xFu;
+    const byte y = (opcode >> 4u) & 0xFu;
+    const byte n = opcode & 0xFu;
+    const byte kk = opcode & 0xFFu;
+    const doubleByte nnn = opcode & 0xFFFu;
+    byte *vx = &V[x * lanes];
+    byte *vy = &V[y * lanes];
+    byte *vf = &V[0xF * lanes];
+    uint32_t lane = 0;
+
+    for (doubleByte &pc : PC)
+    {
+        pc += 2;
+    }
+
+    switch (opcode >> 12u)
+    {
+    case 0x1: // JP nnn
+        std::fill(PC.begin(), PC.end(), nnn);
+        return;
+    case 0x6: // LD Vx, kk
+        std::fill(vx, vx + lanes, kk);
+        return;
+    case 0x7: // ADD Vx, kk
+#ifdef BATCH_HAS_AVX2_KERNELS
+        if (avx2)
+        {
+            lane = AddImmAvx2(vx, kk, lanes);
+        }
+#endif
+        for (; lane < lanes; lane++)
+        {
+            vx[lane] = static_cast<byte>(vx[lane] + kk);
+        }
+        return;
+    case 0xA: // LD I, nnn
+        std::fill(Index.begin(), Index.end(), nnn);
+        return;
+    case 0x8:
+        switch (n)
+        {
+        case 0x0: // LD Vx, Vy
+            std::memmove(vx, vy, lanes);
+            return;
+        case 0x1: // OR Vx, Vy
+        case 0x2: // AND Vx, Vy
+        case 0x3: // XOR Vx, Vy
+#ifdef BATCH_HAS_AVX2_KERNELS
+            if (avx2)
+            {
+                lane = LogicAvx2(vx, vy, n, lanes);
+            }
+#endif
+            for (; lane < lanes; lane++)
+            {
+                vx[lane] = n == 0x1 ? (vx[lane] | vy[lane]) : n == 0x2 ? (vx[lane] & vy[lane]) : (vx[lane] ^ vy[lane]);
+            }
+            return;
+        case 0x4: // ADD Vx, Vy
+            // Vx and VF alias when x == F, the scalar order (Vx first) matters
+            if (x != 0xF && y != 0xF)
+            {
+#ifdef BATCH_HAS_AVX2_KERNELS
+                if (avx2)
+                {
+                    lane = AddCarryAvx2(vx, vy, vf, lanes);
+                }
+#endif
+                for (; lane < lanes; lane++)
+                {
+                    const doubleByte sum = vx[lane] + vy[lane];
+                    vx[lane] = static_cast<byte>(sum);
+                    vf[lane] = sum > 255u;
+                }
+                return;
+            }
+            break;
+        default:
+            break;
+        }
+        break;
+    default:
+        break;
+    }
+
+    // Everything else (skips, calls, memory, drawing, ...) still decodes
+    // once but runs per lane
+    for (lane = 0; lane < lanes; lane++)
+    {
+        ExecuteLane(lane, opcode);
+    }
+}
+
+void BatchChip8::ExecuteLane(uint32_t lane, doubleByte opcode)
+{
+    const byte x = (opcode >> 8u) & 0xFu;
+    const byte y = (opcode >> 4u) & 0xFu;
+    const byte n = opcode & 0xFu;
+    const byte kk = opcode & 0xFFu;
+    const doubleByte nnn = opcode & 0xFFFu;
+    byte &Vx = V[x * lanes + lane];
+    byte &Vy = V[y * lanes + lane];
+    byte &VF = V[0xF * lanes + lane];
+    doubleByte &pc = PC[lane];
+    doubleByte &I = Index[lane];
+    byte &sp = SP[lane];
+    byte *mem = &memory[lane * sizes::memSize];
+    const byte *keys = &keypad[lane * sizes::numKeys];
+
+    // Mirrors the handlers in Instructions/ProdFunctions.cpp, including the
+    // order in which Vx and VF are written
+    switch (opcode >> 12u)
+    {
+    case 0x0:
+        if (n == 0x0) // CLS, leaves the last pixel like Chip8::OP_00E0
+        {
+            std::fill(&video[lane * VIDEO_SIZE], &video[lane * VIDEO_SIZE] + VIDEO_SIZE - 1, 0);
+        }
+        else if (n == 0xE) // RET
+        {
+            pc = stack[((sp - 1) & 0xFu) * lanes + lane];
+            --sp;
+        }
+        break;
+    case 0x1: pc = nnn; break;
+    case 0x2:
+        ++sp;
+        stack[((sp - 1) & 0xFu) * lanes + lane] = pc;
+        pc = nnn;
+        break;
+    case 0x3: if (Vx == kk) { pc += 2; } break;
+    case 0x4: if (Vx != kk) { pc += 2; } break;
+    case 0x5: if (Vx == Vy) { pc += 2; } break;
+    case 0x6: Vx = kk; break;
+    case 0x7: Vx = static_cast<byte>(Vx + kk); break;
+    case 0x8:
+        switch (n)
+        {
+        case 0x0: Vx = Vy; break;
+        case 0x1: Vx = Vx | Vy; break;
+        case 0x2: Vx = Vx & Vy; break;
+        case 0x3: Vx = Vx ^ Vy; break;
+        case 0x4:
+        {
+            const doubleByte sum = Vx + Vy;
+            Vx = static_cast<byte>(sum);
+            VF = sum > 255u;
+            break;
+        }
+        case 0x5:
+        {
+            const bool noBorrow = Vx > Vy;
+            Vx = static_cast<byte>(Vx - Vy);
+            VF = noBorrow;
+            break;
+        }
+        case 0x6:
+        {
+            const byte carry = Vx & 0x1u;
+            Vx = Vx >> 1;
+            VF = carry;
+            break;
+        }
+        case 0x7:
+            Vx = static_cast<byte>(Vy - Vx);
+            VF = Vy > Vx;
+            break;
+        case 0xE:
+        {
+            const byte carry = (Vx & 0x80u) >> 7u;
+            Vx = static_cast<byte>(Vx << 1);
+            VF = carry;
+            break;
+        }
+        default: break;
+        }
+        break;
+    case 0x9: if (Vx != Vy) { pc += 2; } break;
+    case 0xA: I = nnn; break;
+    case 0xB: pc = static_cast<doubleByte>(nnn + V[lane]); break;
+    case 0xC: Vx = pcg32::Next(rngState[lane]) & kk; break;
+    case 0xD: Draw(lane, x, y, n); break;
+    case 0xE:
+        if (n == 0xE && keys[Vx & 0xFu]) { pc += 2; }
+        else if (n == 0x1 && !keys[Vx & 0xFu]) { pc += 2; }
+        break;
+    case 0xF:
+        switch (kk)
+        {
+        case 0x07: Vx = delayTimer[lane]; break;
+        case 0x0A:
+        {
+            byte key = 0;
+            while (key < sizes::numKeys && !keys[key])
+            {
+                key++;
+            }
+            if (key < sizes::numKeys) { Vx = key; }
+            else { pc = static_cast<doubleByte>(pc - 2); }
+            break;
+        }
+        case 0x15: delayTimer[lane] = Vx; break;
+        case 0x18: soundTimer[lane] = Vx; break;
+        case 0x1E: I = static_cast<doubleByte>(I + Vx); break;
+        case 0x29: I = static_cast<doubleByte>(5 * Vx); break;
+        case 0x33:
+        {
+            doubleByte value = Vx;
+            mem[(I + 2) & 0xFFFu] = value % 10;
+            value = value / 10;
+            mem[(I + 1) & 0xFFFu] = value % 10;
+            value = value / 10;
+            mem[I & 0xFFFu] = static_cast<byte>(value % 10);
+            break;
+        }
+        case 0x55:
+            for (byte i = 0; i <= x; i++)
+            {
+                mem[(I + i) & 0xFFFu] = V[i * lanes + lane];
+            }
+            break;
+        case 0x65:
+            for (byte i = 0; i <= x; i++)
+            {
+                V[i * lanes + lane] = mem[(I + i) & 0xFFFu];
+            }
+            break;
+        default: break;
+        }
+        break;
+    }
+}
+
+void BatchChip8::Draw(uint32_t lane, byte x, byte y, byte height)
+{
+    using namespace sizes;
+    const byte startX = V[x * lanes + lane] % VIDEO_WIDTH;
+    const byte startY = V[y * lanes + lane] % VIDEO_HEIGHT;
+    const byte *mem = &memory[lane * memSize];
+    byte *screen = &video[lane * VIDEO_SIZE];
+    byte &VF = V[0xF * lanes + lane];
+
+    VF = 0;
+    for (byte row = 0; row < height; ++row)
+    {
+        const byte spriteByte = mem[(Index[lane] + row) & 0xFFFu];
+        for (byte col = 0; col < 8; ++col)
+        {
+            if (spriteByte & (0x80u >> col))
+            {
+                byte &pixel = screen[(startY + row) * VIDEO_WIDTH + (startX + col)];
+                if (pixel)
+                {
+                    VF = 1;
+                }
+                pixel ^= 1u;
+            }
+            if (startX + col + 1 >= VIDEO_WIDTH) { break; }
+        }
+        if (startY + row + 1 >= VIDEO_HEIGHT) { break; }
+    }
+}
+
+void BatchChip8::UpdateTimers()
+{
+    for (uint32_t lane = 0; lane < lanes; lane++)
+    {
+        delayTimer[lane] -= delayTimer[lane] > 0;
+        soundTimer[lane] -= soundTimer[lane] > 0;
+    }
+}
+
+uint64_t BatchChip8::LaneStateHash(uint32_t lane) const
+{
+    // Same fields and order as Chip8::StateHash
+    byte registers[sizes::numRegisters];
+    doubleByte laneStack[sizes::stackLevels];
+    for (int i = 0; i < sizes::numRegisters; i++)
+    {
+        registers[i] = V[i * lanes + lane];
+    }
+    for (int i = 0; i < sizes::stackLevels; i++)
+    {
+        laneStack[i] = stack[i * lanes + lane];
+    }
+    uint64_t hash = Fnv1a(registers, sizeof(registers));
+    hash = Fnv1a(laneStack, sizeof(laneStack), hash);
+    hash = Fnv1a(&Index[lane], sizeof(doubleByte), hash);
+    hash = Fnv1a(&PC[lane], sizeof(doubleByte), hash);
+    hash = Fnv1a(&SP[lane], 1, hash);
+    hash = Fnv1a(&delayTimer[lane], 1, hash);
+    hash = Fnv1a(&soundTimer[lane], 1, hash);
+    hash = Fnv1a(&rngState[lane], sizeof(uint64_t), hash);
+    hash = Fnv1a(&memory[lane * sizes::memSize], sizes::memSize, hash);
+    for (int i = 0; i < VIDEO_SIZE; i++)
+    {
+        const uint32_t pixel = video[lane * VIDEO_SIZE + i] ? 0xFFFFFFFFu : 0u;
+        hash = Fnv1a(&pixel, sizeof(pixel), hash);
+    }
+    return hash;
+}
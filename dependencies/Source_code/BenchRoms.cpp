@@ -0,0 +1,237 @@
+#include "BenchRoms.hpp"
+#include "Chip8.hpp"
+
+// How often a kernel repeats its instruction before jumping back
+static const int KERNEL_REPEATS = 128;
+
+namespace {
+    // Emits big endian opcodes from 0x200 and patches forward references
+    class Assembler
+    {
+        std::vector<uint8_t> data;
+
+        public:
+        uint16_t Here() const { return static_cast<uint16_t>(0x200 + data.size()); }
+        void Emit(uint16_t opcode)
+        {
+            data.push_back(static_cast<uint8_t>(opcode >> 8u));
+            data.push_back(static_cast<uint8_t>(opcode & 0xFFu));
+        }
+        void Patch(uint16_t address, uint16_t opcode)
+        {
+            data[address - 0x200] = static_cast<uint8_t>(opcode >> 8u);
+            data[address - 0x200 + 1] = static_cast<uint8_t>(opcode & 0xFFu);
+        }
+        std::vector<uint8_t> Take() { return std::move(data); }
+    };
+
+    struct Kernel
+    {
+        const char *name;
+        const char *description;
+        std::vector<uint16_t> setup;
+        uint16_t opcode; // 0 for the opcodes that need the body address
+    };
+}
+
+static void KernelPrologue(Assembler &rom)
+{
+    rom.Emit(0x6000); // LD V0, 0
+    rom.Emit(0xE0A1); // SKNP V0, machines holding key 0 run the next
+    rom.Emit(0x6000); // instruction and fall one step behind
+    for (uint16_t x = 1; x < 0x10; x++)
+    {
+        rom.Emit(static_cast<uint16_t>(0x6000u | (x << 8u) | (x * 0x11u)));
+    }
+    rom.Emit(0xA800); // LD I, 0x800
+}
+
+static benchroms::BenchRom BuildKernel(const Kernel &kernel)
+{
+    Assembler rom;
+    KernelPrologue(rom);
+    for (uint16_t opcode : kernel.setup)
+    {
+        rom.Emit(opcode);
+    }
+    const uint16_t body = rom.Here();
+    const std::string name = kernel.name;
+    bool selfLoop = false;
+    if (name == "1nnn" || name == "Bnnn")
+    {
+        // Jumps to themselves, V0 is 0 for Bnnn
+        rom.Emit(static_cast<uint16_t>((name == "1nnn" ? 0x1000u : 0xB000u) | body));
+        selfLoop = true;
+    }
+    else if (name == "Fx0A")
+    {
+        rom.Emit(0xF30A); // Re-executes itself while no key is held
+        selfLoop = true;
+    }
+    else if (name == "2nnn+00EE")
+    {
+        const uint16_t subroutine = static_cast<uint16_t>(body + 2 * (KERNEL_REPEATS + 1));
+        for (int i = 0; i < KERNEL_REPEATS; i++)
+        {
+            rom.Emit(static_cast<uint16_t>(0x2000u | subroutine));
+        }
+        rom.Emit(static_cast<uint16_t>(0x1000u | body));
+        rom.Emit(0x00EE);
+    }
+    else
+    {
+        for (int i = 0; i < KERNEL_REPEATS; i++)
+        {
+            rom.Emit(kernel.opcode);
+        }
+        rom.Emit(static_cast<uint16_t>(0x1000u | body));
+    }
+    return benchroms::BenchRom{name, kernel.description, rom.Take(), selfLoop};
+}
+
+std::vector<benchroms::BenchRom> benchroms::OpcodeKernels()
+{
+    // Registers hold x * 0x11, so SE/SNE below are a mix of taken and not.
+    // Ex9E/ExA1 use V0 = 0, other registers are no valid key
+    const std::vector<Kernel> kernels = {
+        {"00E0", "CLS", {}, 0x00E0},
+        {"1nnn", "JP nnn", {}, 0},
+        {"2nnn+00EE", "CALL nnn, RET", {}, 0},
+        {"3xkk", "SE Vx, kk", {}, 0x3355},
+        {"4xkk", "SNE Vx, kk", {}, 0x4355},
+        {"5xy0", "SE Vx, Vy", {}, 0x5340},
+        {"6xkk", "LD Vx, kk", {}, 0x6342},
+        {"7xkk", "ADD Vx, kk", {}, 0x7301},
+        {"8xy0", "LD Vx, Vy", {}, 0x8340},
+        {"8xy1", "OR Vx, Vy", {}, 0x8341},
+        {"8xy2", "AND Vx, Vy", {}, 0x8342},
+        {"8xy3", "XOR Vx, Vy", {}, 0x8343},
+        {"8xy4", "ADD Vx, Vy", {}, 0x8344},
+        {"8xy5", "SUB Vx, Vy", {}, 0x8345},
+        {"8xy6", "SHR Vx", {}, 0x8346},
+        {"8xy7", "SUBN Vx, Vy", {}, 0x8347},
+        {"8xyE", "SHL Vx", {}, 0x834E},
+        {"9xy0", "SNE Vx, Vy", {}, 0x9340},
+        {"Annn", "LD I, nnn", {}, 0xA800},
+        {"Bnnn", "JP V0, nnn", {}, 0},
+        {"Cxkk", "RND Vx, kk", {}, 0xC3FF},
+        {"Dxyn", "DRW Vx, Vy, 5 (font digit)", {0xF029}, 0xD125},
+        {"Ex9E", "SKP Vx (key 0)", {}, 0xE09E},
+        {"ExA1", "SKNP Vx (key 0)", {}, 0xE0A1},
+        {"Fx07", "LD Vx, DT", {}, 0xF307},
+        {"Fx0A", "LD Vx, K without a key", {}, 0},
+        {"Fx15", "LD DT, Vx", {}, 0xF315},
+        {"Fx18", "LD ST, Vx", {}, 0xF318},
+        {"Fx1E", "ADD I, Vx", {}, 0xF11E},
+        {"Fx29", "LD F, Vx", {}, 0xF329},
+        {"Fx33", "LD B, Vx", {}, 0xF333},
+        {"Fx55", "LD [I], VF", {}, 0xFF55},
+        {"Fx65", "LD VE, [I]", {}, 0xFE65},
+    };
+    std::vector<BenchRom> roms;
+    for (const Kernel &kernel : kernels)
+    {
+        roms.push_back(BuildKernel(kernel));
+    }
+    return roms;
+}
+
+static benchroms::BenchRom AluWorkload()
+{
+    Assembler rom;
+    for (uint16_t x = 0; x < 8; x++)
+    {
+        rom.Emit(static_cast<uint16_t>(0x6000u | (x << 8u) | (x * 0x1Du + 3u)));
+    }
+    const uint16_t loop = rom.Here();
+    rom.Emit(0x8014); // ADD V0, V1
+    rom.Emit(0x8125); // SUB V1, V2
+    rom.Emit(0x8232); // AND V2, V3
+    rom.Emit(0x8341); // OR V3, V4
+    rom.Emit(0x8453); // XOR V4, V5
+    rom.Emit(0x850E); // SHL V5
+    rom.Emit(0x8606); // SHR V6
+    rom.Emit(0x8707); // SUBN V7, V0
+    rom.Emit(0x7801); // ADD V8, 1
+    rom.Emit(0x3800); // SE V8, 0
+    rom.Emit(static_cast<uint16_t>(0x1000u | loop));
+    rom.Emit(0x7901); // ADD V9, 1 every 256 iterations
+    rom.Emit(static_cast<uint16_t>(0x1000u | loop));
+    return {"alu", "8xy* arithmetic in a counted loop", rom.Take(), false};
+}
+
+static benchroms::BenchRom DrawWorkload()
+{
+    Assembler rom;
+    rom.Emit(0x00E0); // CLS
+    rom.Emit(0x6A00); // LD VA, 0 (x)
+    rom.Emit(0x6B00); // LD VB, 0 (y)
+    rom.Emit(0x6C00); // LD VC, 0 (digit)
+    const uint16_t loop = rom.Here();
+    rom.Emit(0xFC29); // LD F, VC
+    rom.Emit(0xDAB5); // DRW VA, VB, 5
+    rom.Emit(0x7A05); // ADD VA, 5
+    rom.Emit(0x7C01); // ADD VC, 1
+    rom.Emit(0x3A3C); // SE VA, 60
+    rom.Emit(static_cast<uint16_t>(0x1000u | loop));
+    rom.Emit(0x6A00); // Next row
+    rom.Emit(0x7B06); // ADD VB, 6
+    rom.Emit(0x3B1E); // SE VB, 30
+    rom.Emit(static_cast<uint16_t>(0x1000u | loop));
+    rom.Emit(0x6B00); // Back to the top, the next pass erases this one
+    rom.Emit(static_cast<uint16_t>(0x1000u | loop));
+    return {"draw", "rows of font sprites drawn and erased with Dxyn", rom.Take(), false};
+}
+
+static benchroms::BenchRom MemoryWorkload()
+{
+    Assembler rom;
+    const uint16_t start = rom.Here();
+    rom.Emit(0xA400); // LD I, 0x400
+    rom.Emit(0x6800); // LD V8, 0
+    rom.Emit(0x6910); // LD V9, 16
+    const uint16_t loop = rom.Here();
+    rom.Emit(0xF755); // LD [I], V7
+    rom.Emit(0x7001); // ADD V0, 1
+    rom.Emit(0xF033); // LD B, V0
+    rom.Emit(0xF765); // LD V7, [I]
+    rom.Emit(0xF91E); // ADD I, V9
+    rom.Emit(0x7801); // ADD V8, 1
+    rom.Emit(0x3820); // SE V8, 32, stays within 0x400-0x600
+    rom.Emit(static_cast<uint16_t>(0x1000u | loop));
+    rom.Emit(static_cast<uint16_t>(0x1000u | start));
+    return {"memory", "Fx55/Fx65/Fx33 walking a 512 byte buffer", rom.Take(), false};
+}
+
+static benchroms::BenchRom CallsWorkload()
+{
+    // main calls a chain 15 deep (one stack level short of full) and loops
+    Assembler rom;
+    const int depth = sizes::stackLevels - 1;
+    const uint16_t top = rom.Here();
+    const uint16_t firstCall = rom.Here();
+    rom.Emit(0x0000); // Patched once the first subroutine's address is known
+    rom.Emit(0x7E01); // ADD VE, 1
+    rom.Emit(static_cast<uint16_t>(0x1000u | top));
+    for (int level = 1; level <= depth; level++)
+    {
+        const uint16_t subroutine = rom.Here();
+        if (level == 1)
+        {
+            rom.Patch(firstCall, static_cast<uint16_t>(0x2000u | subroutine));
+        }
+        rom.Emit(static_cast<uint16_t>(0x7001u | ((level % 8) << 8u))); // ADD V(level % 8), 1
+        if (level < depth)
+        {
+            // The next subroutine starts right after this one's RET
+            rom.Emit(static_cast<uint16_t>(0x2000u | (subroutine + 6)));
+        }
+        rom.Emit(0x00EE);
+    }
+    return {"calls", "2nnn/00EE chains 15 levels deep", rom.Take(), false};
+}
+
+std::vector<benchroms::BenchRom> benchroms::Workloads()
+{
+    return {AluWorkload(), DrawWorkload(), MemoryWorkload(), CallsWorkload()};
+}
@@ -1,26 +1,74 @@
 #include "Chip8.hpp"
+#include "Random.hpp"
+#include "Debugger.hpp"
+#include "FrameCodec.hpp"
+#include "Profiler.hpp"
 #include <fstream>
-#include <chrono>
 #include <algorithm>
 #include <iostream>
 #include <iomanip>
 #include <string>
 #include <functional>
-#include <random>
+#include <cstring>
 extern const int FONTSET_SIZE = 80;
 extern const uint16_t FONTSET_START_ADDRESS = 0x000;
 using byte = uint8_t;
 using doubleByte = uint16_t;
-Chip8::Chip8() : Index{0x000}, PC{START_ADDRESS}, SP{0}, delayTimer{0}, soundTimer{0}, IP{0x000},  screenUpdate{true}
+
+extern const uint8_t fontset[FONTSET_SIZE] =
+    {
+        0xF0, 0x90, 0x90, 0x90, 0xF0, // 0
+        0x20, 0x60, 0x20, 0x20, 0x70, // 1
+        0xF0, 0x10, 0xF0, 0x80, 0xF0, // 2
+        0xF0, 0x10, 0xF0, 0x10, 0xF0, // 3
+        0x90, 0x90, 0xF0, 0x10, 0x10, // 4
+        0xF0, 0x80, 0xF0, 0x10, 0xF0, // 5
+        0xF0, 0x80, 0xF0, 0x90, 0xF0, // 6
+        0xF0, 0x10, 0x20, 0x40, 0x40, // 7
+        0xF0, 0x90, 0xF0, 0x90, 0xF0, // 8
+        0xF0, 0x90, 0xF0, 0x10, 0xF0, // 9
+        0xF0, 0x90, 0xF0, 0x90, 0x90, // A
+        0xE0, 0x90, 0xE0, 0x90, 0xE0, // B
+        0xF0, 0x80, 0x80, 0x80, 0xF0, // C
+        0xE0, 0x90, 0x90, 0x90, 0xE0, // D
+        0xF0, 0x80, 0xF0, 0x80, 0xF0, // E
+        0xF0, 0x80, 0xF0, 0x80, 0x80  // F
+    };
+
+Chip8::Chip8func Chip8::table[0xF + 1];
+Chip8::Chip8func Chip8::table0[0xF + 1];
+Chip8::Chip8func Chip8::table8[0xF + 1];
+Chip8::Chip8func Chip8::tableE[0xF + 1];
+Chip8::Chip8func Chip8::tableF[0xFF + 1];
+Chip8::Chip8func Chip8::trapTable[0xF + 1];
+Chip8::Chip8func Chip8::breakTable[0xF + 1];
+
+Chip8::Chip8(uint8_t *pageStorage) : Index{0x000}, PC{START_ADDRESS}, SP{0}, delayTimer{0}, soundTimer{0}, IP{0x000},
+    externalPages{pageStorage != nullptr}, screenUpdate{true}, profiler{nullptr},
+    debugger{nullptr}, breakpoints{nullptr}, dispatch{table}
 {
-    memory = new byte[sizes::memSize];
-    video = new uint32_t[64 * 32];
-    initFuncPointerTable();
+    // Kept alive here so constructing a machine never allocates
+    static const std::shared_ptr<const RomImage> emptyImage = RomImage::Get(nullptr, 0, START_ADDRESS);
+    static const bool tablesReady = (initFuncPointerTable(), true);
+    (void)tablesReady;
+
+    for (int page = 0; page < sizes::numPages; page++)
+    {
+        ownPages[page] = externalPages ? pageStorage + page * sizes::pageSize : nullptr;
+    }
+    image = emptyImage;
+    Seed(0);
     Reset();
 }
 
 void Chip8::Reset(bool shouldLoadRom, std::string filename)
 {
+    // Loading a ROM rebuilds the image and resets to it
+    if (shouldLoadRom && LoadRom(filename.c_str()) >= 0)
+    {
+        return;
+    }
+
     SP = 0;
     delayTimer = 0;
     soundTimer = 0;
@@ -31,61 +79,216 @@ void Chip8::Reset(bool shouldLoadRom, std::string filename)
     std::fill(std::begin(registers), std::end(registers), 0);
     std::fill(std::begin(stack), std::end(stack), 0);
     std::fill(std::begin(keypad), std::end(keypad), 0);
-    std::fill(memory, memory + sizes::memSize - 1, 0);
-    std::fill(video, video + (sizes::VIDEO_HEIGHT) * (sizes::VIDEO_WIDTH) - 1, 0);
+    std::fill(video, video + (sizes::VIDEO_HEIGHT) * (sizes::VIDEO_WIDTH), 0);
 
-    uint8_t fontset[FONTSET_SIZE] =
-        {
-            0xF0, 0x90, 0x90, 0x90, 0xF0, // 0
-            0x20, 0x60, 0x20, 0x20, 0x70, // 1
-            0xF0, 0x10, 0xF0, 0x80, 0xF0, // 2
-            0xF0, 0x10, 0xF0, 0x10, 0xF0, // 3
-            0x90, 0x90, 0xF0, 0x10, 0x10, // 4
-            0xF0, 0x80, 0xF0, 0x10, 0xF0, // 5
-            0xF0, 0x80, 0xF0, 0x90, 0xF0, // 6
-            0xF0, 0x10, 0x20, 0x40, 0x40, // 7
-            0xF0, 0x90, 0xF0, 0x90, 0xF0, // 8
-            0xF0, 0x90, 0xF0, 0x10, 0xF0, // 9
-            0xF0, 0x90, 0xF0, 0x90, 0x90, // A
-            0xE0, 0x90, 0xE0, 0x90, 0xE0, // B
-            0xF0, 0x80, 0x80, 0x80, 0xF0, // C
-            0xE0, 0x90, 0x90, 0x90, 0xE0, // D
-            0xF0, 0x80, 0xF0, 0x80, 0xF0, // E
-            0xF0, 0x80, 0xF0, 0x80, 0x80  // F
-        };
-
-    for (unsigned int i = 0; i < FONTSET_SIZE; ++i)
+    // Fontset and ROM come from the shared image, no disk access or copying
+    // needed. Private pages stay allocated for the next copy on write
+    for (int page = 0; page < sizes::numPages; page++)
     {
-        memory[FONTSET_START_ADDRESS + i] = fontset[i];
+        readPages[page] = image->Page(page);
     }
 
-    // Random Number
-    std::random_device rd{};
-    // Create seed_seq with high-res clock and 7 random numbers from std::random_device
-    std::seed_seq ss{
-        static_cast<std::seed_seq::result_type>(std::chrono::steady_clock::now().time_since_epoch().count()),
-        rd(), rd(), rd(), rd(), rd(), rd(), rd()};
-
-    mt = std::mt19937{ss};
-    rand = std::uniform_int_distribution<uint8_t>{0, 255U};
+    // Random Number: the generator state is a single integer, so restarting
+    // the sequence for the current seed is just a copy
+    rngState = rngInitialState;
 
-    if (shouldLoadRom)
+    #ifdef CHIP8_PROFILE
+    if (profiler)
     {
-        LoadRom(filename.c_str());
+        profiler->OnReset();
     }
+    #endif
 }
 
 void Chip8::Cycle()
 {
-    IP = (memory[PC] << 8u) | memory[PC + 1];
+    IP = (ReadMemory(PC) << 8u) | ReadMemory(PC + 1);
+    #ifdef CHIP8_TRACK_MEMORY
+    memoryAccess.Executed(PC);
+    memoryAccess.Executed(PC + 1);
+    #endif
+    #ifdef CHIP8_PROFILE
+    if (profiler)
+    {
+        profiler->Record(PC, IP);
+    }
+    #endif
     PC += 2;
 
     #ifdef DEBUG
     printState();
     #endif
+    (this->*(dispatch[D_Opd_x000()]))();
+}
+
+void Chip8::OP_TRAP()
+{
+    const doubleByte address = PC - 2;
+    if (debugger->BeforeInstruction(address, IP))
+    {
+        PC = address; // Stopped before it ran
+        return;
+    }
+    const doubleByte indexBefore = Index;
+    (this->*(table[D_Opd_x000()]))();
+    debugger->AfterInstruction(address, IP, indexBefore);
+}
+
+void Chip8::OP_BREAK()
+{
+    if ((*breakpoints)[(PC - 2) & 0xFFFu])
+    {
+        OP_TRAP();
+        return;
+    }
     (this->*(table[D_Opd_x000()]))();
 }
 
+void Chip8::Seed(uint64_t seed)
+{
+    // Seeding is done once here instead of on every Reset
+    rngSeed = seed;
+    rngInitialState = pcg32::InitialState(seed);
+    rngState = rngInitialState;
+}
+
+bool Chip8::ProfilerBuilt()
+{
+    #ifdef CHIP8_PROFILE
+    return true;
+    #else
+    return false;
+    #endif
+}
+
+uint64_t Chip8::GetSeed() const
+{
+    return rngSeed;
+}
+
+uint64_t Chip8::RomHash() const
+{
+    return image->RomHash();
+}
+
+void Chip8::copyPage(int page)
+{
+    if (!ownPages[page])
+    {
+        ownPages[page] = new byte[sizes::pageSize];
+    }
+    std::memcpy(ownPages[page], readPages[page], sizes::pageSize);
+    readPages[page] = ownPages[page];
+}
+
+uint64_t Chip8::StateHash() const
+{
+    // Everything that influences future execution; used to check that two
+    // runs (e.g. a recording and its playback) ended in the same state
+    uint64_t hash = Fnv1a(registers, sizeof(registers));
+    hash = Fnv1a(stack, sizeof(stack), hash);
+    hash = Fnv1a(&Index, sizeof(Index), hash);
+    hash = Fnv1a(&PC, sizeof(PC), hash);
+    hash = Fnv1a(&SP, sizeof(SP), hash);
+    hash = Fnv1a(&delayTimer, sizeof(delayTimer), hash);
+    hash = Fnv1a(&soundTimer, sizeof(soundTimer), hash);
+    hash = Fnv1a(&rngState, sizeof(rngState), hash);
+    for (int page = 0; page < sizes::numPages; page++)
+    {
+        hash = Fnv1a(readPages[page], sizes::pageSize, hash);
+    }
+    return Fnv1a(video, sizeof(uint32_t) * sizes::VIDEO_WIDTH * sizes::VIDEO_HEIGHT, hash);
+}
+
+byte Chip8::NextRandom()
+{
+    return pcg32::Next(rngState);
+}
+
+Chip8CpuState Chip8::GetCpuState() const
+{
+    Chip8CpuState state;
+    state.PC = PC;
+    state.Index = Index;
+    state.SP = SP;
+    std::copy(std::begin(registers), std::end(registers), state.registers);
+    std::copy(std::begin(stack), std::end(stack), state.stack);
+    return state;
+}
+
+void Chip8::SetCpuState(const Chip8CpuState &state)
+{
+    PC = state.PC & 0xFFFu;
+    Index = state.Index;
+    SP = state.SP % sizes::stackLevels;
+    std::copy(std::begin(state.registers), std::end(state.registers), registers);
+    std::copy(std::begin(state.stack), std::end(state.stack), stack);
+}
+
+void Chip8::Snapshot(Chip8Snapshot &snapshot) const
+{
+    snapshot.cpu = GetCpuState();
+    snapshot.delayTimer = delayTimer;
+    snapshot.soundTimer = soundTimer;
+    snapshot.screenUpdate = screenUpdate;
+    std::copy(std::begin(keypad), std::end(keypad), snapshot.keypad);
+    snapshot.rngState = rngState;
+    framecodec::Pack(video, snapshot.video);
+    snapshot.image = image;
+    snapshot.writtenPages = 0;
+    snapshot.pages.clear();
+    for (int page = 0; page < sizes::numPages; page++)
+    {
+        if (readPages[page] != image->Page(page))
+        {
+            snapshot.writtenPages |= 1u << page;
+            snapshot.pages.insert(snapshot.pages.end(), readPages[page], readPages[page] + sizes::pageSize);
+        }
+    }
+}
+
+void Chip8::Restore(const Chip8Snapshot &snapshot)
+{
+    SetCpuState(snapshot.cpu);
+    delayTimer = snapshot.delayTimer;
+    soundTimer = snapshot.soundTimer;
+    screenUpdate = snapshot.screenUpdate;
+    std::copy(std::begin(snapshot.keypad), std::end(snapshot.keypad), keypad);
+    rngState = snapshot.rngState;
+    framecodec::Unpack(snapshot.video, video);
+    image = snapshot.image;
+    const byte *saved = snapshot.pages.data();
+    for (int page = 0; page < sizes::numPages; page++)
+    {
+        if (!(snapshot.writtenPages & (1u << page)))
+        {
+            readPages[page] = image->Page(page);
+            continue;
+        }
+        if (!ownPages[page])
+        {
+            ownPages[page] = new byte[sizes::pageSize];
+        }
+        std::memcpy(ownPages[page], saved, sizes::pageSize);
+        readPages[page] = ownPages[page];
+        saved += sizes::pageSize;
+    }
+}
+
+bool Chip8::Idle() const
+{
+    const doubleByte opcode = static_cast<doubleByte>((ReadMemory(PC) << 8u) | ReadMemory(PC + 1));
+    if (opcode == (0x1000u | PC))
+    {
+        return true;
+    }
+    if ((opcode & 0xF0FFu) == 0xF00Au)
+    {
+        return std::none_of(std::begin(keypad), std::end(keypad), [](byte key) { return key != 0; });
+    }
+    return false;
+}
+
 bool Chip8::UpdateTimers()
 {
     if (delayTimer > 0)
@@ -120,13 +323,15 @@ void Chip8::initFuncPointerTable()
     table[0xE] = &Chip8::TableE;
     table[0xF] = &Chip8::TableF;
 
-    for (int i = 0; i < 0xE + 1; i++)
+    for (int i = 0; i < 0xF + 1; i++)
     {
+        trapTable[i] = &Chip8::OP_TRAP;
+        breakTable[i] = &Chip8::OP_BREAK;
         table0[i] = &Chip8::OP_NULL;
         table8[i] = &Chip8::OP_NULL;
         tableE[i] = &Chip8::OP_NULL;
     }
-    for (int i = 0; i < 0x65 + 1; i++)
+    for (int i = 0; i < 0xFF + 1; i++)
     {
         tableF[i] = &Chip8::OP_NULL;
     }
@@ -160,34 +365,65 @@ void Chip8::initFuncPointerTable()
 
 Chip8::~Chip8()
 {
-    delete[] memory;
-    delete[] video;
+    if (!externalPages)
+    {
+        for (byte *page : ownPages)
+        {
+            delete[] page;
+        }
+    }
     PC = START_ADDRESS;
 }
 
-int Chip8::LoadRom(const char *filename)
+int Chip8::LoadRom(const char *filename, bool dump)
 {
-    int i = 0;
-    std::ifstream file(filename, std::ios::binary);
-    if (file.is_open())
+    std::ifstream file(filename, std::ios::binary | std::ios::ate);
+    if (!file.is_open())
     {
-        char x;
-        std::ios init(NULL);
-        init.copyfmt(std::cout);
-        while (file)
-        {
-            file.read(&x, 1);
-            memory[START_ADDRESS + i] = x;
-            std::cout << std::hex << START_ADDRESS + i << ": ";
-            std::cout << std::hex << std::setw(2) << std::setfill('0')
-                      << ((+x) & 0xFFu);
-			   std::cout << "\n";
-            i++;
-        }
-        std::cout.copyfmt(init);
-        file.close();
+        std::cout << "Error opening ROM file: " << filename << "\n";
+        return -1;
+    }
+    const std::streamoff size = file.tellg();
+    if (size < 0 || !checkRomSize(static_cast<size_t>(size)))
+    {
+        return -1;
+    }
+    byte buffer[sizes::memSize];
+    file.seekg(0, std::ios::beg);
+    if (!file.read(reinterpret_cast<char *>(buffer), size))
+    {
+        std::cout << "Error reading ROM file: " << filename << "\n";
+        return -1;
+    }
+    return LoadRom(buffer, static_cast<size_t>(size), dump);
+}
+
+int Chip8::LoadRom(const uint8_t *data, size_t size, bool dump)
+{
+    if (!checkRomSize(size))
+    {
+        return -1;
+    }
+    // Instances loading the same bytes end up sharing one image
+    image = RomImage::Get(data, size, START_ADDRESS);
+    if (dump)
+    {
+        dumpRom();
+    }
+    Reset();
+    return static_cast<int>(size);
+}
+
+bool Chip8::checkRomSize(size_t size)
+{
+    const size_t available = sizes::memSize - START_ADDRESS;
+    if (size == 0 || size > available)
+    {
+        std::cout << "Error: ROM is " << size << " bytes, it must be between 1 and "
+                  << available << " bytes\n";
+        return false;
     }
-    return i;
+    return true;
 }
 
 #pragma region helpers
@@ -246,6 +482,20 @@ void Chip8::printState()
     std::cout.copyfmt(init);
 }
 
+void Chip8::dumpRom()
+{
+    std::ios init(NULL);
+    init.copyfmt(std::cout);
+    for (size_t i = 0; i < image->RomSize(); ++i)
+    {
+        const size_t address = START_ADDRESS + i;
+        std::cout << std::hex << address << ": ";
+        std::cout << std::hex << std::setw(2) << std::setfill('0')
+                  << ((+image->Page(address / sizes::pageSize)[address % sizes::pageSize]) & 0xFFu) << "\n";
+    }
+    std::cout.copyfmt(init);
+}
+
 void Chip8::printByte(byte x)
 {
     std::ios init(NULL);
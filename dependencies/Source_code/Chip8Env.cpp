@@ -0,0 +1,129 @@
+#include "Chip8Env.hpp"
+#include <algorithm>
+#include <iostream>
+
+std::unique_ptr<Chip8Env> Chip8Env::Create(const Chip8EnvConfig &config)
+{
+    if (config.numEnvs == 0)
+    {
+        std::cout << "Error: an environment batch needs at least one environment\n";
+        return nullptr;
+    }
+    return std::unique_ptr<Chip8Env>(new Chip8Env(config));
+}
+
+Chip8Env::Chip8Env(const Chip8EnvConfig &config) :
+    config{config},
+    pool{config.numEnvs},
+    threads{config.threads},
+    lastScore(config.numEnvs),
+    steps(config.numEnvs),
+    rewards(config.numEnvs),
+    terminated(config.numEnvs),
+    truncated(config.numEnvs),
+    observations{nullptr}
+{
+    for (uint32_t env = 0; env < config.numEnvs; env++)
+    {
+        machines.push_back(pool.Acquire());
+    }
+}
+
+bool Chip8Env::LoadRom(const uint8_t *data, size_t size)
+{
+    // Every machine shares the same ROM image, see RomImage
+    for (Chip8 *machine : machines)
+    {
+        if (machine->LoadRom(data, size) < 0)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+void Chip8Env::SetObservationBuffer(uint8_t *buffer)
+{
+    observations = buffer;
+    if (observations)
+    {
+        for (uint32_t env = 0; env < config.numEnvs; env++)
+        {
+            PackFrame(env);
+        }
+    }
+}
+
+void Chip8Env::ResetEnv(uint32_t env, uint64_t seed)
+{
+    Chip8 &machine = *machines[env];
+    machine.Seed(seed);
+    machine.Reset();
+    lastScore[env] = config.score ? config.score(machine) : 0.0f;
+    steps[env] = 0;
+    rewards[env] = 0.0f;
+    terminated[env] = 0;
+    truncated[env] = 0;
+    if (observations)
+    {
+        PackFrame(env);
+    }
+}
+
+void Chip8Env::Reset(const uint64_t *seeds)
+{
+    threads.ParallelFor(config.numEnvs, [&](uint32_t env) { ResetEnv(env, seeds[env]); });
+}
+
+void Chip8Env::Reset(uint32_t env, uint64_t seed)
+{
+    ResetEnv(env, seed);
+}
+
+void Chip8Env::StepEnv(uint32_t env, uint16_t action)
+{
+    if (Done(env))
+    {
+        rewards[env] = 0.0f;
+        return;
+    }
+    Chip8 &machine = *machines[env];
+    for (int key = 0; key < sizes::numKeys; key++)
+    {
+        machine.keypad[key] = (action >> key) & 1u;
+    }
+    for (uint32_t frame = 0; frame < config.frameskip; frame++)
+    {
+        for (uint32_t i = 0; i < config.cyclesPerFrame; i++)
+        {
+            machine.Cycle();
+        }
+        machine.UpdateTimers();
+        if (config.gameOver && config.gameOver(machine))
+        {
+            terminated[env] = 1;
+            break;
+        }
+    }
+    const float score = config.score ? config.score(machine) : 0.0f;
+    rewards[env] = score - lastScore[env];
+    lastScore[env] = score;
+    if (++steps[env] >= config.maxSteps && !terminated[env])
+    {
+        truncated[env] = 1;
+    }
+    if (observations)
+    {
+        PackFrame(env);
+    }
+}
+
+void Chip8Env::Step(const uint16_t *actions)
+{
+    threads.ParallelFor(config.numEnvs, [&](uint32_t env) { StepEnv(env, actions[env]); });
+}
+
+void Chip8Env::PackFrame(uint32_t env)
+{
+    framecodec::Pack(machines[env]->video, observations + env * PACKED_FRAME_SIZE);
+}
@@ -0,0 +1,84 @@
+#include "Chip8Pool.hpp"
+#include <new>
+#ifdef __linux__
+#include <sys/mman.h>
+#endif
+
+// Slots start on a 4 KB boundary, so page storage and the Chip8 after it
+// never share a page. With 4 KB pages, page storage nobody wrote to is
+// never backed with memory. On Linux the arena asks for huge pages instead:
+// touching a slot then backs the whole 2 MB around it, untouched page
+// storage included, in exchange for far fewer TLB misses across machines
+static const size_t SLOT_ALIGNMENT = 4096;
+static const size_t HUGE_PAGE_SIZE = 2 * 1024 * 1024;
+
+static size_t RoundUp(size_t value, size_t alignment)
+{
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+Chip8Pool::Chip8Pool(uint32_t capacity) : arena{nullptr}, arenaSize{0}, slotSize{0}, capacity{capacity}, liveCount{0}
+{
+    slotSize = RoundUp(sizes::memSize + sizeof(Chip8), SLOT_ALIGNMENT);
+    if (capacity == 0)
+    {
+        // Nothing to map (mmap rejects a length of 0), Acquire always fails
+        return;
+    }
+    arenaSize = RoundUp(slotSize * capacity, HUGE_PAGE_SIZE);
+#ifdef __linux__
+    void *memory = mmap(nullptr, arenaSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (memory == MAP_FAILED)
+    {
+        throw std::bad_alloc();
+    }
+    madvise(memory, arenaSize, MADV_HUGEPAGE);
+    arena = static_cast<uint8_t *>(memory);
+#else
+    arena = static_cast<uint8_t *>(::operator new(arenaSize, std::align_val_t{HUGE_PAGE_SIZE}));
+#endif
+
+    freeSlots.reserve(capacity);
+    live.assign(capacity, 0);
+    // Hand out low slots first so live machines stay packed together
+    for (uint32_t slot = capacity; slot > 0; slot--)
+    {
+        freeSlots.push_back(slot - 1);
+    }
+}
+
+Chip8 *Chip8Pool::Acquire()
+{
+    if (freeSlots.empty())
+    {
+        return nullptr;
+    }
+    const uint32_t slot = freeSlots.back();
+    freeSlots.pop_back();
+    live[slot] = 1;
+    liveCount++;
+    return new (SlotMachine(slot)) Chip8(SlotPages(slot));
+}
+
+void Chip8Pool::Release(Chip8 *machine)
+{
+    const uint32_t slot = static_cast<uint32_t>((reinterpret_cast<uint8_t *>(machine) - arena) / slotSize);
+    machine->~Chip8();
+    live[slot] = 0;
+    liveCount--;
+    freeSlots.push_back(slot);
+}
+
+Chip8Pool::~Chip8Pool()
+{
+    ForEach([](Chip8 &machine) { machine.~Chip8(); });
+    if (!arena)
+    {
+        return;
+    }
+#ifdef __linux__
+    munmap(arena, arenaSize);
+#else
+    ::operator delete(arena, std::align_val_t{HUGE_PAGE_SIZE});
+#endif
+}
@@ -0,0 +1,246 @@
+#include "CoroutineScheduler.hpp"
+#include <algorithm>
+
+// Opcodes whose effect is not captured by Chip8CpuState. A loop containing
+// one of them is never treated as spinning
+static bool HasSideEffects(uint16_t opcode)
+{
+    switch (opcode >> 12u)
+    {
+    case 0x0: return (opcode & 0xFu) == 0x0u; // CLS, table0 only looks at the last nibble
+    case 0xC: return true;                                        // RND
+    case 0xD: return true;                                        // DRW
+    case 0xF:
+        switch (opcode & 0xFFu)
+        {
+        case 0x15: case 0x18: case 0x33: case 0x55: return true;
+        default: return false;
+        }
+    default: return false;
+    }
+}
+
+void CoroutineScheduler::TickEvent::await_suspend(std::coroutine_handle<> handle)
+{
+    session->resume = handle;
+    scheduler->tickWaiters.push_back(session);
+}
+
+void CoroutineScheduler::KeyEvent::await_suspend(std::coroutine_handle<> handle)
+{
+    session->resume = handle;
+    session->waitingForKey = true;
+    session->parkedAt = scheduler->ticks + 1;
+    scheduler->keyWaiters++;
+}
+
+CoroutineScheduler::CoroutineScheduler(uint32_t capacity) : pool{capacity}, keyWaiters{0}, ticks{0}
+{
+}
+
+CoroutineScheduler::~CoroutineScheduler()
+{
+    for (const std::unique_ptr<Session> &session : sessions)
+    {
+        session->task.handle.destroy();
+        pool.Release(session->machine);
+    }
+}
+
+int CoroutineScheduler::AddSession(const uint8_t *rom, size_t size, uint32_t IPS, uint64_t seed)
+{
+    if (IPS < 60)
+    {
+        // Fewer than one cycle per frame would never run the ROM
+        return -1;
+    }
+    Chip8 *machine = pool.Acquire();
+    if (!machine)
+    {
+        return -1;
+    }
+    machine->Seed(seed);
+    if (machine->LoadRom(rom, size) < 0)
+    {
+        pool.Release(machine);
+        return -1;
+    }
+    auto session = std::make_unique<Session>();
+    session->machine = machine;
+    session->cyclesPerFrame = IPS / 60;
+    session->pendingKeys = 0;
+    session->appliedKeys = 0;
+    session->spinning = false;
+    session->waitingForKey = false;
+    session->parkedAt = 0;
+    session->loopLength = 1;
+    session->cyclesExecuted = 0;
+    session->cyclesSkipped = 0;
+    session->task = SessionBody(session.get());
+    // Runs up to the first co_await, which queues it for the next tick
+    session->task.handle.resume();
+    sessions.push_back(std::move(session));
+    return static_cast<int>(sessions.size() - 1);
+}
+
+CoroutineScheduler::SessionTask CoroutineScheduler::SessionBody(Session *session)
+{
+    Chip8 &machine = *session->machine;
+    while (true)
+    {
+        if (session->spinning && !machine.TimersRunning())
+        {
+            co_await KeyEvent{this, session};
+        }
+        else
+        {
+            co_await TickEvent{this, session};
+        }
+
+        if (session->pendingKeys != session->appliedKeys)
+        {
+            for (int key = 0; key < sizes::numKeys; key++)
+            {
+                machine.keypad[key] = (session->pendingKeys >> key) & 1u;
+            }
+            session->appliedKeys = session->pendingKeys;
+        }
+        // A spin that started with the timers running may end when they
+        // reach zero (a delay wait), only one that saw them stopped depends
+        // on the keypad alone
+        const bool timersRunning = machine.TimersRunning();
+        session->spinning = RunFrame(*session) && !timersRunning;
+        machine.UpdateTimers();
+        machine.screenUpdate = false;
+    }
+}
+
+bool CoroutineScheduler::RunFrame(Session &session)
+{
+    Chip8 &machine = *session.machine;
+    const uint32_t cycles = session.cyclesPerFrame;
+    const bool anyKey = session.appliedKeys != 0;
+    Chip8CpuState loopStart{};
+    uint32_t loopStartCycle = 0;
+    bool haveLoopStart = false;
+    bool sideEffects = false;
+
+    for (uint32_t i = 0; i < cycles; i++)
+    {
+        const uint16_t pc = machine.GetPC();
+        const uint16_t opcode = static_cast<uint16_t>((machine.Peek(pc) << 8u) | machine.Peek(pc + 1));
+        if ((opcode & 0xF0FFu) == 0xF00Au && !anyKey)
+        {
+            // LD Vx, K without a key re-executes itself and changes nothing
+            session.loopLength = 1;
+            session.cyclesSkipped += cycles - i;
+            return true;
+        }
+        sideEffects = sideEffects || HasSideEffects(opcode);
+        machine.Cycle();
+        session.cyclesExecuted++;
+
+        // Every loop has a backward jump, only compare states there
+        if ((opcode & 0xF000u) != 0x1000u || (opcode & 0x0FFFu) > pc)
+        {
+            continue;
+        }
+        const Chip8CpuState state = machine.GetCpuState();
+        if (haveLoopStart && !sideEffects && state == loopStart)
+        {
+            // The machine will repeat this loop until the next frame. Run
+            // the leftover partial iteration so the frame ends where it would
+            const uint32_t loopLength = i - loopStartCycle;
+            const uint32_t remaining = cycles - 1 - i;
+            const uint32_t partial = remaining % loopLength;
+            for (uint32_t k = 0; k < partial; k++)
+            {
+                machine.Cycle();
+            }
+            session.loopLength = loopLength;
+            session.cyclesExecuted += partial;
+            session.cyclesSkipped += remaining - partial;
+            return true;
+        }
+        loopStart = state;
+        loopStartCycle = i;
+        haveLoopStart = true;
+        sideEffects = false;
+    }
+    return false;
+}
+
+void CoroutineScheduler::PressKeys(int id, uint16_t keys)
+{
+    Session *session = sessions[id].get();
+    session->pendingKeys = keys;
+    if (session->waitingForKey)
+    {
+        CatchUp(*session);
+        session->waitingForKey = false;
+        keyWaiters--;
+        tickWaiters.push_back(session);
+    }
+}
+
+void CoroutineScheduler::CatchUp(Session &session)
+{
+    // Every frame skipped while waiting would have run the same loop from
+    // the same point, so only the position within the loop has moved
+    const uint64_t skipped = (ticks - session.parkedAt) * session.cyclesPerFrame;
+    const uint64_t partial = skipped % session.loopLength;
+    for (uint64_t k = 0; k < partial; k++)
+    {
+        session.machine->Cycle();
+    }
+    session.cyclesExecuted += partial;
+    session.cyclesSkipped += skipped - partial;
+    session.parkedAt = ticks;
+}
+
+const Chip8 &CoroutineScheduler::Machine(int id)
+{
+    Session *session = sessions[id].get();
+    if (session->waitingForKey)
+    {
+        CatchUp(*session);
+    }
+    return *session->machine;
+}
+
+void CoroutineScheduler::Tick()
+{
+    // Sessions re-queue themselves while running, so work on a copy
+    running.swap(tickWaiters);
+    tickWaiters.clear();
+    for (Session *session : running)
+    {
+        session->resume.resume();
+    }
+    running.clear();
+    ticks++;
+}
+
+uint64_t CoroutineScheduler::CyclesExecuted() const
+{
+    uint64_t total = 0;
+    for (const std::unique_ptr<Session> &session : sessions)
+    {
+        total += session->cyclesExecuted;
+    }
+    return total;
+}
+
+uint64_t CoroutineScheduler::CyclesSkipped() const
+{
+    uint64_t total = 0;
+    for (const std::unique_ptr<Session> &session : sessions)
+    {
+        total += session->cyclesSkipped;
+        if (session->waitingForKey)
+        {
+            total += (ticks - session->parkedAt) * session->cyclesPerFrame;
+        }
+    }
+    return total;
+}
@@ -0,0 +1,288 @@
+#include "Debugger.hpp"
+#include <cstdio>
+#include "Disassembler.hpp"
+
+static std::string Hex(uint16_t value, int digits)
+{
+    char text[8];
+    std::snprintf(text, sizeof(text), "0x%0*X", digits, value);
+    return text;
+}
+
+Debugger::Debugger(Chip8 &chip8) : chip8{chip8}, registersBefore{}, mode{CONTINUE}, skipNext{false}, resumedAt{0}, stepUntil{0},
+    stepDepth{0}, stopKind{NOT_STOPPED}, stopAddress{0}
+{
+}
+
+Debugger::~Debugger()
+{
+    chip8.AttachDebugger(nullptr);
+}
+
+void Debugger::Arm()
+{
+    // Only trap while there is something to stop for, and with nothing but
+    // breakpoints only on their addresses
+    if (watchpoints.any() || !conditions.empty() || mode != CONTINUE)
+    {
+        chip8.AttachDebugger(this);
+    }
+    else
+    {
+        chip8.AttachDebugger(breakpoints.any() ? this : nullptr, &breakpoints);
+    }
+}
+
+void Debugger::Stop(StopKind kind, const std::string &reason, uint16_t address)
+{
+    stopKind = kind;
+    stopAddress = address;
+    stopReason = reason;
+    mode = CONTINUE;
+    Arm();
+}
+
+void Debugger::SetBreakpoint(uint16_t address)
+{
+    breakpoints.set(address & 0xFFFu);
+    Arm();
+}
+
+void Debugger::ClearBreakpoint(uint16_t address)
+{
+    breakpoints.reset(address & 0xFFFu);
+    Arm();
+}
+
+void Debugger::SetWatchpoint(uint16_t address, uint16_t length)
+{
+    for (uint32_t offset = 0; offset < length; offset++)
+    {
+        watchpoints.set((address + offset) & 0xFFFu);
+    }
+    Arm();
+}
+
+void Debugger::ClearWatchpoint(uint16_t address, uint16_t length)
+{
+    for (uint32_t offset = 0; offset < length; offset++)
+    {
+        watchpoints.reset((address + offset) & 0xFFFu);
+    }
+    Arm();
+}
+
+void Debugger::BreakOnChange(uint8_t reg)
+{
+    conditions.push_back({static_cast<uint8_t>(reg & 0xFu), true, 0});
+    Arm();
+}
+
+void Debugger::BreakOnValue(uint8_t reg, uint8_t value)
+{
+    conditions.push_back({static_cast<uint8_t>(reg & 0xFu), false, value});
+    Arm();
+}
+
+void Debugger::ClearConditions()
+{
+    conditions.clear();
+    Arm();
+}
+
+void Debugger::ClearAll()
+{
+    breakpoints.reset();
+    watchpoints.reset();
+    conditions.clear();
+    Arm();
+}
+
+void Debugger::WriteBreakpoints(std::ostream &out) const
+{
+    for (int address = 0; address < sizes::memSize; address++)
+    {
+        if (breakpoints[address])
+        {
+            out << "break " << Hex(address, 3) << "  " << disasm::Disassemble(
+                static_cast<uint16_t>(chip8.Peek(address) << 8u | chip8.Peek(address + 1))) << "\n";
+        }
+    }
+    // Watched addresses as ranges
+    for (int address = 0; address < sizes::memSize; address++)
+    {
+        if (!watchpoints[address])
+        {
+            continue;
+        }
+        int end = address;
+        while (end + 1 < sizes::memSize && watchpoints[end + 1])
+        {
+            end++;
+        }
+        out << "watch " << Hex(address, 3);
+        if (end > address)
+        {
+            out << "-" << Hex(end, 3);
+        }
+        out << "\n";
+        address = end;
+    }
+    for (const RegisterCondition &condition : conditions)
+    {
+        char text[32];
+        std::snprintf(text, sizeof(text), condition.anyChange ? "V%X changes" : "V%X == 0x%02X", condition.reg,
+                      condition.value);
+        out << "when " << text << "\n";
+    }
+}
+
+void Debugger::Resume(Mode mode)
+{
+    const Chip8CpuState state = chip8.GetCpuState();
+    if (mode == STEP_OUT && state.SP == 0)
+    {
+        mode = STEP;
+    }
+    this->mode = mode;
+    stopKind = NOT_STOPPED;
+    stopReason.clear();
+    skipNext = true;
+    resumedAt = state.PC;
+    stepDepth = state.SP;
+    stepUntil = 0;
+    if (mode == STEP_OVER)
+    {
+        const uint16_t opcode = static_cast<uint16_t>(chip8.Peek(state.PC) << 8u | chip8.Peek(state.PC + 1));
+        if (disasm::Classify(opcode) == disasm::OPC_2nnn)
+        {
+            stepUntil = static_cast<uint16_t>(state.PC + 2);
+        }
+        else
+        {
+            this->mode = STEP;
+        }
+    }
+    Arm();
+}
+
+void Debugger::ClearStop()
+{
+    stopKind = NOT_STOPPED;
+    stopReason.clear();
+    mode = CONTINUE;
+    skipNext = false;
+    Arm();
+}
+
+bool Debugger::BeforeInstruction(uint16_t address, uint16_t opcode)
+{
+    (void)opcode;
+    for (const RegisterCondition &condition : conditions)
+    {
+        registersBefore[condition.reg] = chip8.PeekRegister(condition.reg);
+    }
+    if (skipNext)
+    {
+        // Trapping only on breakpoints, the first trap can come long after
+        // resuming and must stop
+        skipNext = false;
+        if (address == resumedAt)
+        {
+            return false;
+        }
+    }
+    if (breakpoints[address & 0xFFFu])
+    {
+        Stop(BREAKPOINT, "breakpoint at " + Hex(address, 3));
+        return true;
+    }
+    switch (mode)
+    {
+    case STEP:
+        Stop(STEPPED, "step");
+        return true;
+    case STEP_OVER:
+        if (address == stepUntil && chip8.GetSP() == stepDepth)
+        {
+            Stop(STEPPED, "step over");
+            return true;
+        }
+        break;
+    case STEP_OUT:
+        if (chip8.GetSP() < stepDepth)
+        {
+            Stop(STEPPED, "step out");
+            return true;
+        }
+        break;
+    default:
+        break;
+    }
+    return false;
+}
+
+void Debugger::AfterInstruction(uint16_t address, uint16_t opcode, uint16_t indexBefore)
+{
+    // Index relative stores are the only writes to memory
+    const disasm::OpcodeClass opcodeClass = disasm::Classify(opcode);
+    if (opcodeClass == disasm::OPC_Fx33 || opcodeClass == disasm::OPC_Fx55)
+    {
+        const int length = opcodeClass == disasm::OPC_Fx33 ? 3 : ((opcode >> 8u) & 0xFu) + 1;
+        for (int offset = 0; offset < length; offset++)
+        {
+            const uint16_t written = (indexBefore + offset) & 0xFFFu;
+            if (watchpoints[written])
+            {
+                Stop(WATCHPOINT, "write to " + Hex(written, 3) + " by " + disasm::Disassemble(opcode) + " at " + Hex(address, 3),
+                     written);
+                return;
+            }
+        }
+    }
+    for (const RegisterCondition &condition : conditions)
+    {
+        const uint8_t before = registersBefore[condition.reg];
+        const uint8_t after = chip8.PeekRegister(condition.reg);
+        if (condition.anyChange ? before != after : before != after && after == condition.value)
+        {
+            char text[64];
+            std::snprintf(text, sizeof(text), "V%X 0x%02X -> 0x%02X", condition.reg, before, after);
+            Stop(REGISTER, std::string(text) + " by " + disasm::Disassemble(opcode) + " at " + Hex(address, 3));
+            return;
+        }
+    }
+}
+
+void Debugger::WriteDisassembly(std::ostream &out, uint16_t address, int count) const
+{
+    const uint16_t PC = chip8.GetPC();
+    for (int i = 0; i < count; i++)
+    {
+        const uint16_t at = (address + i * 2) & 0xFFFu;
+        const uint16_t opcode = static_cast<uint16_t>(chip8.Peek(at) << 8u | chip8.Peek(at + 1));
+        char line[64];
+        std::snprintf(line, sizeof(line), "%c%c 0x%03X  %04X  ", at == PC ? '>' : ' ', breakpoints[at] ? '*' : ' ', at,
+                      opcode);
+        out << line << disasm::Disassemble(opcode) << "\n";
+    }
+}
+
+void Debugger::WriteState(std::ostream &out) const
+{
+    const Chip8CpuState state = chip8.GetCpuState();
+    char line[96];
+    std::snprintf(line, sizeof(line), "PC 0x%03X  I 0x%03X  SP %u  DT %u  ST %u", state.PC, state.Index, state.SP,
+                  chip8.GetDelayTimer(), chip8.GetSoundTimer());
+    out << line << "\n";
+    for (int reg = 0; reg < sizes::numRegisters; reg++)
+    {
+        std::snprintf(line, sizeof(line), "V%X %02X%s", reg, state.registers[reg], reg % 8 == 7 ? "\n" : "  ");
+        out << line;
+    }
+    for (int level = state.SP - 1; level >= 0; level--)
+    {
+        std::snprintf(line, sizeof(line), "  #%d return to 0x%03X", state.SP - 1 - level, state.stack[level]);
+        out << line << "\n";
+    }
+}
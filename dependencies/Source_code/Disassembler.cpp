@@ -0,0 +1,123 @@
+#include "Disassembler.hpp"
+#include <cstdio>
+
+disasm::OpcodeClass disasm::Classify(uint16_t opcode)
+{
+    switch (opcode >> 12u)
+    {
+    case 0x0:
+        switch (opcode & 0xFu)
+        {
+        case 0x0: return OPC_00E0;
+        case 0xE: return OPC_00EE;
+        default: return OPC_UNDECODED;
+        }
+    case 0x1: return OPC_1nnn;
+    case 0x2: return OPC_2nnn;
+    case 0x3: return OPC_3xkk;
+    case 0x4: return OPC_4xkk;
+    case 0x5: return OPC_5xy0;
+    case 0x6: return OPC_6xkk;
+    case 0x7: return OPC_7xkk;
+    case 0x8:
+        switch (opcode & 0xFu)
+        {
+        case 0x0: return OPC_8xy0;
+        case 0x1: return OPC_8xy1;
+        case 0x2: return OPC_8xy2;
+        case 0x3: return OPC_8xy3;
+        case 0x4: return OPC_8xy4;
+        case 0x5: return OPC_8xy5;
+        case 0x6: return OPC_8xy6;
+        case 0x7: return OPC_8xy7;
+        case 0xE: return OPC_8xyE;
+        default: return OPC_UNDECODED;
+        }
+    case 0x9: return OPC_9xy0;
+    case 0xA: return OPC_Annn;
+    case 0xB: return OPC_Bnnn;
+    case 0xC: return OPC_Cxkk;
+    case 0xD: return OPC_Dxyn;
+    case 0xE:
+        switch (opcode & 0xFu)
+        {
+        case 0xE: return OPC_Ex9E;
+        case 0x1: return OPC_ExA1;
+        default: return OPC_UNDECODED;
+        }
+    default:
+        switch (opcode & 0xFFu)
+        {
+        case 0x07: return OPC_Fx07;
+        case 0x0A: return OPC_Fx0A;
+        case 0x15: return OPC_Fx15;
+        case 0x18: return OPC_Fx18;
+        case 0x1E: return OPC_Fx1E;
+        case 0x29: return OPC_Fx29;
+        case 0x33: return OPC_Fx33;
+        case 0x55: return OPC_Fx55;
+        case 0x65: return OPC_Fx65;
+        default: return OPC_UNDECODED;
+        }
+    }
+}
+
+const char *disasm::ClassName(OpcodeClass opcodeClass)
+{
+    static const char *const names[NUM_OPCODE_CLASSES] = {
+        "00E0", "00EE", "1nnn", "2nnn", "3xkk", "4xkk", "5xy0", "6xkk",
+        "7xkk", "8xy0", "8xy1", "8xy2", "8xy3", "8xy4", "8xy5", "8xy6",
+        "8xy7", "8xyE", "9xy0", "Annn", "Bnnn", "Cxkk", "Dxyn", "Ex9E",
+        "ExA1", "Fx07", "Fx0A", "Fx15", "Fx18", "Fx1E", "Fx29", "Fx33",
+        "Fx55", "Fx65", "????"};
+    return opcodeClass < NUM_OPCODE_CLASSES ? names[opcodeClass] : "????";
+}
+
+std::string disasm::Disassemble(uint16_t opcode)
+{
+    const unsigned x = (opcode >> 8u) & 0xFu;
+    const unsigned y = (opcode >> 4u) & 0xFu;
+    const unsigned n = opcode & 0xFu;
+    const unsigned kk = opcode & 0xFFu;
+    const unsigned nnn = opcode & 0xFFFu;
+    char text[24];
+    switch (Classify(opcode))
+    {
+    case OPC_00E0: return "CLS";
+    case OPC_00EE: return "RET";
+    case OPC_1nnn: std::snprintf(text, sizeof(text), "JP 0x%03X", nnn); break;
+    case OPC_2nnn: std::snprintf(text, sizeof(text), "CALL 0x%03X", nnn); break;
+    case OPC_3xkk: std::snprintf(text, sizeof(text), "SE V%X, 0x%02X", x, kk); break;
+    case OPC_4xkk: std::snprintf(text, sizeof(text), "SNE V%X, 0x%02X", x, kk); break;
+    case OPC_5xy0: std::snprintf(text, sizeof(text), "SE V%X, V%X", x, y); break;
+    case OPC_6xkk: std::snprintf(text, sizeof(text), "LD V%X, 0x%02X", x, kk); break;
+    case OPC_7xkk: std::snprintf(text, sizeof(text), "ADD V%X, 0x%02X", x, kk); break;
+    case OPC_8xy0: std::snprintf(text, sizeof(text), "LD V%X, V%X", x, y); break;
+    case OPC_8xy1: std::snprintf(text, sizeof(text), "OR V%X, V%X", x, y); break;
+    case OPC_8xy2: std::snprintf(text, sizeof(text), "AND V%X, V%X", x, y); break;
+    case OPC_8xy3: std::snprintf(text, sizeof(text), "XOR V%X, V%X", x, y); break;
+    case OPC_8xy4: std::snprintf(text, sizeof(text), "ADD V%X, V%X", x, y); break;
+    case OPC_8xy5: std::snprintf(text, sizeof(text), "SUB V%X, V%X", x, y); break;
+    case OPC_8xy6: std::snprintf(text, sizeof(text), "SHR V%X", x); break;
+    case OPC_8xy7: std::snprintf(text, sizeof(text), "SUBN V%X, V%X", x, y); break;
+    case OPC_8xyE: std::snprintf(text, sizeof(text), "SHL V%X", x); break;
+    case OPC_9xy0: std::snprintf(text, sizeof(text), "SNE V%X, V%X", x, y); break;
+    case OPC_Annn: std::snprintf(text, sizeof(text), "LD I, 0x%03X", nnn); break;
+    case OPC_Bnnn: std::snprintf(text, sizeof(text), "JP V0, 0x%03X", nnn); break;
+    case OPC_Cxkk: std::snprintf(text, sizeof(text), "RND V%X, 0x%02X", x, kk); break;
+    case OPC_Dxyn: std::snprintf(text, sizeof(text), "DRW V%X, V%X, %u", x, y, n); break;
+    case OPC_Ex9E: std::snprintf(text, sizeof(text), "SKP V%X", x); break;
+    case OPC_ExA1: std::snprintf(text, sizeof(text), "SKNP V%X", x); break;
+    case OPC_Fx07: std::snprintf(text, sizeof(text), "LD V%X, DT", x); break;
+    case OPC_Fx0A: std::snprintf(text, sizeof(text), "LD V%X, K", x); break;
+    case OPC_Fx15: std::snprintf(text, sizeof(text), "LD DT, V%X", x); break;
+    case OPC_Fx18: std::snprintf(text, sizeof(text), "LD ST, V%X", x); break;
+    case OPC_Fx1E: std::snprintf(text, sizeof(text), "ADD I, V%X", x); break;
+    case OPC_Fx29: std::snprintf(text, sizeof(text), "LD F, V%X", x); break;
+    case OPC_Fx33: std::snprintf(text, sizeof(text), "LD B, V%X", x); break;
+    case OPC_Fx55: std::snprintf(text, sizeof(text), "LD [I], V%X", x); break;
+    case OPC_Fx65: std::snprintf(text, sizeof(text), "LD V%X, [I]", x); break;
+    default: std::snprintf(text, sizeof(text), "DW 0x%04X", opcode); break;
+    }
+    return text;
+}
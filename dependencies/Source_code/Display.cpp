@@ -1,8 +1,15 @@
 #include "Display.hpp"
+#include <algorithm>
 #include <iostream>
+#include <random>
 #include "SDL2/SDL.h"
 #include "Chip8.hpp"
-Display::Display(Options options) : chip8{}, options{options}, chipState{emuState::RUNNING}, sampleRate{44100}, volume{1000}
+static const char *const WINDOW_TITLE = "Example";
+
+Display::Display(Options options) : chip8{}, options{options}, chipState{emuState::RUNNING}, sampleRate{44100}, volume{1000},
+    frame{0}, movieCursor{0}, recording{false}, playing{false}, telemetry{options.IPS}, lastFrameStart{0},
+    nextStatsTick{0}, statsTicks{0}, achievedIPS{0}, lastAudioCallback{0}, audioBufferNs{0}, audioPlaying{false},
+    recentFrameNs{}, recentFrame{0}
 {}
 
 Color::Color(uint32_t colorEncoded) : 
@@ -22,8 +29,16 @@ Options::Options(uint32_t bColor, uint32_t fColor, uint32_t IPS, uint32_t toneFr
 bgColor{bColor}, 
 fgColor{fColor}, 
 romFile{""}, 
-IPS{IPS}, toneFreq{toneFreq}
+recordFile{""},
+playFile{""},
+IPS{IPS}, toneFreq{toneFreq},
+dumpRom{false},
+statsInterval{0},
+overlay{false},
+latency{false}
 {
+    std::random_device rd{};
+    seed = (static_cast<uint64_t>(rd()) << 32u) | rd();
 }
 
 bool Display::InitChip(int scaleFactor, const char *romFile)
@@ -34,7 +49,7 @@ bool Display::InitChip(int scaleFactor, const char *romFile)
         return false;
     }
 
-    window = SDL_CreateWindow("Example", SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED,
+    window = SDL_CreateWindow(WINDOW_TITLE, SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED,
                               sizes::VIDEO_WIDTH * scaleFactor,
                               sizes::VIDEO_HEIGHT * scaleFactor,
                               SDL_WINDOW_SHOWN);
@@ -77,12 +92,46 @@ bool Display::InitChip(int scaleFactor, const char *romFile)
         std::cout << "Could not get desired Audio Spec\n";
         return false;
     }
+    audioBufferNs = static_cast<uint64_t>(obtained.samples) * 1000000000u / obtained.freq;
 
     ClearScreen();
     SDL_RenderPresent(renderer);
-    chip8.LoadRom(romFile);
+    if (!options.playFile.empty())
+    {
+        if (!movie.Load(options.playFile))
+        {
+            return false;
+        }
+        // The movie decides everything that affects determinism
+        options.seed = movie.seed;
+        options.IPS = movie.IPS;
+        telemetry.targetIPS = movie.IPS;
+        playing = true;
+    }
+    chip8.Seed(options.seed);
+    if (chip8.LoadRom(romFile, options.dumpRom) < 0)
+    {
+        return false;
+    }
     options.romFile = romFile;
     options.scaleFactor = scaleFactor;
+    if (playing && movie.romHash != chip8.RomHash())
+    {
+        std::cout << "Warning: movie was recorded with a different ROM\n";
+    }
+    if (!options.recordFile.empty())
+    {
+        movie.Begin(chip8, options.IPS);
+        recording = true;
+    }
+    if (!options.shmName.empty() && !frameRing.Create(options.shmName))
+    {
+        return false;
+    }
+    if (!options.videoFile.empty() && !videoRecorder.Start(options.videoFile))
+    {
+        return false;
+    }
     return true;
 }
 
@@ -94,6 +143,12 @@ void Display::audioCallback(void* userdata, Uint8* stream, int len)
 
 void Display::RenderAudio(Uint8* stream, int len)
 {
+    const uint64_t now = Telemetry::Now();
+    const uint64_t last = lastAudioCallback.exchange(now);
+    if (last != 0)
+    {
+        telemetry.AudioCallback(now - last, audioBufferNs);
+    }
     static int32_t sampleCount = 0;
     int16_t* audio_stream = (int16_t*) stream;
     // static bool isHigh = false;
@@ -114,14 +169,47 @@ void Display::RunChip()
     while (chipState != QUIT)
     {
         ProcessInput();
-        if(chipState == PAUSED || chipState == QUIT){continue;}
+        if(chipState == PAUSED || chipState == QUIT)
+        {
+            lastFrameStart = 0;
+            continue;
+        }
+        const uint64_t frameStart = Telemetry::Now();
+        if(lastFrameStart != 0)
+        {
+            const uint64_t frameNs = frameStart - lastFrameStart;
+            telemetry.frameTime.Record(frameNs);
+            recentFrameNs[recentFrame] = frameNs;
+            recentFrame = (recentFrame + 1) % OVERLAY_FRAMES;
+        }
+        lastFrameStart = frameStart;
+        UpdateStats(frameStart);
         const uint64_t start_frame_time = SDL_GetPerformanceCounter();
+
+        if(playing)
+        {
+            movieCursor = movie.ApplyEvents(chip8, frame, movieCursor);
+        }
         
         // Emulate CHIP8 Instructions for this emulator "frame" (60hz)
-        for (uint32_t i = 0; i < options.IPS / 60; i++)
+        const uint64_t cycleStart = Telemetry::Now();
+        if(options.latency)
+        {
+            for (uint32_t i = 0; i < options.IPS / 60; i++)
+            {
+                inputLatency.BeforeCycle(chip8);
+                chip8.Cycle();
+            }
+        }
+        else
         {
-            chip8.Cycle();
+            for (uint32_t i = 0; i < options.IPS / 60; i++)
+            {
+                chip8.Cycle();
+            }
         }
+        telemetry.cycleTime.Record(Telemetry::Now() - cycleStart);
+        telemetry.AddFrame(options.IPS / 60);
 
         // Get time elapsed after running instructions
         const uint64_t end_frame_time = SDL_GetPerformanceCounter();
@@ -129,12 +217,20 @@ void Display::RunChip()
         // Delay for approximately 60hz/60fps (16.67ms) or actual time elapsed
         const double time_elapsed = (double)((end_frame_time - start_frame_time) * 1000) / SDL_GetPerformanceFrequency();
 
-        SDL_Delay(16.67f > time_elapsed ? 16.67f - time_elapsed : 0);
+        const Uint32 delayMs = 16.67f > time_elapsed ? 16.67f - time_elapsed : 0;
+        const uint64_t sleepStart = Telemetry::Now();
+        SDL_Delay(delayMs);
+        const uint64_t slept = Telemetry::Now() - sleepStart;
+        const uint64_t requested = static_cast<uint64_t>(delayMs) * 1000000u;
+        telemetry.sleepOvershoot.Record(slept > requested ? slept - requested : 0);
         // SDL_Delay(100);
 
-        if(chip8.screenUpdate)
+        // The overlay changes every frame
+        if(chip8.screenUpdate || options.overlay)
         {
+            const uint64_t renderStart = Telemetry::Now();
             Render();
+            telemetry.renderTime.Record(Telemetry::Now() - renderStart);
             chip8.screenUpdate = false;
         }
 
@@ -142,18 +238,95 @@ void Display::RunChip()
         if(isTimer0)
         {
             SDL_PauseAudioDevice(devId, 1); // Pause Sound
+            if(audioPlaying)
+            {
+                // Gaps while paused are not underruns
+                lastAudioCallback.store(0);
+                audioPlaying = false;
+            }
         }
         else
         {
             SDL_PauseAudioDevice(devId, 0); // Play Sound
+            audioPlaying = true;
         }
 
+        if(frameRing.IsOpen())
+        {
+            frameRing.Publish(chip8, frame);
+        }
+        if(videoRecorder.IsRecording())
+        {
+            videoRecorder.Submit(chip8);
+        }
+        frame++;
+        if(playing && frame >= movie.frameCount)
+        {
+            // Playback finished, hand the keypad back to the user
+            playing = false;
+            const uint64_t hash = chip8.StateHash();
+            std::cout << "Playback finished after " << frame << " frames, state hash: " << std::hex << hash << std::dec
+                      << (hash == movie.finalHash ? " (matches recording)" : " (DIFFERS from recording)") << "\n";
+        }
+    }
+
+    if(recording)
+    {
+        movie.End(chip8, frame);
+        movie.Save(options.recordFile);
+        std::cout << "Recorded " << frame << " frames, state hash: " << std::hex << movie.finalHash << std::dec << "\n";
+    }
+    if(videoRecorder.IsRecording())
+    {
+        videoRecorder.Stop();
+        std::cout << "Video: " << videoRecorder.FrameCount() << " frames written to " << options.videoFile;
+        if(videoRecorder.DroppedFrames() > 0)
+        {
+            std::cout << " (" << videoRecorder.DroppedFrames() << " repeated because the encoder fell behind)";
+        }
+        std::cout << "\n";
+    }
+    if(options.statsInterval > 0)
+    {
+        telemetry.WriteReport(std::cout);
+    }
+    if(options.latency)
+    {
+        inputLatency.WriteReport(std::cout);
+    }
+}
+
+void Display::UpdateStats(uint64_t now)
+{
+    if(now < nextStatsTick)
+    {
+        return;
+    }
+    const bool first = nextStatsTick == 0;
+    nextStatsTick = now + 1000000000u;
+    achievedIPS = telemetry.WindowIPS();
+    if(first)
+    {
+        return;
+    }
+    statsTicks++;
+    if(options.overlay)
+    {
+        SDL_SetWindowTitle(window, telemetry.StatsLine(achievedIPS).c_str());
+    }
+    if(options.statsInterval > 0 && statsTicks % options.statsInterval == 0)
+    {
+        std::cout << telemetry.StatsLine(achievedIPS) << "\n";
     }
 }
 
 void Display::ProcessInput()
 {
     SDL_Event event;
+    // Keypad as of the last movie event, transitions are recorded against it
+    uint8_t keypadBefore[sizes::numKeys];
+    std::copy(std::begin(chip8.keypad), std::end(chip8.keypad), keypadBefore);
+    uint64_t keyDownAt = 0; // When the first SDL_KEYDOWN of this poll was dequeued
 
     while (SDL_PollEvent(&event)) {
         switch (event.type) {
@@ -163,6 +336,9 @@ void Display::ProcessInput()
                 break;
 
             case SDL_KEYDOWN:
+                if (options.latency && keyDownAt == 0) {
+                    keyDownAt = Telemetry::Now();
+                }
                 switch (event.key.keysym.sym) {
                     case SDLK_ESCAPE:
                         // Escape key; Exit window & End program
@@ -179,9 +355,26 @@ void Display::ProcessInput()
                         }
                         break;
 
+                    case SDLK_F1:
+                        // Telemetry overlay, the stats go in the title
+                        options.overlay = !options.overlay;
+                        if (!options.overlay) {
+                            SDL_SetWindowTitle(window, WINDOW_TITLE);
+                            chip8.screenUpdate = true; // Redraw without it
+                        }
+                        break;
+
                     case SDLK_EQUALS:
                         // '=': Reset CHIP8 machine for the current ROM
-                        chip8.Reset(true, options.romFile);
+                        if (playing) {
+                            break;
+                        }
+                        chip8.Reset();
+                        inputLatency.Cancel();
+                        if (recording) {
+                            movie.RecordReset(frame);
+                        }
+                        std::copy(std::begin(chip8.keypad), std::end(chip8.keypad), keypadBefore);
                         break;
 
                     // Map qwerty keys to CHIP8 keypad
@@ -241,6 +434,27 @@ void Display::ProcessInput()
                 break;
         }
     }
+
+    for (uint8_t key = 0; key < sizes::numKeys; key++)
+    {
+        if (chip8.keypad[key] == keypadBefore[key])
+        {
+            continue;
+        }
+        if (playing)
+        {
+            // The movie owns the keypad during playback
+            chip8.keypad[key] = keypadBefore[key];
+        }
+        else if (recording)
+        {
+            movie.RecordKey(frame, key, chip8.keypad[key]);
+        }
+        if (options.latency && chip8.keypad[key] && !playing)
+        {
+            inputLatency.KeyDown(key, keyDownAt);
+        }
+    }
 }
 
 void Display::Render()
@@ -263,7 +477,54 @@ void Display::Render()
             SDL_RenderDrawRect(renderer, &rect);
         }
     }
+    if(options.overlay)
+    {
+        DrawOverlay();
+    }
     SDL_RenderPresent(renderer);
+    if(options.latency)
+    {
+        inputLatency.Presented(Telemetry::Now());
+    }
+}
+
+void Display::DrawOverlay()
+{
+    // Frame times of the last OVERLAY_FRAMES frames as bars along the bottom,
+    // a third of the window tall for 33.3 ms, with a line at 16.67 ms
+    const int width = sizes::VIDEO_WIDTH * options.scaleFactor;
+    const int height = sizes::VIDEO_HEIGHT * options.scaleFactor;
+    const int graphHeight = height / 3;
+    const int barWidth = std::max(1, width / OVERLAY_FRAMES);
+    const double fullScaleNs = 33.3e6;
+    SDL_SetRenderDrawBlendMode(renderer, SDL_BLENDMODE_BLEND);
+    for(int i = 0; i < OVERLAY_FRAMES; i++)
+    {
+        // Oldest on the left
+        const uint64_t frameNs = recentFrameNs[(recentFrame + i) % OVERLAY_FRAMES];
+        SDL_Rect bar;
+        bar.h = static_cast<int>(std::min(1.0, frameNs / fullScaleNs) * graphHeight);
+        bar.w = barWidth;
+        bar.x = i * barWidth;
+        bar.y = height - bar.h;
+        if(frameNs <= 17500000u)
+        {
+            SDL_SetRenderDrawColor(renderer, 0, 200, 0, 160);
+        }
+        else if(frameNs <= 33300000u)
+        {
+            SDL_SetRenderDrawColor(renderer, 230, 200, 0, 160);
+        }
+        else
+        {
+            SDL_SetRenderDrawColor(renderer, 230, 0, 0, 160);
+        }
+        SDL_RenderFillRect(renderer, &bar);
+    }
+    const int target = height - static_cast<int>(16.67e6 / fullScaleNs * graphHeight);
+    SDL_SetRenderDrawColor(renderer, 255, 255, 255, 200);
+    SDL_RenderDrawLine(renderer, 0, target, width, target);
+    SDL_SetRenderDrawBlendMode(renderer, SDL_BLENDMODE_NONE);
 }
 
 void Display::ClearScreen()
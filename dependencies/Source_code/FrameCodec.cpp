@@ -0,0 +1,92 @@
+#include "FrameCodec.hpp"
+
+namespace framecodec {
+    static const size_t MAX_RUN = 128;
+
+    void Pack(const uint32_t *video, uint8_t *packed)
+    {
+        for (size_t i = 0; i < PACKED_SIZE; i++)
+        {
+            uint8_t bits = 0;
+            for (int bit = 0; bit < 8; bit++)
+            {
+                bits = static_cast<uint8_t>((bits << 1u) | (video[i * 8 + bit] != 0));
+            }
+            packed[i] = bits;
+        }
+    }
+
+    void Unpack(const uint8_t *packed, uint32_t *video, uint32_t onColour)
+    {
+        for (size_t i = 0; i < PACKED_SIZE * 8; i++)
+        {
+            video[i] = ((packed[i / 8] >> (7 - i % 8)) & 1u) ? onColour : 0;
+        }
+    }
+
+    void EncodeDelta(const uint8_t *previous, const uint8_t *current, std::vector<uint8_t> &out)
+    {
+        size_t i = 0;
+        while (i < PACKED_SIZE)
+        {
+            size_t run = 0;
+            while (i + run < PACKED_SIZE && run < MAX_RUN && previous[i + run] == current[i + run])
+            {
+                run++;
+            }
+            if (run > 0)
+            {
+                out.push_back(static_cast<uint8_t>(0x7F + run));
+                i += run;
+                continue;
+            }
+            // Literals end at the first pair of equal bytes, a single one is
+            // cheaper to send as a literal than as a run
+            size_t literals = 0;
+            while (i + literals < PACKED_SIZE && literals < MAX_RUN)
+            {
+                const size_t j = i + literals;
+                if (previous[j] == current[j] && j + 1 < PACKED_SIZE && previous[j + 1] == current[j + 1])
+                {
+                    break;
+                }
+                literals++;
+            }
+            out.push_back(static_cast<uint8_t>(literals - 1));
+            for (size_t k = 0; k < literals; k++)
+            {
+                out.push_back(previous[i + k] ^ current[i + k]);
+            }
+            i += literals;
+        }
+    }
+
+    bool ApplyDelta(const uint8_t *delta, size_t size, uint8_t *frame)
+    {
+        size_t in = 0;
+        size_t pos = 0;
+        while (in < size)
+        {
+            const uint8_t control = delta[in++];
+            if (control >= 0x80)
+            {
+                pos += control - 0x7Fu;
+                if (pos > PACKED_SIZE)
+                {
+                    return false;
+                }
+                continue;
+            }
+            const size_t literals = control + 1u;
+            if (pos + literals > PACKED_SIZE || in + literals > size)
+            {
+                return false;
+            }
+            for (size_t k = 0; k < literals; k++)
+            {
+                frame[pos++] ^= delta[in++];
+            }
+        }
+        return true;
+    }
+}
@@ -0,0 +1,177 @@
+#include "FrameRing.hpp"
+#include <chrono>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <iostream>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static size_t RingSize(uint32_t slotCount)
+{
+    return sizeof(framering::Header) + slotCount * sizeof(framering::Slot);
+}
+
+FrameRingWriter::FrameRingWriter() : header{nullptr}, slots{nullptr}, mappedSize{0}
+{
+}
+
+FrameRingWriter::~FrameRingWriter()
+{
+    if (header)
+    {
+        munmap(header, mappedSize);
+        shm_unlink(name.c_str());
+    }
+}
+
+bool FrameRingWriter::Create(const std::string &ringName, uint32_t slotCount)
+{
+    if (slotCount == 0)
+    {
+        std::cout << "Error: a frame ring needs at least one slot\n";
+        return false;
+    }
+    const int fd = shm_open(ringName.c_str(), O_CREAT | O_RDWR | O_TRUNC, 0644);
+    if (fd < 0)
+    {
+        std::cout << "Error: could not create shared memory " << ringName << ": " << std::strerror(errno) << "\n";
+        return false;
+    }
+    const size_t size = RingSize(slotCount);
+    void *memory = MAP_FAILED;
+    if (ftruncate(fd, static_cast<off_t>(size)) == 0)
+    {
+        memory = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    }
+    close(fd);
+    if (memory == MAP_FAILED)
+    {
+        std::cout << "Error: could not map shared memory " << ringName << ": " << std::strerror(errno) << "\n";
+        shm_unlink(ringName.c_str());
+        return false;
+    }
+
+    // ftruncate zero filled the object, so every slot starts at sequence 0
+    name = ringName;
+    mappedSize = size;
+    header = static_cast<framering::Header *>(memory);
+    slots = reinterpret_cast<framering::Slot *>(static_cast<uint8_t *>(memory) + sizeof(framering::Header));
+    std::memcpy(header->magic, framering::MAGIC, sizeof(header->magic));
+    header->version = framering::VERSION;
+    header->slotCount = slotCount;
+    header->slotSize = sizeof(framering::Slot);
+    header->published.store(0, std::memory_order_release);
+    return true;
+}
+
+void FrameRingWriter::Publish(const Chip8 &chip8, uint64_t frame)
+{
+    const uint64_t index = header->published.load(std::memory_order_relaxed);
+    framering::Slot &slot = slots[index % header->slotCount];
+    // Sequence 2n + 1 while publish number n is written, 2n + 2 once done
+    slot.sequence.store(2 * index + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    FrameRecord &record = slot.record;
+    record.frame = frame;
+    record.timeNs = static_cast<uint64_t>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count());
+    record.cpu = chip8.GetCpuState();
+    record.delayTimer = chip8.GetDelayTimer();
+    record.soundTimer = chip8.GetSoundTimer();
+    record.keys = 0;
+    for (int key = 0; key < sizes::numKeys; key++)
+    {
+        record.keys |= static_cast<uint16_t>((chip8.keypad[key] != 0) << key);
+    }
+    framecodec::Pack(chip8.video, record.screen);
+
+    slot.sequence.store(2 * index + 2, std::memory_order_release);
+    header->published.store(index + 1, std::memory_order_release);
+}
+
+FrameRingReader::FrameRingReader() : header{nullptr}, slots{nullptr}, mappedSize{0}
+{
+}
+
+FrameRingReader::~FrameRingReader()
+{
+    if (header)
+    {
+        munmap(const_cast<framering::Header *>(header), mappedSize);
+    }
+}
+
+bool FrameRingReader::Open(const std::string &ringName)
+{
+    const int fd = shm_open(ringName.c_str(), O_RDONLY, 0);
+    if (fd < 0)
+    {
+        std::cout << "Error: could not open shared memory " << ringName << ": " << std::strerror(errno) << "\n";
+        return false;
+    }
+    struct stat info;
+    void *memory = MAP_FAILED;
+    if (fstat(fd, &info) == 0 && static_cast<size_t>(info.st_size) >= sizeof(framering::Header))
+    {
+        memory = mmap(nullptr, info.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    }
+    close(fd);
+    if (memory == MAP_FAILED)
+    {
+        std::cout << "Error: " << ringName << " is not a frame ring\n";
+        return false;
+    }
+
+    const framering::Header *mapped = static_cast<const framering::Header *>(memory);
+    if (std::memcmp(mapped->magic, framering::MAGIC, sizeof(mapped->magic)) != 0 ||
+        mapped->version != framering::VERSION || mapped->slotSize != sizeof(framering::Slot) ||
+        RingSize(mapped->slotCount) > static_cast<size_t>(info.st_size))
+    {
+        std::cout << "Error: " << ringName << " is not a compatible frame ring\n";
+        munmap(memory, info.st_size);
+        return false;
+    }
+    header = mapped;
+    mappedSize = info.st_size;
+    slots = reinterpret_cast<const framering::Slot *>(static_cast<const uint8_t *>(memory) + sizeof(framering::Header));
+    return true;
+}
+
+uint64_t FrameRingReader::Published() const
+{
+    return header->published.load(std::memory_order_acquire);
+}
+
+bool FrameRingReader::Read(uint64_t index, FrameRecord &out) const
+{
+    const framering::Slot &slot = slots[index % header->slotCount];
+    const uint64_t before = slot.sequence.load(std::memory_order_acquire);
+    if (before != 2 * index + 2)
+    {
+        return false;
+    }
+    std::memcpy(&out, &slot.record, sizeof(out));
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return slot.sequence.load(std::memory_order_relaxed) == before;
+}
+
+bool FrameRingReader::ReadLatest(FrameRecord &out) const
+{
+    // Retries a few times when the writer laps the slot during the copy
+    for (int attempt = 0; attempt < 4; attempt++)
+    {
+        const uint64_t published = Published();
+        if (published == 0)
+        {
+            return false;
+        }
+        if (Read(published - 1, out))
+        {
+            return true;
+        }
+    }
+    return false;
+}
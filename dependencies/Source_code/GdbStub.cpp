@@ -0,0 +1,585 @@
+#include "GdbStub.hpp"
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <iostream>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <vector>
+#include "Stream.hpp"
+
+static const size_t READ_CHUNK = 4096;
+static const int NUM_REGISTERS = sizes::numRegisters + 5; // V0-VF, I, PC, SP, DT, ST
+static const int REG_I = sizes::numRegisters;
+static const int REG_PC = REG_I + 1;
+static const int REG_SP = REG_I + 2;
+static const int REG_DT = REG_I + 3;
+static const int REG_ST = REG_I + 4;
+
+static std::string TargetXml()
+{
+    std::string xml = "<?xml version=\"1.0\"?>\n<!DOCTYPE target SYSTEM \"gdb-target.dtd\">\n"
+                      "<target version=\"1.0\">\n<feature name=\"org.chip8.core\">\n";
+    char line[96];
+    for (int reg = 0; reg < sizes::numRegisters; reg++)
+    {
+        std::snprintf(line, sizeof(line), "<reg name=\"v%x\" bitsize=\"8\" type=\"uint8\" regnum=\"%d\"/>\n", reg, reg);
+        xml += line;
+    }
+    xml += "<reg name=\"i\" bitsize=\"16\" type=\"data_ptr\"/>\n"
+           "<reg name=\"pc\" bitsize=\"16\" type=\"code_ptr\"/>\n"
+           "<reg name=\"sp\" bitsize=\"8\" type=\"uint8\"/>\n"
+           "<reg name=\"dt\" bitsize=\"8\" type=\"uint8\"/>\n"
+           "<reg name=\"st\" bitsize=\"8\" type=\"uint8\"/>\n"
+           "</feature>\n</target>\n";
+    return xml;
+}
+
+static void AppendHex(std::string &out, uint32_t value, int bytes)
+{
+    // Little endian, the order gdb expects register bytes in
+    static const char digits[] = "0123456789abcdef";
+    for (int i = 0; i < bytes; i++)
+    {
+        const uint8_t byte = (value >> (8 * i)) & 0xFFu;
+        out += digits[byte >> 4u];
+        out += digits[byte & 0xFu];
+    }
+}
+
+static bool ParseHexBytes(const std::string &hex, size_t offset, int bytes, uint32_t &value)
+{
+    if (offset + bytes * 2 > hex.size())
+    {
+        return false;
+    }
+    value = 0;
+    for (int i = 0; i < bytes; i++)
+    {
+        const char pair[3] = {hex[offset + i * 2], hex[offset + i * 2 + 1], '\0'};
+        // strtoul alone would also take signs and spaces
+        if (!std::isxdigit(static_cast<unsigned char>(pair[0])) || !std::isxdigit(static_cast<unsigned char>(pair[1])))
+        {
+            return false;
+        }
+        value |= static_cast<uint32_t>(std::strtoul(pair, nullptr, 16)) << (8 * i);
+    }
+    return true;
+}
+
+// Written without address + length, which wraps for lengths near 2^32
+static bool InMemory(uint32_t address, uint32_t length)
+{
+    return address <= sizes::memSize && length <= sizes::memSize - address;
+}
+
+// "addr,length" as sent by m, M and Z packets
+static bool ParseRange(const std::string &text, uint32_t &address, uint32_t &length)
+{
+    char *end = nullptr;
+    address = std::strtoul(text.c_str(), &end, 16);
+    if (*end != ',')
+    {
+        return false;
+    }
+    length = std::strtoul(end + 1, &end, 16);
+    return *end == '\0' || *end == ':' || *end == ',';
+}
+
+static int RegisterSize(int reg)
+{
+    return reg == REG_I || reg == REG_PC ? 2 : 1;
+}
+
+GdbStub::GdbStub(Chip8 &chip8, uint32_t cyclesPerFrame) : chip8{chip8}, debugger{chip8},
+    timeline{chip8, cyclesPerFrame, 4096, &debugger}, listenFd{-1}, fd{-1}, noAck{false}, swbreak{false},
+    running{false}
+{
+}
+
+GdbStub::~GdbStub()
+{
+    if (fd >= 0)
+    {
+        close(fd);
+    }
+    if (listenFd >= 0)
+    {
+        close(listenFd);
+    }
+    if (!unixPath.empty())
+    {
+        unlink(unixPath.c_str());
+    }
+}
+
+bool GdbStub::Listen(const std::string &address)
+{
+    listenFd = stream::Listen(address);
+    if (listenFd < 0)
+    {
+        return false;
+    }
+    if (!std::all_of(address.begin(), address.end(), [](char c) { return c >= '0' && c <= '9'; }))
+    {
+        unixPath = address;
+    }
+    return true;
+}
+
+void GdbStub::Accept()
+{
+    const int client = accept(listenFd, nullptr, nullptr);
+    if (client < 0)
+    {
+        return;
+    }
+    fcntl(client, F_SETFL, fcntl(client, F_GETFL) | O_NONBLOCK);
+    int one = 1;
+    setsockopt(client, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one)); // Fails harmlessly on UNIX sockets
+    fd = client;
+    inbox.clear();
+    noAck = false;
+    swbreak = false;
+    running = false;
+    std::cout << "Debugger connected\n";
+}
+
+void GdbStub::Disconnect()
+{
+    close(fd);
+    fd = -1;
+    // A new client sets its own breakpoints, the target waits for it
+    debugger.ClearAll();
+    running = false;
+    std::cout << "Debugger disconnected\n";
+}
+
+bool GdbStub::Read()
+{
+    char chunk[READ_CHUNK];
+    while (true)
+    {
+        const ssize_t received = recv(fd, chunk, sizeof(chunk), 0);
+        if (received > 0)
+        {
+            inbox.append(chunk, static_cast<size_t>(received));
+            continue;
+        }
+        if (received == 0)
+        {
+            return false;
+        }
+        return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;
+    }
+}
+
+void GdbStub::Poll(int timeoutMs)
+{
+    if (listenFd < 0)
+    {
+        return;
+    }
+    if (!running)
+    {
+        pollfd waitFor{fd >= 0 ? fd : listenFd, POLLIN, 0};
+        poll(&waitFor, 1, timeoutMs);
+    }
+    if (fd < 0)
+    {
+        Accept();
+        if (fd < 0)
+        {
+            return;
+        }
+    }
+    if (!Read())
+    {
+        Disconnect();
+        return;
+    }
+    // $packet#checksum, acks and Ctrl-C (0x03) in between
+    size_t start = 0;
+    while (fd >= 0 && start < inbox.size())
+    {
+        const char c = inbox[start];
+        if (c == '\x03')
+        {
+            start++;
+            if (running)
+            {
+                running = false;
+                Send("T02");
+            }
+            continue;
+        }
+        if (c != '$')
+        {
+            start++; // '+', '-' or noise
+            continue;
+        }
+        const size_t hash = inbox.find('#', start);
+        if (hash == std::string::npos || hash + 2 >= inbox.size())
+        {
+            break; // Incomplete
+        }
+        const std::string packet = inbox.substr(start + 1, hash - start - 1);
+        const uint8_t expected = static_cast<uint8_t>(std::strtoul(inbox.substr(hash + 1, 2).c_str(), nullptr, 16));
+        start = hash + 3;
+        uint8_t sum = 0;
+        for (char byte : packet)
+        {
+            sum = static_cast<uint8_t>(sum + static_cast<uint8_t>(byte));
+        }
+        if (!noAck)
+        {
+            SendRaw(sum == expected ? "+" : "-");
+        }
+        if (sum == expected)
+        {
+            Handle(packet);
+        }
+    }
+    if (fd >= 0)
+    {
+        inbox.erase(0, start);
+    }
+}
+
+void GdbStub::SendRaw(const std::string &bytes)
+{
+    size_t sent = 0;
+    while (fd >= 0 && sent < bytes.size())
+    {
+        const ssize_t written = send(fd, bytes.data() + sent, bytes.size() - sent, MSG_NOSIGNAL);
+        if (written > 0)
+        {
+            sent += static_cast<size_t>(written);
+        }
+        else if (written < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR))
+        {
+            pollfd waitFor{fd, POLLOUT, 0};
+            poll(&waitFor, 1, 100);
+        }
+        else
+        {
+            Disconnect();
+        }
+    }
+}
+
+void GdbStub::Send(const std::string &payload)
+{
+    uint8_t sum = 0;
+    for (char byte : payload)
+    {
+        sum = static_cast<uint8_t>(sum + static_cast<uint8_t>(byte));
+    }
+    char checksum[4];
+    std::snprintf(checksum, sizeof(checksum), "#%02x", sum);
+    SendRaw("$" + payload + checksum);
+}
+
+std::string GdbStub::StopReply() const
+{
+    char reply[32];
+    switch (debugger.Kind())
+    {
+    case Debugger::BREAKPOINT:
+        return swbreak ? "T05swbreak:;" : "S05";
+    case Debugger::WATCHPOINT:
+        std::snprintf(reply, sizeof(reply), "T05watch:%x;", debugger.StopAddress());
+        return reply;
+    default:
+        return "S05";
+    }
+}
+
+void GdbStub::ReportStop()
+{
+    running = false;
+    Send(StopReply());
+}
+
+std::string GdbStub::ReadRegister(int reg) const
+{
+    const Chip8CpuState state = chip8.GetCpuState();
+    std::string hex;
+    if (reg < sizes::numRegisters)
+    {
+        AppendHex(hex, state.registers[reg], 1);
+    }
+    else if (reg == REG_I)
+    {
+        AppendHex(hex, state.Index, 2);
+    }
+    else if (reg == REG_PC)
+    {
+        AppendHex(hex, state.PC, 2);
+    }
+    else if (reg == REG_SP)
+    {
+        AppendHex(hex, state.SP, 1);
+    }
+    else if (reg == REG_DT)
+    {
+        AppendHex(hex, chip8.GetDelayTimer(), 1);
+    }
+    else if (reg == REG_ST)
+    {
+        AppendHex(hex, chip8.GetSoundTimer(), 1);
+    }
+    return hex;
+}
+
+bool GdbStub::WriteRegister(int reg, const std::string &hex)
+{
+    uint32_t value = 0;
+    if (reg < 0 || reg >= NUM_REGISTERS || !ParseHexBytes(hex, 0, RegisterSize(reg), value))
+    {
+        return false;
+    }
+    Chip8CpuState state = chip8.GetCpuState();
+    if (reg < sizes::numRegisters)
+    {
+        state.registers[reg] = static_cast<uint8_t>(value);
+    }
+    else if (reg == REG_I)
+    {
+        state.Index = static_cast<uint16_t>(value);
+    }
+    else if (reg == REG_PC)
+    {
+        state.PC = static_cast<uint16_t>(value);
+    }
+    else if (reg == REG_SP)
+    {
+        state.SP = static_cast<uint8_t>(value);
+    }
+    else
+    {
+        const uint8_t delay = reg == REG_DT ? value : chip8.GetDelayTimer();
+        const uint8_t sound = reg == REG_ST ? value : chip8.GetSoundTimer();
+        chip8.SetTimers(delay, sound);
+        return true;
+    }
+    chip8.SetCpuState(state);
+    return true;
+}
+
+std::string GdbStub::ReadRegisters() const
+{
+    std::string hex;
+    for (int reg = 0; reg < NUM_REGISTERS; reg++)
+    {
+        hex += ReadRegister(reg);
+    }
+    return hex;
+}
+
+bool GdbStub::WriteRegisters(const std::string &hex)
+{
+    size_t offset = 0;
+    for (int reg = 0; reg < NUM_REGISTERS; reg++)
+    {
+        const size_t digits = RegisterSize(reg) * 2;
+        if (offset + digits > hex.size() || !WriteRegister(reg, hex.substr(offset, digits)))
+        {
+            return false;
+        }
+        offset += digits;
+    }
+    return true;
+}
+
+void GdbStub::Handle(const std::string &packet)
+{
+    const char command = packet.empty() ? '\0' : packet[0];
+    const std::string args = packet.size() > 1 ? packet.substr(1) : "";
+    uint32_t address = 0, length = 0;
+    switch (command)
+    {
+    case '?':
+        Send(StopReply());
+        return;
+    case 'g':
+        Send(ReadRegisters());
+        return;
+    case 'G':
+        timeline.DiscardFuture();
+        Send(WriteRegisters(args) ? "OK" : "E01");
+        return;
+    case 'p':
+    {
+        const unsigned long reg = std::strtoul(args.c_str(), nullptr, 16);
+        Send(reg < NUM_REGISTERS ? ReadRegister(static_cast<int>(reg)) : "E01");
+        return;
+    }
+    case 'P':
+    {
+        timeline.DiscardFuture();
+        const size_t equals = args.find('=');
+        const bool ok = equals != std::string::npos &&
+                        WriteRegister(std::strtoul(args.c_str(), nullptr, 16), args.substr(equals + 1));
+        Send(ok ? "OK" : "E01");
+        return;
+    }
+    case 'm':
+    {
+        if (!ParseRange(args, address, length) || !InMemory(address, length))
+        {
+            Send("E01");
+            return;
+        }
+        std::string hex;
+        for (uint32_t offset = 0; offset < length; offset++)
+        {
+            AppendHex(hex, chip8.Peek(address + offset), 1);
+        }
+        Send(hex);
+        return;
+    }
+    case 'M':
+    {
+        const size_t colon = args.find(':');
+        if (!ParseRange(args, address, length) || colon == std::string::npos || !InMemory(address, length) ||
+            args.size() - colon - 1 < uint64_t{length} * 2)
+        {
+            Send("E01");
+            return;
+        }
+        // Every digit is checked before anything is written
+        std::vector<uint8_t> bytes(length);
+        for (uint32_t offset = 0; offset < length; offset++)
+        {
+            uint32_t value = 0;
+            if (!ParseHexBytes(args, colon + 1 + offset * 2, 1, value))
+            {
+                Send("E01");
+                return;
+            }
+            bytes[offset] = static_cast<uint8_t>(value);
+        }
+        timeline.DiscardFuture();
+        for (uint32_t offset = 0; offset < length; offset++)
+        {
+            chip8.Poke(address + offset, bytes[offset]);
+        }
+        Send("OK");
+        return;
+    }
+    case 'c':
+    case 's':
+        if (!args.empty())
+        {
+            timeline.DiscardFuture();
+            Chip8CpuState state = chip8.GetCpuState();
+            state.PC = static_cast<uint16_t>(std::strtoul(args.c_str(), nullptr, 16));
+            chip8.SetCpuState(state);
+        }
+        // The reply is the stop packet, sent by Cycle or Ctrl-C
+        debugger.Resume(command == 's' ? Debugger::STEP : Debugger::CONTINUE);
+        running = true;
+        return;
+    case 'Z':
+    case 'z':
+    {
+        // Z0 software breakpoint, Z2 write watchpoint: type,addr,kind
+        const char type = args.empty() ? '\0' : args[0];
+        if ((type != '0' && type != '2') || args.size() < 2 || !ParseRange(args.substr(2), address, length))
+        {
+            Send("");
+            return;
+        }
+        if (type == '0')
+        {
+            command == 'Z' ? debugger.SetBreakpoint(address) : debugger.ClearBreakpoint(address);
+        }
+        else
+        {
+            command == 'Z' ? debugger.SetWatchpoint(address, length) : debugger.ClearWatchpoint(address, length);
+        }
+        Send("OK");
+        return;
+    }
+    case 'b':
+        // Reverse execution replays from a checkpoint, it stops right away.
+        // Reaching the start of the recording reports replaylog:begin
+        if (args == "s" || args == "c")
+        {
+            const bool moved = args == "s" ? timeline.StepBack() : timeline.ReverseContinue();
+            if (!moved)
+            {
+                Send("T05replaylog:begin;");
+            }
+            else
+            {
+                Send("S05");
+            }
+            return;
+        }
+        break;
+    case 'D':
+        Send("OK");
+        Disconnect();
+        return;
+    case 'k':
+        Disconnect();
+        return;
+    case 'H':
+        Send("OK");
+        return;
+    default:
+        break;
+    }
+
+    if (packet.rfind("qSupported", 0) == 0)
+    {
+        swbreak = packet.find("swbreak+") != std::string::npos;
+        Send("PacketSize=1000;qXfer:features:read+;QStartNoAckMode+;swbreak+;ReverseStep+;ReverseContinue+");
+    }
+    else if (packet == "QStartNoAckMode")
+    {
+        Send("OK");
+        noAck = true;
+    }
+    else if (packet.rfind("qXfer:features:read:target.xml:", 0) == 0)
+    {
+        static const std::string xml = TargetXml();
+        if (!ParseRange(packet.substr(std::strlen("qXfer:features:read:target.xml:")), address, length))
+        {
+            Send("E01");
+            return;
+        }
+        const size_t offset = std::min<size_t>(address, xml.size());
+        const std::string chunk = xml.substr(offset, length);
+        Send((offset + chunk.size() >= xml.size() ? "l" : "m") + chunk);
+    }
+    else if (packet == "qAttached")
+    {
+        Send("1");
+    }
+    else if (packet == "qC")
+    {
+        Send("QC1");
+    }
+    else if (packet == "qfThreadInfo")
+    {
+        Send("m1");
+    }
+    else if (packet == "qsThreadInfo")
+    {
+        Send("l");
+    }
+    else
+    {
+        Send(""); // Not supported
+    }
+}
@@ -0,0 +1,98 @@
+#include "InputLatency.hpp"
+#include <cstdio>
+#include "Disassembler.hpp"
+
+InputLatency::InputLatency() : stage{IDLE}, key{0}, pressedAt{0}, readAt{0}, drawnAt{0}, overlapped{0}, unread{0}, undrawn{0}, unpresented{0}
+{
+}
+
+void InputLatency::KeyDown(uint8_t key, uint64_t now)
+{
+    if (stage != IDLE)
+    {
+        // A ROM that reads keys but never draws, or a window that stopped
+        // presenting, would otherwise keep every later press out
+        const uint64_t stageStart = stage == PRESSED ? pressedAt : stage == READ ? readAt : drawnAt;
+        if (now - stageStart < GIVE_UP_NS)
+        {
+            overlapped++;
+            return;
+        }
+        if (stage == PRESSED)
+        {
+            unread++;
+        }
+        else if (stage == READ)
+        {
+            undrawn++;
+        }
+        else
+        {
+            unpresented++;
+        }
+    }
+    stage = PRESSED;
+    this->key = key;
+    pressedAt = now;
+}
+
+void InputLatency::Inspect(const Chip8 &chip8)
+{
+    const uint16_t PC = chip8.GetPC();
+    const uint16_t opcode = static_cast<uint16_t>(chip8.Peek(PC) << 8u | chip8.Peek(PC + 1));
+    const disasm::OpcodeClass opcodeClass = disasm::Classify(opcode);
+    if (stage == PRESSED)
+    {
+        const bool skip = opcodeClass == disasm::OPC_Ex9E || opcodeClass == disasm::OPC_ExA1;
+        if ((skip && chip8.PeekRegister((opcode >> 8u) & 0xFu) == key) ||
+            (opcodeClass == disasm::OPC_Fx0A && chip8.keypad[key]))
+        {
+            readAt = Telemetry::Now();
+            toRead.Record(readAt - pressedAt);
+            stage = READ;
+        }
+    }
+    else if (opcodeClass == disasm::OPC_Dxyn)
+    {
+        drawnAt = Telemetry::Now();
+        toDraw.Record(drawnAt - readAt);
+        stage = DRAWN;
+    }
+}
+
+void InputLatency::Presented(uint64_t now)
+{
+    if (stage != DRAWN)
+    {
+        return;
+    }
+    toPresent.Record(now - drawnAt);
+    total.Record(now - pressedAt);
+    stage = IDLE;
+}
+
+void InputLatency::WriteReport(std::ostream &out) const
+{
+    const struct
+    {
+        const char *name;
+        const LatencyHistogram &histogram;
+    } rows[] = {
+        {"key down -> read", toRead},
+        {"read -> draw", toDraw},
+        {"draw -> present", toPresent},
+        {"key down -> present", total},
+    };
+    out << "Input latency (ms)       count      mean       p50       p99      p999       max\n";
+    for (const auto &row : rows)
+    {
+        const LatencyHistogram &h = row.histogram;
+        char line[128];
+        std::snprintf(line, sizeof(line), "%-19s %10llu %9.3f %9.3f %9.3f %9.3f %9.3f", row.name,
+                      static_cast<unsigned long long>(h.Count()), h.Mean() / 1e6, h.Percentile(0.5) / 1e6,
+                      h.Percentile(0.99) / 1e6, h.Percentile(0.999) / 1e6, h.Max() / 1e6);
+        out << line << "\n";
+    }
+    out << overlapped << " presses during a measurement, " << unread << " never read, " << undrawn
+        << " read but never drawn, " << unpresented << " drawn but never presented\n";
+}
@@ -1,4 +1,4 @@
-#include "Display.hpp"
+#include "Chip8.hpp"
 #include <algorithm>
 #include <iostream>
 
@@ -325,7 +325,7 @@ void Chip8::OP_Cxkk()
     byte Vx = D_Opd_0x00();
     byte kk = D_Opd_00xx();
 
-    registers[Vx] = rand(mt) & kk;
+    registers[Vx] = NextRandom() & kk;
 
     std::cout << "V";
     printByte(Vx);
@@ -351,7 +351,7 @@ void Chip8::OP_Dxyn()
     registers[0xF] = 0;
     for (byte row = 0; row < height; ++row)
     {
-        byte spriteByte = memory[Index + row];
+        byte spriteByte = LoadMemory(Index + row);
         byte mask = 0x80; // 1000 0000
         for (byte col = 0; col < 8; ++col)
         {
@@ -478,11 +478,11 @@ void Chip8::OP_Fx33()
 {
     byte Vx = D_Opd_0x00();
     doubleByte value = registers[Vx];
-    memory[Index + 2] = value % 10;
+    WriteMemory(Index + 2, value % 10);
     value = value / 10;
-    memory[Index + 1] = value % 10;
+    WriteMemory(Index + 1, value % 10);
     value = value / 10;
-    memory[Index] = value % 10;
+    WriteMemory(Index, value % 10);
     std::cout << "Undocumented"
               << "\n";
 } // LD B, Vx
@@ -492,7 +492,7 @@ void Chip8::OP_Fx55()
     byte Vx = D_Opd_0x00();
     for (byte i = 0; i <= Vx; i++)
     {
-        memory[Index + i] = registers[i];
+        WriteMemory(Index + i, registers[i]);
     }
     std::cout << "Undocumented"
               << "\n";
@@ -504,7 +504,7 @@ void Chip8::OP_Fx65()
     byte Vx = D_Opd_0x00();
     for (byte i = 0; i <= Vx; i++)
     {
-        registers[i] = memory[Index + i];
+        registers[i] = LoadMemory(Index + i);
     }
     std::cout << "Undocumented"
               << "\n";
@@ -1,4 +1,4 @@
-#include "Display.hpp"
+#include "Chip8.hpp"
 #include <algorithm>
 
 extern const int FONTSET_SIZE;
@@ -230,7 +230,7 @@ void Chip8::OP_Cxkk()
     byte Vx = D_Opd_0x00();
     byte kk = D_Opd_00xx();
 
-    registers[Vx] = rand(mt) & kk;
+    registers[Vx] = NextRandom() & kk;
 } // RND Vx, kk
 
 void Chip8::OP_Dxyn()
@@ -246,7 +246,7 @@ void Chip8::OP_Dxyn()
     registers[0xF] = 0;
     for (byte row = 0; row < height; ++row)
     {
-        byte spriteByte = memory[Index + row];
+        byte spriteByte = LoadMemory(Index + row);
         byte mask = 0x80; // 1000 0000
         for (byte col = 0; col < 8; ++col)
         {
@@ -345,11 +345,11 @@ void Chip8::OP_Fx33()
 {
     byte Vx = D_Opd_0x00();
     doubleByte value = registers[Vx];
-    memory[Index + 2] = value % 10;
+    WriteMemory(Index + 2, value % 10);
     value = value / 10;
-    memory[Index + 1] = value % 10;
+    WriteMemory(Index + 1, value % 10);
     value = value / 10;
-    memory[Index] = value % 10;
+    WriteMemory(Index, value % 10);
 } // LD B, Vx
 
 void Chip8::OP_Fx55()
@@ -357,7 +357,7 @@ void Chip8::OP_Fx55()
     byte Vx = D_Opd_0x00();
     for (byte i = 0; i <= Vx; i++)
     {
-        memory[Index + i] = registers[i];
+        WriteMemory(Index + i, registers[i]);
     }
 
 } // LD [I], Vx
@@ -367,7 +367,7 @@ void Chip8::OP_Fx65()
     byte Vx = D_Opd_0x00();
     for (byte i = 0; i <= Vx; i++)
     {
-        registers[i] = memory[Index + i];
+        registers[i] = LoadMemory(Index + i);
     }
 
 } // LD Vx, [I]
\ No newline at end of file
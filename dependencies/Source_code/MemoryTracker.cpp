@@ -0,0 +1,125 @@
+#include "MemoryTracker.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <vector>
+
+static const int ADDRESSES = sizes::numPages * sizes::pageSize;
+static const int MAP_WIDTH = 64; // Addresses per heatmap row and image row
+
+static int CountBits(const uint64_t *bits, int first, int count)
+{
+    int total = 0;
+    for (int address = first; address < first + count; address++)
+    {
+        total += (bits[address >> 6] >> (address & 63)) & 1u;
+    }
+    return total;
+}
+
+void MemoryTracker::Clear()
+{
+    std::fill(std::begin(executed), std::end(executed), 0);
+    std::fill(std::begin(read), std::end(read), 0);
+    std::fill(std::begin(written), std::end(written), 0);
+}
+
+MemoryTracker::PageKind MemoryTracker::Page(int page) const
+{
+    // Pages are a whole number of words
+    const int first = page * sizes::pageSize / 64;
+    uint64_t anyExecuted = 0, anyRead = 0, anyWritten = 0, modifiedCode = 0;
+    for (int word = first; word < first + sizes::pageSize / 64; word++)
+    {
+        anyExecuted |= executed[word];
+        anyRead |= read[word];
+        anyWritten |= written[word];
+        modifiedCode |= executed[word] & written[word];
+    }
+    if (modifiedCode)
+    {
+        return SELF_MODIFYING;
+    }
+    if (anyExecuted)
+    {
+        return anyRead || anyWritten ? MIXED : CODE;
+    }
+    return anyRead || anyWritten ? DATA : UNUSED;
+}
+
+bool MemoryTracker::SelfModifying() const
+{
+    for (int word = 0; word < WORDS; word++)
+    {
+        if (executed[word] & written[word])
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+void MemoryTracker::WriteHeatmap(std::ostream &out) const
+{
+    out << "x executed  r read  w written  c executed and read  W read and written  ! executed and written\n";
+    for (int row = 0; row < ADDRESSES; row += MAP_WIDTH)
+    {
+        char label[8];
+        std::snprintf(label, sizeof(label), "0x%03X ", row);
+        std::string line = label;
+        for (uint16_t address = row; address < row + MAP_WIDTH; address++)
+        {
+            const bool x = WasExecuted(address), r = WasRead(address), w = WasWritten(address);
+            line += x && w ? '!' : x && r ? 'c' : x ? 'x' : r && w ? 'W' : r ? 'r' : w ? 'w' : '.';
+        }
+        out << line << "\n";
+    }
+}
+
+void MemoryTracker::WritePageSummary(std::ostream &out) const
+{
+    static const char *const kinds[] = {"unused", "code", "data", "mixed", "self-modifying"};
+    out << "Page    Executed  Read  Written  Kind\n";
+    for (int page = 0; page < sizes::numPages; page++)
+    {
+        const PageKind kind = Page(page);
+        if (kind == UNUSED)
+        {
+            continue;
+        }
+        const int first = page * sizes::pageSize;
+        char line[80];
+        std::snprintf(line, sizeof(line), "0x%03X  %9d %5d %8d  %s", first, CountBits(executed, first, sizes::pageSize),
+                      CountBits(read, first, sizes::pageSize), CountBits(written, first, sizes::pageSize), kinds[kind]);
+        out << line << "\n";
+    }
+}
+
+bool MemoryTracker::WriteImage(const std::string &filename, int scale) const
+{
+    scale = std::max(1, scale);
+    const int width = MAP_WIDTH * scale;
+    const int height = ADDRESSES / MAP_WIDTH * scale;
+    std::vector<uint8_t> pixels(static_cast<size_t>(width) * height * 3);
+    for (int y = 0; y < height; y++)
+    {
+        for (int x = 0; x < width; x++)
+        {
+            const uint16_t address = static_cast<uint16_t>((y / scale) * MAP_WIDTH + x / scale);
+            uint8_t *pixel = &pixels[(static_cast<size_t>(y) * width + x) * 3];
+            pixel[0] = WasWritten(address) ? 255 : 0;
+            pixel[1] = WasExecuted(address) ? 255 : 0;
+            pixel[2] = WasRead(address) ? 255 : 0;
+        }
+    }
+    std::ofstream file(filename, std::ios::binary);
+    file << "P6\n" << width << " " << height << "\n255\n";
+    file.write(reinterpret_cast<const char *>(pixels.data()), static_cast<std::streamsize>(pixels.size()));
+    if (!file)
+    {
+        std::cout << "Error: could not write " << filename << "\n";
+        return false;
+    }
+    return true;
+}
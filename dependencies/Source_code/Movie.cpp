@@ -0,0 +1,200 @@
+#include "Movie.hpp"
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+
+// File layout (all integers little endian):
+//   "C8MV" | version u8 | quirks u8 | IPS u32 | seed u64 | romHash u64
+//   | finalHash u64 | frameCount u32 | eventCount u32 | events...
+// Each event is a LEB128 frame delta to the previous event followed by one
+// byte: bits 0-3 key, bit 4 pressed, bit 5 reset
+static const char MOVIE_MAGIC[4] = {'C', '8', 'M', 'V'};
+static const uint8_t MOVIE_VERSION = 1;
+
+static void WriteInt(std::ostream &out, uint64_t value, int size)
+{
+    for (int i = 0; i < size; i++)
+    {
+        out.put(static_cast<char>((value >> (8 * i)) & 0xFFu));
+    }
+}
+
+static bool ReadInt(std::istream &in, uint64_t &value, int size)
+{
+    value = 0;
+    for (int i = 0; i < size; i++)
+    {
+        int c = in.get();
+        if (c == EOF)
+        {
+            return false;
+        }
+        value |= static_cast<uint64_t>(c & 0xFF) << (8 * i);
+    }
+    return true;
+}
+
+Movie::Movie() : romHash{0}, seed{0}, finalHash{0}, IPS{500}, frameCount{0}, quirks{0}
+{
+}
+
+void Movie::Begin(const Chip8 &chip8, uint32_t IPS)
+{
+    romHash = chip8.RomHash();
+    seed = chip8.GetSeed();
+    this->IPS = IPS;
+    finalHash = 0;
+    frameCount = 0;
+    quirks = 0;
+    events.clear();
+}
+
+void Movie::RecordKey(uint32_t frame, uint8_t key, bool pressed)
+{
+    events.push_back(MovieEvent{frame, static_cast<uint8_t>(key & 0xFu), static_cast<uint8_t>(pressed), 0});
+}
+
+void Movie::RecordReset(uint32_t frame)
+{
+    events.push_back(MovieEvent{frame, 0, 0, 1});
+}
+
+void Movie::End(const Chip8 &chip8, uint32_t frameCount)
+{
+    this->frameCount = frameCount;
+    finalHash = chip8.StateHash();
+}
+
+bool Movie::Save(const std::string &filename) const
+{
+    std::ofstream file(filename, std::ios::binary);
+    if (!file.is_open())
+    {
+        std::cout << "Error opening movie file for writing: " << filename << "\n";
+        return false;
+    }
+    file.write(MOVIE_MAGIC, sizeof(MOVIE_MAGIC));
+    WriteInt(file, MOVIE_VERSION, 1);
+    WriteInt(file, quirks, 1);
+    WriteInt(file, IPS, 4);
+    WriteInt(file, seed, 8);
+    WriteInt(file, romHash, 8);
+    WriteInt(file, finalHash, 8);
+    WriteInt(file, frameCount, 4);
+    WriteInt(file, events.size(), 4);
+
+    uint32_t lastFrame = 0;
+    for (const MovieEvent &event : events)
+    {
+        uint32_t delta = event.frame - lastFrame;
+        lastFrame = event.frame;
+        do
+        {
+            uint8_t part = delta & 0x7Fu;
+            delta >>= 7u;
+            file.put(static_cast<char>(delta ? (part | 0x80u) : part));
+        } while (delta);
+        file.put(static_cast<char>(event.key | (event.pressed << 4u) | (event.reset << 5u)));
+    }
+    return static_cast<bool>(file);
+}
+
+bool Movie::Load(const std::string &filename)
+{
+    std::ifstream file(filename, std::ios::binary);
+    if (!file.is_open())
+    {
+        std::cout << "Error opening movie file: " << filename << "\n";
+        return false;
+    }
+    char magic[sizeof(MOVIE_MAGIC)];
+    uint64_t version, value, eventCount;
+    if (!file.read(magic, sizeof(magic)) ||
+        !std::equal(magic, magic + sizeof(magic), MOVIE_MAGIC) ||
+        !ReadInt(file, version, 1) || version != MOVIE_VERSION)
+    {
+        std::cout << "Error: " << filename << " is not a supported movie file\n";
+        return false;
+    }
+    bool ok = ReadInt(file, value, 1);
+    quirks = static_cast<uint8_t>(value);
+    ok = ok && ReadInt(file, value, 4);
+    IPS = static_cast<uint32_t>(value);
+    ok = ok && ReadInt(file, seed, 8) && ReadInt(file, romHash, 8) && ReadInt(file, finalHash, 8);
+    ok = ok && ReadInt(file, value, 4);
+    frameCount = static_cast<uint32_t>(value);
+    ok = ok && ReadInt(file, eventCount, 4);
+
+    events.clear();
+    uint32_t frame = 0;
+    for (uint64_t i = 0; ok && i < eventCount; i++)
+    {
+        uint32_t delta = 0;
+        int shift = 0;
+        int c;
+        do
+        {
+            c = file.get();
+            if (c == EOF || shift > 28)
+            {
+                ok = false;
+                break;
+            }
+            delta |= static_cast<uint32_t>(c & 0x7F) << shift;
+            shift += 7;
+        } while (c & 0x80);
+        int flags = file.get();
+        if (!ok || flags == EOF)
+        {
+            ok = false;
+            break;
+        }
+        frame += delta;
+        events.push_back(MovieEvent{frame, static_cast<uint8_t>(flags & 0xF),
+                                    static_cast<uint8_t>((flags >> 4) & 1), static_cast<uint8_t>((flags >> 5) & 1)});
+    }
+    if (!ok)
+    {
+        std::cout << "Error: movie file " << filename << " is truncated\n";
+    }
+    return ok;
+}
+
+size_t Movie::ApplyEvents(Chip8 &chip8, uint32_t frame, size_t next) const
+{
+    while (next < events.size() && events[next].frame <= frame)
+    {
+        const MovieEvent &event = events[next];
+        if (event.reset)
+        {
+            chip8.Reset();
+        }
+        else
+        {
+            chip8.keypad[event.key] = event.pressed;
+        }
+        next++;
+    }
+    return next;
+}
+
+uint64_t Movie::PlayHeadless(Chip8 &chip8, TraceWriter *trace) const
+{
+    // Same per frame order as Display::RunChip: input, IPS / 60 cycles, timers
+    size_t next = 0;
+    for (uint32_t frame = 0; frame < frameCount; frame++)
+    {
+        next = ApplyEvents(chip8, frame, next);
+        for (uint32_t i = 0; i < IPS / 60; i++)
+        {
+            if (trace)
+            {
+                trace->Record(chip8);
+            }
+            chip8.Cycle();
+        }
+        chip8.screenUpdate = false;
+        chip8.UpdateTimers();
+    }
+    return chip8.StateHash();
+}
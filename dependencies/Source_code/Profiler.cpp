@@ -0,0 +1,195 @@
+#include "Profiler.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <string>
+
+// Deeper calls are still counted as edges but stay in the deepest frame
+static const uint32_t MAX_STACK_DEPTH = 64;
+
+static std::string Hex(unsigned value, int digits)
+{
+    char text[8];
+    std::snprintf(text, sizeof(text), "%0*X", digits, value);
+    return text;
+}
+
+static std::string Percent(uint64_t count, uint64_t total)
+{
+    char text[16];
+    std::snprintf(text, sizeof(text), "%6.2f%%", total ? 100.0 * count / total : 0.0);
+    return text;
+}
+
+Profiler::Profiler()
+{
+    Clear();
+}
+
+void Profiler::Clear()
+{
+    instructions = 0;
+    std::fill(std::begin(pcCounts), std::end(pcCounts), 0);
+    std::fill(std::begin(pcOpcodes), std::end(pcOpcodes), 0);
+    std::fill(std::begin(classCounts), std::end(classCounts), 0);
+    undecoded.clear();
+    callEdges.clear();
+    nodes.assign(1, StackNode{0, 0, 0, 0});
+    children.clear();
+    current = 0;
+    unmatchedReturns = 0;
+}
+
+void Profiler::Record(uint16_t pc, uint16_t opcode)
+{
+    const uint16_t address = pc & 0xFFFu;
+    const disasm::OpcodeClass opcodeClass = disasm::Classify(opcode);
+    instructions++;
+    pcCounts[address]++;
+    pcOpcodes[address] = opcode;
+    classCounts[opcodeClass]++;
+    nodes[current].instructions++;
+
+    switch (opcodeClass)
+    {
+    case disasm::OPC_2nnn:
+    {
+        const uint16_t target = opcode & 0xFFFu;
+        callEdges[(static_cast<uint32_t>(address) << 16u) | target]++;
+        if (nodes[current].depth >= MAX_STACK_DEPTH)
+        {
+            break;
+        }
+        const uint64_t key = (static_cast<uint64_t>(current) << 16u) | target;
+        auto child = children.find(key);
+        if (child == children.end())
+        {
+            nodes.push_back(StackNode{current, target, nodes[current].depth + 1, 0});
+            child = children.emplace(key, static_cast<uint32_t>(nodes.size() - 1)).first;
+        }
+        current = child->second;
+        break;
+    }
+    case disasm::OPC_00EE:
+        if (current == 0)
+        {
+            unmatchedReturns++;
+        }
+        else
+        {
+            current = nodes[current].parent;
+        }
+        break;
+    case disasm::OPC_UNDECODED:
+        undecoded.try_emplace(opcode, Undecoded{0, address}).first->second.count++;
+        break;
+    default:
+        break;
+    }
+}
+
+void Profiler::WriteOpcodeClasses(std::ostream &out) const
+{
+    std::vector<int> order;
+    for (int i = 0; i < disasm::NUM_OPCODE_CLASSES; i++)
+    {
+        if (classCounts[i])
+        {
+            order.push_back(i);
+        }
+    }
+    std::sort(order.begin(), order.end(), [&](int a, int b) { return classCounts[a] > classCounts[b]; });
+    out << "Opcode   Instructions        %\n";
+    for (int i : order)
+    {
+        const disasm::OpcodeClass opcodeClass = static_cast<disasm::OpcodeClass>(i);
+        char line[64];
+        std::snprintf(line, sizeof(line), "%-6s %14llu  ", disasm::ClassName(opcodeClass),
+                      static_cast<unsigned long long>(classCounts[i]));
+        out << line << Percent(classCounts[i], instructions) << "\n";
+    }
+}
+
+void Profiler::WriteHotSpots(std::ostream &out, size_t top) const
+{
+    std::vector<uint16_t> order;
+    for (uint16_t address = 0; address < sizes::memSize; address++)
+    {
+        if (pcCounts[address])
+        {
+            order.push_back(address);
+        }
+    }
+    top = std::min(top, order.size());
+    std::partial_sort(order.begin(), order.begin() + top, order.end(),
+                      [&](uint16_t a, uint16_t b) { return pcCounts[a] > pcCounts[b]; });
+    out << "Address  Instructions        %  Opcode  Disassembly\n";
+    for (size_t i = 0; i < top; i++)
+    {
+        const uint16_t address = order[i];
+        char line[64];
+        std::snprintf(line, sizeof(line), "0x%03X  %14llu  ", address,
+                      static_cast<unsigned long long>(pcCounts[address]));
+        out << line << Percent(pcCounts[address], instructions) << "  " << Hex(pcOpcodes[address], 4) << "    "
+            << disasm::Disassemble(pcOpcodes[address]) << "\n";
+    }
+}
+
+void Profiler::WriteCallGraph(std::ostream &out) const
+{
+    std::vector<std::pair<uint32_t, uint64_t>> edges(callEdges.begin(), callEdges.end());
+    std::sort(edges.begin(), edges.end(), [](const auto &a, const auto &b) { return a.second > b.second; });
+    out << "Call site  Target          Calls\n";
+    for (const auto &edge : edges)
+    {
+        char line[64];
+        std::snprintf(line, sizeof(line), "0x%03X   -> 0x%03X %14llu", edge.first >> 16u, edge.first & 0xFFFu,
+                      static_cast<unsigned long long>(edge.second));
+        out << line << "\n";
+    }
+    if (unmatchedReturns)
+    {
+        out << unmatchedReturns << " RETs without a matching CALL\n";
+    }
+}
+
+void Profiler::WriteUndecoded(std::ostream &out) const
+{
+    if (undecoded.empty())
+    {
+        out << "No undecoded opcodes\n";
+        return;
+    }
+    std::vector<std::pair<uint16_t, Undecoded>> opcodes(undecoded.begin(), undecoded.end());
+    std::sort(opcodes.begin(), opcodes.end(), [](const auto &a, const auto &b) { return a.second.count > b.second.count; });
+    out << "Opcode      Count  First at\n";
+    for (const auto &opcode : opcodes)
+    {
+        char line[64];
+        std::snprintf(line, sizeof(line), "%04X %12llu  0x%03X", opcode.first,
+                      static_cast<unsigned long long>(opcode.second.count), opcode.second.firstPC);
+        out << line << "\n";
+    }
+}
+
+void Profiler::WriteStack(std::ostream &out, uint32_t node) const
+{
+    if (node == 0)
+    {
+        out << "main";
+        return;
+    }
+    WriteStack(out, nodes[node].parent);
+    out << ";sub_" << Hex(nodes[node].function, 3);
+}
+
+void Profiler::WriteCollapsedStacks(std::ostream &out) const
+{
+    for (uint32_t node = 0; node < nodes.size(); node++)
+    {
+        if (nodes[node].instructions)
+        {
+            WriteStack(out, node);
+            out << " " << nodes[node].instructions << "\n";
+        }
+    }
+}
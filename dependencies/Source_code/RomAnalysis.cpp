@@ -0,0 +1,675 @@
+#include "RomAnalysis.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include "Disassembler.hpp"
+
+static const uint16_t NO_BLOCK = 0xFFFF;
+static const int32_t UNSEEN_INDEX = -2;
+static const int32_t UNKNOWN_INDEX = -1;
+
+// How Chip8 itself behaves (Instructions/ProdFunctions.cpp): shifts work on
+// Vx, Fx55/Fx65 leave I alone and Bnnn adds V0
+static const RomAnalysis::Profile CORE_QUIRKS[RomAnalysis::NUM_QUIRKS] = {RomAnalysis::SCHIP, RomAnalysis::SCHIP,
+                                                                          RomAnalysis::CHIP8};
+
+static bool IsSkip(disasm::OpcodeClass opcodeClass)
+{
+    switch (opcodeClass)
+    {
+    case disasm::OPC_3xkk:
+    case disasm::OPC_4xkk:
+    case disasm::OPC_5xy0:
+    case disasm::OPC_9xy0:
+    case disasm::OPC_Ex9E:
+    case disasm::OPC_ExA1:
+        return true;
+    default:
+        return false;
+    }
+}
+
+static bool EndsBlock(disasm::OpcodeClass opcodeClass)
+{
+    return IsSkip(opcodeClass) || opcodeClass == disasm::OPC_1nnn || opcodeClass == disasm::OPC_2nnn ||
+           opcodeClass == disasm::OPC_00EE || opcodeClass == disasm::OPC_Bnnn;
+}
+
+// 00Cn, 00FB-00FF, Fx30, Fx75 and Fx85 only exist on SCHIP
+static bool IsSchipOnly(uint16_t opcode)
+{
+    if ((opcode & 0xFFF0u) == 0x00C0u || (opcode >= 0x00FBu && opcode <= 0x00FFu))
+    {
+        return true;
+    }
+    const uint16_t low = opcode & 0xF0FFu;
+    return low == 0xF030u || low == 0xF075u || low == 0xF085u;
+}
+
+template <typename T>
+static void SortUnique(std::vector<T> &values)
+{
+    std::sort(values.begin(), values.end());
+    values.erase(std::unique(values.begin(), values.end()), values.end());
+}
+
+std::shared_ptr<const RomAnalysis> RomAnalysis::Get(const Chip8 &chip8)
+{
+    static std::mutex lock;
+    static std::multimap<uint64_t, std::weak_ptr<const RomAnalysis>> analyses;
+
+    std::shared_ptr<const RomImage> image = chip8.Image();
+    std::lock_guard<std::mutex> guard(lock);
+    auto range = analyses.equal_range(image->RomHash());
+    for (auto it = range.first; it != range.second;)
+    {
+        std::shared_ptr<const RomAnalysis> analysis = it->second.lock();
+        if (!analysis)
+        {
+            it = analyses.erase(it);
+            continue;
+        }
+        // Images are shared per ROM, so the same bytes mean the same image
+        if (analysis->image == image)
+        {
+            return analysis;
+        }
+        ++it;
+    }
+    auto analysis = std::make_shared<const RomAnalysis>(image, Chip8::StartAddress());
+    analyses.emplace(image->RomHash(), analysis);
+    return analysis;
+}
+
+RomAnalysis::RomAnalysis(std::shared_ptr<const RomImage> image, uint16_t romAddress) : image{std::move(image)},
+    romStart{romAddress}, romEnd{static_cast<uint16_t>(romAddress + this->image->RomSize())}, unresolvedWrites{0},
+    votes{}, schipOpcodes{0}
+{
+    std::fill(std::begin(flags), std::end(flags), 0);
+    std::fill(std::begin(blockIndex), std::end(blockIndex), NO_BLOCK);
+    Traverse();
+    BuildBlocks();
+    ScanBlocks();
+    FindData();
+}
+
+uint8_t RomAnalysis::Byte(uint16_t address) const
+{
+    address &= 0xFFFu;
+    return image->Page(address / sizes::pageSize)[address % sizes::pageSize];
+}
+
+void RomAnalysis::Traverse()
+{
+    if (!InRom(romStart))
+    {
+        return;
+    }
+    std::vector<uint16_t> pending{romStart};
+    flags[romStart] |= LEADER;
+    // An address reached a second time has several predecessors and starts
+    // a block, as does every jump, call and skip target
+    auto follow = [&](uint16_t from, uint16_t to, bool leader)
+    {
+        to &= 0xFFFu;
+        if (!InRom(to))
+        {
+            leavesRom.push_back(from);
+            return;
+        }
+        if (leader || (flags[to] & CODE))
+        {
+            flags[to] |= LEADER;
+        }
+        if (!(flags[to] & CODE))
+        {
+            pending.push_back(to);
+        }
+    };
+
+    while (!pending.empty())
+    {
+        const uint16_t address = pending.back();
+        pending.pop_back();
+        if (flags[address] & CODE)
+        {
+            flags[address] |= LEADER;
+            continue;
+        }
+        flags[address] |= CODE;
+        // Odd and even streams decoding the same bytes
+        for (uint16_t neighbour : {static_cast<uint16_t>((address - 1) & 0xFFFu), static_cast<uint16_t>((address + 1) & 0xFFFu)})
+        {
+            if (flags[neighbour] & CODE)
+            {
+                flags[neighbour] |= OVERLAP;
+                flags[address] |= OVERLAP;
+            }
+        }
+
+        const uint16_t opcode = Opcode(address);
+        const uint16_t nnn = opcode & 0xFFFu;
+        const disasm::OpcodeClass opcodeClass = disasm::Classify(opcode);
+        switch (opcodeClass)
+        {
+        case disasm::OPC_1nnn:
+            follow(address, nnn, true);
+            break;
+        case disasm::OPC_2nnn:
+            if (InRom(nnn))
+            {
+                functions.push_back(nnn);
+            }
+            follow(address, nnn, true);
+            follow(address, address + 2, true);
+            break;
+        case disasm::OPC_00EE:
+            break;
+        case disasm::OPC_Bnnn:
+            indirect.push_back(address);
+            break;
+        default:
+            if (IsSkip(opcodeClass))
+            {
+                follow(address, address + 2, true);
+                follow(address, address + 4, true);
+                break;
+            }
+            if (opcodeClass == disasm::OPC_UNDECODED)
+            {
+                undecoded.push_back(address);
+            }
+            follow(address, address + 2, false);
+            break;
+        }
+    }
+    SortUnique(functions);
+    SortUnique(indirect);
+    SortUnique(undecoded);
+    SortUnique(leavesRom);
+}
+
+void RomAnalysis::BuildBlocks()
+{
+    auto edge = [&](uint16_t from, uint16_t to, EdgeKind kind)
+    {
+        to &= 0xFFFu;
+        if (InRom(to) && (flags[to] & CODE))
+        {
+            edges.push_back(Edge{from, to, kind});
+        }
+    };
+
+    for (uint16_t start = romStart; start < romEnd; start++)
+    {
+        if (!(flags[start] & LEADER))
+        {
+            continue;
+        }
+        const uint16_t index = static_cast<uint16_t>(blocks.size());
+        uint16_t at = start;
+        while (true)
+        {
+            blockIndex[at] = index;
+            const uint16_t opcode = Opcode(at);
+            const disasm::OpcodeClass opcodeClass = disasm::Classify(opcode);
+            const uint16_t next = (at + 2) & 0xFFFu;
+            if (EndsBlock(opcodeClass))
+            {
+                if (opcodeClass == disasm::OPC_1nnn)
+                {
+                    edge(start, opcode, JUMP);
+                }
+                else if (opcodeClass == disasm::OPC_2nnn)
+                {
+                    edge(start, opcode, CALL);
+                    edge(start, next, NEXT);
+                }
+                else if (IsSkip(opcodeClass))
+                {
+                    edge(start, next, NEXT);
+                    edge(start, next + 2, SKIP);
+                }
+                break;
+            }
+            if (!InRom(next) || !(flags[next] & CODE))
+            {
+                break; // Runs off the end of the ROM
+            }
+            if (flags[next] & LEADER)
+            {
+                edge(start, next, NEXT);
+                break;
+            }
+            at = next;
+        }
+        blocks.push_back(BasicBlock{start, static_cast<uint16_t>(at + 2), at});
+    }
+}
+
+int32_t RomAnalysis::IndexAfter(const BasicBlock &block, int32_t index) const
+{
+    for (uint16_t at = block.start; at != block.end; at = (at + 2) & 0xFFFu)
+    {
+        switch (disasm::Classify(Opcode(at)))
+        {
+        case disasm::OPC_Annn: index = Opcode(at) & 0xFFFu; break;
+        case disasm::OPC_Fx1E:
+        case disasm::OPC_Fx29: index = UNKNOWN_INDEX; break;
+        default: break;
+        }
+    }
+    return index;
+}
+
+void RomAnalysis::PropagateIndex(std::vector<int32_t> &entry) const
+{
+    // Constant propagation of I over the CFG: the value a block is entered
+    // with is known when every way in agrees. Reset clears I, a call may
+    // change it before returning, Bnnn targets aren't in the graph at all.
+    // Each block changes at most twice (unseen, constant, unknown)
+    entry.assign(blocks.size(), UNSEEN_INDEX);
+    if (blocks.empty() || !IsCode(romStart))
+    {
+        return;
+    }
+    std::vector<uint16_t> pending{blockIndex[romStart]};
+    entry[blockIndex[romStart]] = 0;
+    while (!pending.empty())
+    {
+        const uint16_t index = pending.back();
+        pending.pop_back();
+        const BasicBlock &block = blocks[index];
+        const int32_t exit = IndexAfter(block, entry[index]);
+        const bool call = disasm::Classify(Opcode(block.last)) == disasm::OPC_2nnn;
+        // Edges are in block order
+        auto first = std::lower_bound(edges.begin(), edges.end(), block.start,
+                                      [](const Edge &edge, uint16_t start) { return edge.from < start; });
+        for (auto edge = first; edge != edges.end() && edge->from == block.start; ++edge)
+        {
+            const int32_t value = call && edge->kind == NEXT ? UNKNOWN_INDEX : exit;
+            const uint16_t target = blockIndex[edge->to];
+            const int32_t merged = entry[target] == UNSEEN_INDEX || entry[target] == value ? value : UNKNOWN_INDEX;
+            if (merged != entry[target])
+            {
+                entry[target] = merged;
+                pending.push_back(target);
+            }
+        }
+    }
+}
+
+void RomAnalysis::ScanBlocks()
+{
+    std::vector<int32_t> entry;
+    PropagateIndex(entry);
+    for (const BasicBlock &block : blocks)
+    {
+        const int32_t entryIndex = entry[&block - blocks.data()];
+        bool knownIndex = entryIndex >= 0;
+        uint16_t index = static_cast<uint16_t>(knownIndex ? entryIndex : 0);
+        bool afterLoadStore = false; // I not reloaded since Fx55/Fx65
+        uint16_t lastSet[sizes::numRegisters] = {}; // Instruction number of the last write in this block, 0 for none
+        uint16_t step = 0;
+        for (uint16_t at = block.start; at != block.end; at = (at + 2) & 0xFFFu)
+        {
+            step++;
+            const uint16_t opcode = Opcode(at);
+            const unsigned x = (opcode >> 8u) & 0xFu;
+            const unsigned y = (opcode >> 4u) & 0xFu;
+            if (IsSchipOnly(opcode))
+            {
+                schipOpcodes++;
+            }
+            switch (disasm::Classify(opcode))
+            {
+            case disasm::OPC_Annn:
+                knownIndex = true;
+                index = opcode & 0xFFFu;
+                afterLoadStore = false;
+                flags[index] |= DATA_REF;
+                break;
+            case disasm::OPC_Fx1E:
+                // Stepping I by hand past what was just stored or loaded
+                votes[QUIRK_LOAD_STORE][1] += afterLoadStore;
+                afterLoadStore = false;
+                knownIndex = false;
+                break;
+            case disasm::OPC_Fx29:
+                afterLoadStore = false;
+                knownIndex = false;
+                break;
+            case disasm::OPC_Dxyn:
+                // Using I again as if it had moved on
+                votes[QUIRK_LOAD_STORE][0] += afterLoadStore;
+                afterLoadStore = false;
+                break;
+            case disasm::OPC_Fx33:
+            case disasm::OPC_Fx55:
+            {
+                votes[QUIRK_LOAD_STORE][0] += afterLoadStore;
+                const bool bcd = (opcode & 0xFFu) == 0x33u;
+                if (!knownIndex)
+                {
+                    unresolvedWrites++;
+                }
+                else
+                {
+                    const unsigned length = bcd ? 3 : x + 1;
+                    for (unsigned i = 0; i < length; i++)
+                    {
+                        const uint16_t target = (index + i) & 0xFFFu;
+                        if (IsCode(target) || IsCode((target - 1) & 0xFFFu))
+                        {
+                            codeWrites.emplace_back(at, target);
+                        }
+                    }
+                }
+                afterLoadStore = !bcd;
+                break;
+            }
+            case disasm::OPC_Fx65:
+                votes[QUIRK_LOAD_STORE][0] += afterLoadStore;
+                afterLoadStore = true;
+                std::fill(lastSet, lastSet + x + 1, step);
+                break;
+            case disasm::OPC_8xy6:
+            case disasm::OPC_8xyE:
+                // SCHIP code names no second register (8x06), CHIP-8 code
+                // shifts another register into Vx
+                if (y != x)
+                {
+                    votes[QUIRK_SHIFT][y == 0 ? 1 : 0]++;
+                }
+                lastSet[x] = lastSet[0xF] = step;
+                break;
+            case disasm::OPC_Bnnn:
+                // Which register was computed last: Vx for Bxnn, V0 for Bnnn
+                if (x != 0 && lastSet[x] > lastSet[0])
+                {
+                    votes[QUIRK_JUMP][1]++;
+                }
+                else if (lastSet[0] > 0)
+                {
+                    votes[QUIRK_JUMP][0]++;
+                }
+                break;
+            case disasm::OPC_6xkk:
+            case disasm::OPC_7xkk:
+            case disasm::OPC_8xy0:
+            case disasm::OPC_8xy1:
+            case disasm::OPC_8xy2:
+            case disasm::OPC_8xy3:
+            case disasm::OPC_8xy4:
+            case disasm::OPC_8xy5:
+            case disasm::OPC_8xy7:
+            case disasm::OPC_Cxkk:
+            case disasm::OPC_Fx07:
+            case disasm::OPC_Fx0A:
+                lastSet[x] = step;
+                break;
+            default:
+                break;
+            }
+        }
+    }
+    SortUnique(codeWrites);
+}
+
+void RomAnalysis::FindData()
+{
+    for (uint16_t address = romStart; address < romEnd; address++)
+    {
+        if (IsCode(address) || IsCode((address - 1) & 0xFFFu))
+        {
+            continue;
+        }
+        const bool referenced = flags[address] & DATA_REF;
+        if (!data.empty() && data.back().end == address)
+        {
+            data.back().end++;
+            data.back().referenced |= referenced;
+        }
+        else
+        {
+            data.push_back(DataRange{address, static_cast<uint16_t>(address + 1), referenced});
+        }
+    }
+}
+
+const RomAnalysis::BasicBlock *RomAnalysis::BlockAt(uint16_t address) const
+{
+    const uint16_t index = blockIndex[address & 0xFFFu];
+    return index == NO_BLOCK ? nullptr : &blocks[index];
+}
+
+RomAnalysis::Modification RomAnalysis::SelfModifying() const
+{
+    if (!codeWrites.empty())
+    {
+        return CERTAIN;
+    }
+    return unresolvedWrites > 0 ? POSSIBLE : NONE;
+}
+
+RomAnalysis::Profile RomAnalysis::GuessProfile() const
+{
+    if (schipOpcodes > 0)
+    {
+        return SCHIP;
+    }
+    uint32_t chip8 = 0, schip = 0;
+    for (int quirk = 0; quirk < NUM_QUIRKS; quirk++)
+    {
+        chip8 += votes[quirk][0];
+        schip += votes[quirk][1];
+    }
+    if (chip8 == schip)
+    {
+        return ANY;
+    }
+    return chip8 > schip ? CHIP8 : SCHIP;
+}
+
+const char *RomAnalysis::ProfileName(Profile profile)
+{
+    switch (profile)
+    {
+    case CHIP8: return "CHIP-8";
+    case SCHIP: return "SCHIP";
+    default: return "any";
+    }
+}
+
+const char *RomAnalysis::QuirkName(Quirk quirk)
+{
+    switch (quirk)
+    {
+    case QUIRK_SHIFT: return "shift (8xy6/8xyE)";
+    case QUIRK_LOAD_STORE: return "load/store I (Fx55/Fx65)";
+    case QUIRK_JUMP: return "jump (Bnnn)";
+    default: return "?";
+    }
+}
+
+static void WriteAddresses(std::ostream &out, const char *title, const std::vector<uint16_t> &addresses)
+{
+    if (addresses.empty())
+    {
+        return;
+    }
+    out << title << ":";
+    char text[8];
+    for (size_t i = 0; i < addresses.size() && i < 16; i++)
+    {
+        std::snprintf(text, sizeof(text), " 0x%03X", addresses[i]);
+        out << text;
+    }
+    out << (addresses.size() > 16 ? " ...\n" : "\n");
+}
+
+void RomAnalysis::WriteSummary(std::ostream &out) const
+{
+    char line[128];
+    std::snprintf(line, sizeof(line), "ROM 0x%03X-0x%03X (%u bytes), hash %016llx", romStart, romEnd - 1,
+                  romEnd - romStart, static_cast<unsigned long long>(RomHash()));
+    out << line << "\n";
+
+    size_t instructions = 0, dataBytes = 0;
+    std::vector<uint16_t> overlapping;
+    for (uint16_t address = romStart; address < romEnd; address++)
+    {
+        instructions += IsCode(address);
+        if (Overlaps(address))
+        {
+            overlapping.push_back(address);
+        }
+    }
+    for (const DataRange &range : data)
+    {
+        dataBytes += range.end - range.start;
+    }
+    out << "Code: " << instructions << " instructions in " << blocks.size() << " blocks, " << functions.size()
+        << " functions; " << dataBytes << " bytes in " << data.size() << " ranges not reached as code\n";
+    WriteAddresses(out, "Indirect jumps (JP V0, nnn), code only reached through them is missing", indirect);
+    WriteAddresses(out, "Undecoded opcodes reached (Chip8 runs them as no-ops)", undecoded);
+    WriteAddresses(out, "Control flow leaving the ROM", leavesRom);
+    WriteAddresses(out, "Instructions overlapping other instructions", overlapping);
+
+    switch (SelfModifying())
+    {
+    case NONE:
+        out << "Self-modifying: no\n";
+        break;
+    case POSSIBLE:
+        out << "Self-modifying: possibly, " << unresolvedWrites << " Fx33/Fx55 write through an I that isn't constant\n";
+        break;
+    case CERTAIN:
+        out << "Self-modifying: yes";
+        for (size_t i = 0; i < codeWrites.size() && i < 8; i++)
+        {
+            std::snprintf(line, sizeof(line), "%s 0x%03X writes 0x%03X", i == 0 ? "," : ";", codeWrites[i].first,
+                          codeWrites[i].second);
+            out << line;
+        }
+        out << (codeWrites.size() > 8 ? " ...\n" : "\n");
+        break;
+    }
+
+    out << "Quirk evidence                 CHIP-8  SCHIP  this core\n";
+    std::vector<Quirk> mismatched;
+    for (int quirk = 0; quirk < NUM_QUIRKS; quirk++)
+    {
+        std::snprintf(line, sizeof(line), "  %-28s %6u %6u  %s", QuirkName(static_cast<Quirk>(quirk)), votes[quirk][0],
+                      votes[quirk][1], ProfileName(CORE_QUIRKS[quirk]));
+        out << line << "\n";
+        const uint32_t against = votes[quirk][CORE_QUIRKS[quirk] == CHIP8 ? 1 : 0];
+        const uint32_t towards = votes[quirk][CORE_QUIRKS[quirk] == CHIP8 ? 0 : 1];
+        if (against > towards)
+        {
+            mismatched.push_back(static_cast<Quirk>(quirk));
+        }
+    }
+    if (schipOpcodes > 0)
+    {
+        out << "SCHIP only opcodes: " << schipOpcodes << " (Chip8 runs them as no-ops)\n";
+    }
+    out << "Guessed profile: " << ProfileName(GuessProfile()) << "\n";
+    for (Quirk quirk : mismatched)
+    {
+        out << "Warning: the ROM seems to expect the other " << QuirkName(quirk) << " behaviour\n";
+    }
+}
+
+void RomAnalysis::WriteListing(std::ostream &out) const
+{
+    static const char *const kinds[] = {"next", "jump", "call", "skip"};
+    char line[64];
+    auto block = blocks.begin();
+    auto range = data.begin();
+    while (block != blocks.end() || range != data.end())
+    {
+        if (range == data.end() || (block != blocks.end() && block->start < range->start))
+        {
+            std::snprintf(line, sizeof(line), "block 0x%03X-0x%03X%s", block->start, block->last,
+                          std::binary_search(functions.begin(), functions.end(), block->start) ? "  function" : "");
+            out << line << "\n";
+            for (uint16_t at = block->start; at != block->end; at = (at + 2) & 0xFFFu)
+            {
+                std::snprintf(line, sizeof(line), "  0x%03X  %04X  ", at, Opcode(at));
+                out << line << disasm::Disassemble(Opcode(at)) << "\n";
+            }
+            out << "  ->";
+            bool any = false;
+            for (const Edge &edge : edges)
+            {
+                if (edge.from == block->start)
+                {
+                    std::snprintf(line, sizeof(line), " 0x%03X %s", edge.to, kinds[edge.kind]);
+                    out << line;
+                    any = true;
+                }
+            }
+            const disasm::OpcodeClass last = disasm::Classify(Opcode(block->last));
+            out << (last == disasm::OPC_00EE ? " return" : last == disasm::OPC_Bnnn ? " indirect" : any ? "" : " end") << "\n";
+            ++block;
+        }
+        else
+        {
+            std::snprintf(line, sizeof(line), "data 0x%03X-0x%03X%s", range->start, range->end - 1,
+                          range->referenced ? "  referenced by LD I" : "");
+            out << line << "\n";
+            for (uint16_t at = range->start; at < range->end; at += 16)
+            {
+                std::snprintf(line, sizeof(line), "  0x%03X ", at);
+                out << line;
+                for (uint16_t i = at; i < range->end && i < at + 16; i++)
+                {
+                    std::snprintf(line, sizeof(line), " %02X", Byte(i));
+                    out << line;
+                }
+                out << "\n";
+            }
+            ++range;
+        }
+    }
+}
+
+bool RomAnalysis::WriteDot(const std::string &filename) const
+{
+    static const char *const styles[] = {"", " [style=bold]", " [style=dashed]", " [label=skip]"};
+    std::ofstream file(filename);
+    file << "digraph rom {\n  node [shape=box fontname=monospace];\n";
+    char line[64];
+    for (const BasicBlock &block : blocks)
+    {
+        std::snprintf(line, sizeof(line), "  b%03X [label=\"", block.start);
+        file << line;
+        for (uint16_t at = block.start; at != block.end; at = (at + 2) & 0xFFFu)
+        {
+            std::snprintf(line, sizeof(line), "%03X  ", at);
+            file << line << disasm::Disassemble(Opcode(at)) << "\\l";
+        }
+        file << "\"" << (std::binary_search(functions.begin(), functions.end(), block.start) ? " peripheries=2" : "")
+             << "];\n";
+    }
+    for (const Edge &edge : edges)
+    {
+        const BasicBlock *target = BlockAt(edge.to);
+        if (target)
+        {
+            std::snprintf(line, sizeof(line), "  b%03X -> b%03X%s;\n", edge.from, target->start, styles[edge.kind]);
+            file << line;
+        }
+    }
+    file << "}\n";
+    if (!file)
+    {
+        std::cout << "Error: could not write " << filename << "\n";
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,57 @@
+#include "RomImage.hpp"
+#include <algorithm>
+#include <cstring>
+#include <map>
+#include <mutex>
+
+extern const int FONTSET_SIZE;
+extern const uint16_t FONTSET_START_ADDRESS;
+extern const uint8_t fontset[];
+
+uint64_t Fnv1a(const void *data, size_t size, uint64_t hash)
+{
+    const uint8_t *bytes = static_cast<const uint8_t *>(data);
+    for (size_t i = 0; i < size; ++i)
+    {
+        hash ^= bytes[i];
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+RomImage::RomImage(const byte *rom, size_t size, uint16_t romAddress) : romHash{Fnv1a(rom, size)}, romSize{size}
+{
+    std::memset(data, 0, sizeof(data));
+    std::memcpy(data + FONTSET_START_ADDRESS, fontset, FONTSET_SIZE);
+    if (size > 0)
+    {
+        std::memcpy(data + romAddress, rom, size);
+    }
+}
+
+std::shared_ptr<const RomImage> RomImage::Get(const byte *rom, size_t size, uint16_t romAddress)
+{
+    static std::mutex lock;
+    static std::multimap<uint64_t, std::weak_ptr<const RomImage>> images;
+
+    const uint64_t hash = Fnv1a(rom, size);
+    std::lock_guard<std::mutex> guard(lock);
+    auto range = images.equal_range(hash);
+    for (auto it = range.first; it != range.second;)
+    {
+        std::shared_ptr<const RomImage> image = it->second.lock();
+        if (!image)
+        {
+            it = images.erase(it);
+            continue;
+        }
+        if (image->romSize == size && std::memcmp(image->data + romAddress, rom, size) == 0)
+        {
+            return image;
+        }
+        ++it;
+    }
+    auto image = std::make_shared<const RomImage>(rom, size, romAddress);
+    images.emplace(hash, image);
+    return image;
+}
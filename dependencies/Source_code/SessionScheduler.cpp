@@ -0,0 +1,363 @@
+#include "SessionScheduler.hpp"
+#include <algorithm>
+#include <limits>
+
+// Sessions that fall this many frames behind skip ahead instead of trying
+// to catch up, the skipped frames count as missed
+static const int MAX_FRAMES_BEHIND = 4;
+
+SessionScheduler::SessionScheduler(uint32_t capacity, uint32_t threads) :
+    pool{capacity}, running{false}, steals{0}, nextRelease{std::numeric_limits<clock::rep>::max()}, readyTotal{0},
+    idleWorkers{0}, timekeeper{false}
+{
+    if (threads == 0)
+    {
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    for (uint32_t i = 0; i < threads; i++)
+    {
+        workers.push_back(std::make_unique<Worker>());
+    }
+}
+
+SessionScheduler::~SessionScheduler()
+{
+    Stop();
+    for (const std::unique_ptr<Session> &session : sessions)
+    {
+        pool.Release(session->machine);
+    }
+}
+
+SessionScheduler::clock::duration SessionScheduler::FramePeriod()
+{
+    return std::chrono::duration_cast<clock::duration>(std::chrono::nanoseconds(1000000000 / 60));
+}
+
+int SessionScheduler::AddSession(const uint8_t *rom, size_t size, uint32_t IPS, uint64_t seed)
+{
+    if (IPS < 60)
+    {
+        // Fewer than one cycle per frame would never run the ROM
+        return -1;
+    }
+    std::lock_guard<std::mutex> guard(sessionsLock);
+    Chip8 *machine = pool.Acquire();
+    if (!machine)
+    {
+        return -1;
+    }
+    machine->Seed(seed);
+    if (machine->LoadRom(rom, size) < 0)
+    {
+        pool.Release(machine);
+        return -1;
+    }
+    auto session = std::make_unique<Session>();
+    session->machine = machine;
+    session->cyclesPerFrame = IPS / 60;
+    session->home = static_cast<uint32_t>(sessions.size() % workers.size());
+    session->keys = 0;
+    session->appliedKeys = 0;
+    session->parked = false;
+    session->idle = false;
+    session->frames = 0;
+    session->idleFrames = 0;
+    session->missed = 0;
+    session->maxLatenessUs = 0;
+    Session *raw = session.get();
+    sessions.push_back(std::move(session));
+    Enqueue(raw, clock::now());
+    return static_cast<int>(sessions.size() - 1);
+}
+
+void SessionScheduler::SetKeys(int id, uint16_t keys)
+{
+    Session *session;
+    {
+        std::lock_guard<std::mutex> guard(sessionsLock);
+        if (id < 0 || static_cast<size_t>(id) >= sessions.size())
+        {
+            return;
+        }
+        session = sessions[id].get();
+    }
+    session->keys.store(keys);
+    // Whoever flips parked back to false owns re-queueing the session
+    bool wasParked = true;
+    if (session->parked.compare_exchange_strong(wasParked, false))
+    {
+        Enqueue(session, clock::now());
+    }
+}
+
+void SessionScheduler::Enqueue(Session *session, clock::time_point release)
+{
+    session->release = release;
+    if (release <= clock::now())
+    {
+        if (MakeReady(session))
+        {
+            WakeIdle();
+        }
+        return;
+    }
+    std::lock_guard<std::mutex> guard(timerLock);
+    sleeping.push_back(session);
+    std::push_heap(sleeping.begin(), sleeping.end(), ReleaseLater);
+    if (sleeping.front() != session)
+    {
+        return;
+    }
+    nextRelease.store(release.time_since_epoch().count());
+    // The earliest release changed: the timekeeper has to wait for the new
+    // one, or an idle worker has to become the timekeeper
+    if (timekeeper)
+    {
+        timerWake.notify_one();
+    }
+    else if (idleWorkers > 0)
+    {
+        idleWake.notify_one();
+    }
+}
+
+bool SessionScheduler::MakeReady(Session *session)
+{
+    // Deadline = release + one frame, so earliest deadline first is the same
+    // as earliest release first
+    Worker &worker = *workers[session->home];
+    std::lock_guard<std::mutex> guard(worker.lock);
+    worker.ready.push_back(session);
+    std::push_heap(worker.ready.begin(), worker.ready.end(), ReleaseLater);
+    worker.readyCount++;
+    // Pairs with Park: either it sees readyTotal or we see it idle
+    readyTotal++;
+    return idleWorkers > 0;
+}
+
+void SessionScheduler::WakeIdle()
+{
+    // Taking the lock orders the notify after Park's check
+    std::lock_guard<std::mutex> guard(timerLock);
+    idleWake.notify_one();
+}
+
+void SessionScheduler::PromoteDue(clock::time_point now)
+{
+    while (!sleeping.empty() && sleeping.front()->release <= now)
+    {
+        std::pop_heap(sleeping.begin(), sleeping.end(), ReleaseLater);
+        Session *session = sleeping.back();
+        sleeping.pop_back();
+        if (MakeReady(session))
+        {
+            idleWake.notify_one();
+        }
+    }
+    nextRelease.store(sleeping.empty() ? std::numeric_limits<clock::rep>::max()
+                                       : sleeping.front()->release.time_since_epoch().count());
+}
+
+SessionScheduler::Session *SessionScheduler::TakeReady(uint32_t self)
+{
+    if (readyTotal == 0)
+    {
+        return nullptr;
+    }
+    for (uint32_t i = 0; i < workers.size(); i++)
+    {
+        const uint32_t victim = (self + i) % workers.size();
+        Worker &worker = *workers[victim];
+        // Only lock workers that have something to take
+        if (worker.readyCount == 0)
+        {
+            continue;
+        }
+        std::lock_guard<std::mutex> guard(worker.lock);
+        if (worker.ready.empty())
+        {
+            continue;
+        }
+        std::pop_heap(worker.ready.begin(), worker.ready.end(), ReleaseLater);
+        Session *session = worker.ready.back();
+        worker.ready.pop_back();
+        worker.readyCount--;
+        readyTotal--;
+        if (victim != self)
+        {
+            // The session stays with the thief, its cache is warm there now
+            session->home = self;
+            steals++;
+        }
+        return session;
+    }
+    return nullptr;
+}
+
+void SessionScheduler::Park()
+{
+    std::unique_lock<std::mutex> guard(timerLock);
+    idleWorkers++;
+    while (running && readyTotal == 0)
+    {
+        PromoteDue(clock::now());
+        if (readyTotal > 0)
+        {
+            break;
+        }
+        if (!timekeeper && !sleeping.empty())
+        {
+            timekeeper = true;
+            timerWake.wait_until(guard, sleeping.front()->release);
+            timekeeper = false;
+        }
+        else
+        {
+            idleWake.wait(guard);
+        }
+    }
+    idleWorkers--;
+    if (!timekeeper && !sleeping.empty() && idleWorkers > 0)
+    {
+        // Hand waiting for the next release to a worker that stays idle
+        idleWake.notify_one();
+    }
+}
+
+void SessionScheduler::RunFrame(Session *session)
+{
+    Chip8 &machine = *session->machine;
+    const uint16_t keys = session->keys.load();
+    if (keys != session->appliedKeys)
+    {
+        for (int key = 0; key < sizes::numKeys; key++)
+        {
+            machine.keypad[key] = (keys >> key) & 1u;
+        }
+        session->appliedKeys = keys;
+        session->idle = false;
+    }
+
+    if (session->idle)
+    {
+        // Spinning on Fx0A or a jump to itself changes nothing but the timers
+        session->idleFrames.fetch_add(1, std::memory_order_relaxed);
+    }
+    else
+    {
+        for (uint32_t i = 0; i < session->cyclesPerFrame; i++)
+        {
+            machine.Cycle();
+        }
+        session->idle = machine.Idle();
+    }
+    machine.UpdateTimers();
+    machine.screenUpdate = false;
+    session->frames.fetch_add(1, std::memory_order_relaxed);
+
+    const clock::time_point now = clock::now();
+    const clock::time_point deadline = session->release + FramePeriod();
+    if (now > deadline)
+    {
+        session->missed.fetch_add(1, std::memory_order_relaxed);
+        const int64_t lateUs = std::chrono::duration_cast<std::chrono::microseconds>(now - deadline).count();
+        int64_t worst = session->maxLatenessUs.load(std::memory_order_relaxed);
+        while (lateUs > worst && !session->maxLatenessUs.compare_exchange_weak(worst, lateUs))
+        {
+        }
+    }
+
+    if (session->idle && !machine.TimersRunning())
+    {
+        session->parked = true;
+        // A key that arrived before parked was set would otherwise be lost
+        bool wasParked = true;
+        if (session->keys.load() == session->appliedKeys ||
+            !session->parked.compare_exchange_strong(wasParked, false))
+        {
+            return;
+        }
+    }
+
+    clock::time_point next = deadline;
+    if (now - next > FramePeriod() * MAX_FRAMES_BEHIND)
+    {
+        const uint64_t dropped = static_cast<uint64_t>((now - next) / FramePeriod());
+        session->missed.fetch_add(dropped, std::memory_order_relaxed);
+        next += FramePeriod() * dropped;
+    }
+    Enqueue(session, next);
+}
+
+void SessionScheduler::WorkerLoop(uint32_t self)
+{
+    while (running.load(std::memory_order_relaxed))
+    {
+        // With every worker busy there is no timekeeper, so releases are
+        // also checked between frames
+        if (clock::now().time_since_epoch().count() >= nextRelease.load(std::memory_order_relaxed))
+        {
+            std::lock_guard<std::mutex> guard(timerLock);
+            PromoteDue(clock::now());
+        }
+        Session *session = TakeReady(self);
+        if (session)
+        {
+            RunFrame(session);
+            continue;
+        }
+        Park();
+    }
+}
+
+void SessionScheduler::Start()
+{
+    if (running.exchange(true))
+    {
+        return;
+    }
+    for (uint32_t i = 0; i < workers.size(); i++)
+    {
+        threads.emplace_back(&SessionScheduler::WorkerLoop, this, i);
+    }
+}
+
+void SessionScheduler::Stop()
+{
+    if (!running.exchange(false))
+    {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> guard(timerLock);
+        idleWake.notify_all();
+        timerWake.notify_all();
+    }
+    for (std::thread &thread : threads)
+    {
+        thread.join();
+    }
+    threads.clear();
+}
+
+SessionStats SessionScheduler::Stats(int id)
+{
+    Session *session;
+    {
+        std::lock_guard<std::mutex> guard(sessionsLock);
+        if (id < 0 || static_cast<size_t>(id) >= sessions.size())
+        {
+            return SessionStats{};
+        }
+        session = sessions[id].get();
+    }
+    return SessionStats{session->frames, session->idleFrames, session->missed,
+                        session->maxLatenessUs / 1000.0, session->parked};
+}
+
+uint32_t SessionScheduler::SessionCount()
+{
+    std::lock_guard<std::mutex> guard(sessionsLock);
+    return static_cast<uint32_t>(sessions.size());
+}
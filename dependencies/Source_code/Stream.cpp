@@ -0,0 +1,417 @@
+#include "Stream.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <iostream>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include "Args.hpp"
+
+// A viewer with more than this queued stops getting deltas until it catches up
+static const size_t MAX_BACKLOG = 16 * 1024;
+static const size_t READ_CHUNK = 4096;
+
+static bool IsPort(const std::string &address)
+{
+    return !address.empty() && address.size() <= 5 &&
+           std::all_of(address.begin(), address.end(), [](char c) { return c >= '0' && c <= '9'; });
+}
+
+static int OpenSocket(const std::string &address, bool listening)
+{
+    const bool tcp = IsPort(address);
+    sockaddr_un unixAddr{};
+    sockaddr_in tcpAddr{};
+    sockaddr *addr;
+    socklen_t addrSize;
+    if (tcp)
+    {
+        // IsPort allows up to 99999, larger ports must not wrap around
+        uint32_t port = 0;
+        if (!ParseArg(address.c_str(), port) || port > 65535)
+        {
+            std::cout << "Error: port " << address << " is out of range\n";
+            return -1;
+        }
+        tcpAddr.sin_family = AF_INET;
+        tcpAddr.sin_port = htons(static_cast<uint16_t>(port));
+        tcpAddr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        addr = reinterpret_cast<sockaddr *>(&tcpAddr);
+        addrSize = sizeof(tcpAddr);
+    }
+    else
+    {
+        if (address.size() >= sizeof(unixAddr.sun_path))
+        {
+            std::cout << "Error: socket path " << address << " is too long\n";
+            return -1;
+        }
+        unixAddr.sun_family = AF_UNIX;
+        std::memcpy(unixAddr.sun_path, address.c_str(), address.size() + 1);
+        addr = reinterpret_cast<sockaddr *>(&unixAddr);
+        addrSize = sizeof(unixAddr);
+    }
+
+    const int fd = socket(tcp ? AF_INET : AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0)
+    {
+        std::cout << "Error: could not create a socket: " << std::strerror(errno) << "\n";
+        return -1;
+    }
+    int one = 1;
+    if (tcp)
+    {
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    }
+    bool ok;
+    if (listening)
+    {
+        if (tcp)
+        {
+            setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+        }
+        else
+        {
+            unlink(address.c_str());
+        }
+        ok = bind(fd, addr, addrSize) == 0 && listen(fd, 16) == 0;
+    }
+    else
+    {
+        ok = connect(fd, addr, addrSize) == 0;
+    }
+    if (!ok || fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK) < 0)
+    {
+        std::cout << "Error: could not " << (listening ? "listen on " : "connect to ") << address << ": "
+                  << std::strerror(errno) << "\n";
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+static void AppendMessage(std::vector<uint8_t> &out, uint8_t type, const uint8_t *payload, size_t size)
+{
+    out.push_back(type);
+    out.push_back(static_cast<uint8_t>(size & 0xFFu));
+    out.push_back(static_cast<uint8_t>(size >> 8u));
+    out.insert(out.end(), payload, payload + size);
+}
+
+int stream::Listen(const std::string &address)
+{
+    return OpenSocket(address, true);
+}
+
+int stream::Connect(const std::string &address)
+{
+    return OpenSocket(address, false);
+}
+
+StreamServer::StreamServer() : listenFd{-1}, lastFrame{}, bytesSent{0}, framesPublished{0}
+{
+}
+
+StreamServer::~StreamServer()
+{
+    for (Viewer &viewer : viewers)
+    {
+        close(viewer.fd);
+    }
+    if (listenFd >= 0)
+    {
+        close(listenFd);
+    }
+    if (!unixPath.empty())
+    {
+        unlink(unixPath.c_str());
+    }
+}
+
+bool StreamServer::Listen(const std::string &address)
+{
+    listenFd = stream::Listen(address);
+    if (listenFd < 0)
+    {
+        return false;
+    }
+    if (!IsPort(address))
+    {
+        unixPath = address;
+    }
+    return true;
+}
+
+void StreamServer::Accept()
+{
+    while (true)
+    {
+        const int fd = accept(listenFd, nullptr, nullptr);
+        if (fd < 0)
+        {
+            return;
+        }
+        fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+        int one = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one)); // Fails harmlessly on UNIX sockets
+        viewers.push_back(Viewer{fd, {}, 0, {}, 0, true});
+    }
+}
+
+bool StreamServer::Read(Viewer &viewer)
+{
+    uint8_t chunk[READ_CHUNK];
+    while (true)
+    {
+        const ssize_t got = recv(viewer.fd, chunk, sizeof(chunk), 0);
+        if (got == 0 || (got < 0 && errno != EAGAIN && errno != EWOULDBLOCK))
+        {
+            return false;
+        }
+        if (got < 0)
+        {
+            break;
+        }
+        viewer.inbox.insert(viewer.inbox.end(), chunk, chunk + got);
+    }
+
+    // Only the last keypad of a batch matters
+    size_t pos = 0;
+    while (viewer.inbox.size() - pos >= stream::HEADER_SIZE)
+    {
+        const uint8_t *message = viewer.inbox.data() + pos;
+        const size_t size = message[1] | (message[2] << 8u);
+        if (viewer.inbox.size() - pos < stream::HEADER_SIZE + size)
+        {
+            break;
+        }
+        if (message[0] == stream::MSG_KEYS && size == 2)
+        {
+            viewer.keys = static_cast<uint16_t>(message[3] | (message[4] << 8u));
+        }
+        pos += stream::HEADER_SIZE + size;
+    }
+    viewer.inbox.erase(viewer.inbox.begin(), viewer.inbox.begin() + pos);
+    return true;
+}
+
+bool StreamServer::Flush(Viewer &viewer)
+{
+    if (viewer.needsKeyframe && viewer.outbox.empty())
+    {
+        if (keyframe.empty())
+        {
+            static const uint8_t black[framecodec::PACKED_SIZE] = {};
+            std::vector<uint8_t> payload;
+            framecodec::EncodeDelta(black, lastFrame, payload);
+            AppendMessage(keyframe, stream::MSG_KEYFRAME, payload.data(), payload.size());
+        }
+        viewer.outbox = keyframe;
+        viewer.needsKeyframe = false;
+    }
+    while (viewer.sent < viewer.outbox.size())
+    {
+        const ssize_t put = send(viewer.fd, viewer.outbox.data() + viewer.sent, viewer.outbox.size() - viewer.sent,
+                                 MSG_NOSIGNAL);
+        if (put < 0)
+        {
+            return errno == EAGAIN || errno == EWOULDBLOCK;
+        }
+        viewer.sent += put;
+        bytesSent += put;
+    }
+    viewer.outbox.clear();
+    viewer.sent = 0;
+    return true;
+}
+
+void StreamServer::Close(Viewer &viewer)
+{
+    close(viewer.fd);
+    viewer.fd = -1;
+}
+
+void StreamServer::Poll()
+{
+    if (listenFd < 0)
+    {
+        return;
+    }
+    Accept();
+    for (Viewer &viewer : viewers)
+    {
+        if (!Read(viewer) || !Flush(viewer))
+        {
+            Close(viewer);
+        }
+    }
+    viewers.erase(std::remove_if(viewers.begin(), viewers.end(), [](const Viewer &viewer) { return viewer.fd < 0; }),
+                  viewers.end());
+}
+
+void StreamServer::Publish(const Chip8 &chip8)
+{
+    if (!chip8.screenUpdate)
+    {
+        return;
+    }
+    uint8_t frame[framecodec::PACKED_SIZE];
+    framecodec::Pack(chip8.video, frame);
+    if (std::memcmp(frame, lastFrame, sizeof(frame)) == 0)
+    {
+        return;
+    }
+    delta.clear();
+    framecodec::EncodeDelta(lastFrame, frame, delta);
+    std::memcpy(lastFrame, frame, sizeof(frame));
+    keyframe.clear();
+    framesPublished++;
+
+    for (Viewer &viewer : viewers)
+    {
+        if (viewer.needsKeyframe)
+        {
+            continue;
+        }
+        if (viewer.outbox.size() - viewer.sent > MAX_BACKLOG)
+        {
+            viewer.needsKeyframe = true;
+            continue;
+        }
+        AppendMessage(viewer.outbox, stream::MSG_DELTA, delta.data(), delta.size());
+        if (!Flush(viewer))
+        {
+            Close(viewer);
+        }
+    }
+    viewers.erase(std::remove_if(viewers.begin(), viewers.end(), [](const Viewer &viewer) { return viewer.fd < 0; }),
+                  viewers.end());
+}
+
+uint16_t StreamServer::Keys() const
+{
+    uint16_t keys = 0;
+    for (const Viewer &viewer : viewers)
+    {
+        keys |= viewer.keys;
+    }
+    return keys;
+}
+
+void StreamServer::ApplyKeys(Chip8 &chip8) const
+{
+    const uint16_t keys = Keys();
+    for (int key = 0; key < sizes::numKeys; key++)
+    {
+        chip8.keypad[key] = (keys >> key) & 1u;
+    }
+}
+
+StreamClient::StreamClient() : fd{-1}, sent{0}, frame{}, keys{0}, keysChanged{false}, bytesReceived{0}
+{
+}
+
+StreamClient::~StreamClient()
+{
+    if (fd >= 0)
+    {
+        close(fd);
+    }
+}
+
+bool StreamClient::Connect(const std::string &address)
+{
+    fd = stream::Connect(address);
+    return fd >= 0;
+}
+
+void StreamClient::SetKeys(uint16_t newKeys)
+{
+    keysChanged = keysChanged || newKeys != keys;
+    keys = newKeys;
+}
+
+int StreamClient::Poll()
+{
+    if (fd < 0)
+    {
+        return -1;
+    }
+    // A new keys message is only queued once the last one went out whole,
+    // keys changing meanwhile go out in the next one
+    if (keysChanged && outbox.empty())
+    {
+        const uint8_t payload[2] = {static_cast<uint8_t>(keys & 0xFFu), static_cast<uint8_t>(keys >> 8u)};
+        AppendMessage(outbox, stream::MSG_KEYS, payload, sizeof(payload));
+        keysChanged = false;
+    }
+    while (sent < outbox.size())
+    {
+        const ssize_t put = send(fd, outbox.data() + sent, outbox.size() - sent, MSG_NOSIGNAL);
+        if (put < 0 && errno != EAGAIN && errno != EWOULDBLOCK)
+        {
+            close(fd);
+            fd = -1;
+            return -1;
+        }
+        if (put < 0)
+        {
+            break;
+        }
+        sent += put;
+    }
+    if (sent == outbox.size())
+    {
+        outbox.clear();
+        sent = 0;
+    }
+
+    uint8_t chunk[READ_CHUNK];
+    while (true)
+    {
+        const ssize_t got = recv(fd, chunk, sizeof(chunk), 0);
+        if (got == 0 || (got < 0 && errno != EAGAIN && errno != EWOULDBLOCK))
+        {
+            close(fd);
+            fd = -1;
+            return -1;
+        }
+        if (got < 0)
+        {
+            break;
+        }
+        inbox.insert(inbox.end(), chunk, chunk + got);
+        bytesReceived += got;
+    }
+
+    int frames = 0;
+    size_t pos = 0;
+    while (inbox.size() - pos >= stream::HEADER_SIZE)
+    {
+        const uint8_t *message = inbox.data() + pos;
+        const size_t size = message[1] | (message[2] << 8u);
+        if (inbox.size() - pos < stream::HEADER_SIZE + size)
+        {
+            break;
+        }
+        if (message[0] == stream::MSG_KEYFRAME)
+        {
+            std::memset(frame, 0, sizeof(frame));
+        }
+        if (message[0] == stream::MSG_KEYFRAME || message[0] == stream::MSG_DELTA)
+        {
+            if (!framecodec::ApplyDelta(message + stream::HEADER_SIZE, size, frame))
+            {
+                std::cout << "Error: malformed frame from the server\n";
+            }
+            frames++;
+        }
+        pos += stream::HEADER_SIZE + size;
+    }
+    inbox.erase(inbox.begin(), inbox.begin() + pos);
+    return frames;
+}
@@ -0,0 +1,164 @@
+#include "Telemetry.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+
+LatencyHistogram::LatencyHistogram()
+{
+    Reset();
+}
+
+int LatencyHistogram::BucketOf(uint64_t value)
+{
+    if (value < SUB_BUCKETS)
+    {
+        return static_cast<int>(value);
+    }
+    const int msb = 63 - __builtin_clzll(value);
+    const int octave = msb - SUB_BITS + 1;
+    if (octave > OCTAVES)
+    {
+        return BUCKETS - 1;
+    }
+    const int sub = static_cast<int>(value >> (msb - SUB_BITS)) - SUB_BUCKETS;
+    return octave * SUB_BUCKETS + sub;
+}
+
+uint64_t LatencyHistogram::BucketTop(int bucket)
+{
+    if (bucket < SUB_BUCKETS)
+    {
+        return static_cast<uint64_t>(bucket);
+    }
+    const int shift = bucket / SUB_BUCKETS - 1;
+    const uint64_t lower = static_cast<uint64_t>(SUB_BUCKETS + bucket % SUB_BUCKETS) << shift;
+    return lower + (uint64_t{1} << shift) - 1;
+}
+
+void LatencyHistogram::Record(uint64_t ns)
+{
+    counts[BucketOf(ns)].fetch_add(1, std::memory_order_relaxed);
+    count.fetch_add(1, std::memory_order_relaxed);
+    sum.fetch_add(ns, std::memory_order_relaxed);
+    uint64_t seen = max.load(std::memory_order_relaxed);
+    while (ns > seen && !max.compare_exchange_weak(seen, ns, std::memory_order_relaxed))
+    {
+    }
+}
+
+void LatencyHistogram::Reset()
+{
+    for (std::atomic<uint64_t> &bucket : counts)
+    {
+        bucket.store(0, std::memory_order_relaxed);
+    }
+    count.store(0, std::memory_order_relaxed);
+    sum.store(0, std::memory_order_relaxed);
+    max.store(0, std::memory_order_relaxed);
+}
+
+double LatencyHistogram::Mean() const
+{
+    const uint64_t n = Count();
+    return n ? static_cast<double>(sum.load(std::memory_order_relaxed)) / n : 0.0;
+}
+
+uint64_t LatencyHistogram::Percentile(double fraction) const
+{
+    const uint64_t n = Count();
+    if (n == 0)
+    {
+        return 0;
+    }
+    const uint64_t target = std::max<uint64_t>(1, static_cast<uint64_t>(std::ceil(fraction * n)));
+    uint64_t seen = 0;
+    for (int bucket = 0; bucket < BUCKETS; bucket++)
+    {
+        seen += counts[bucket].load(std::memory_order_relaxed);
+        if (seen >= target)
+        {
+            return std::min(BucketTop(bucket), Max());
+        }
+    }
+    return Max();
+}
+
+Telemetry::Telemetry(uint32_t targetIPS) : windowStart{Now()}, windowInstructions{0}, frames{0}, instructions{0},
+    audioUnderruns{0}, targetIPS{targetIPS}
+{
+}
+
+uint64_t Telemetry::Now()
+{
+    return static_cast<uint64_t>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+void Telemetry::AudioCallback(uint64_t gapNs, uint64_t bufferNs)
+{
+    audioGap.Record(gapNs);
+    // The device holds about one more buffer, a longer gap left it empty
+    if (gapNs > bufferNs + bufferNs / 2)
+    {
+        audioUnderruns.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+double Telemetry::WindowIPS()
+{
+    const uint64_t now = Now();
+    const uint64_t executed = instructions.load(std::memory_order_relaxed);
+    const double seconds = (now - windowStart) / 1e9;
+    const double ips = seconds > 0 ? (executed - windowInstructions) / seconds : 0.0;
+    windowStart = now;
+    windowInstructions = executed;
+    return ips;
+}
+
+std::string Telemetry::StatsLine(double achievedIPS) const
+{
+    char line[256];
+    std::snprintf(line, sizeof(line),
+                  "IPS %.0f/%u | frame p50 %.2f p99 %.2f p999 %.2f ms | cycle p99 %.3f ms | render p99 %.3f ms | "
+                  "sleep overshoot p99 %.2f ms | audio underruns %llu",
+                  achievedIPS, targetIPS, frameTime.Percentile(0.5) / 1e6, frameTime.Percentile(0.99) / 1e6,
+                  frameTime.Percentile(0.999) / 1e6, cycleTime.Percentile(0.99) / 1e6, renderTime.Percentile(0.99) / 1e6,
+                  sleepOvershoot.Percentile(0.99) / 1e6,
+                  static_cast<unsigned long long>(audioUnderruns.load(std::memory_order_relaxed)));
+    return line;
+}
+
+void Telemetry::WriteReport(std::ostream &out) const
+{
+    const struct
+    {
+        const char *name;
+        const LatencyHistogram &histogram;
+    } rows[] = {
+        {"frame", frameTime},
+        {"cycle", cycleTime},
+        {"render", renderTime},
+        {"sleep overshoot", sleepOvershoot},
+        {"audio gap", audioGap},
+    };
+    out << "Timing (ms)           count      mean       p50       p99      p999       max\n";
+    for (const auto &row : rows)
+    {
+        const LatencyHistogram &h = row.histogram;
+        char line[128];
+        std::snprintf(line, sizeof(line), "%-16s %10llu %9.3f %9.3f %9.3f %9.3f %9.3f", row.name,
+                      static_cast<unsigned long long>(h.Count()), h.Mean() / 1e6, h.Percentile(0.5) / 1e6,
+                      h.Percentile(0.99) / 1e6, h.Percentile(0.999) / 1e6, h.Max() / 1e6);
+        out << line << "\n";
+    }
+    const double seconds = frameTime.Count() ? frameTime.Mean() * frameTime.Count() / 1e9 : 0.0;
+    out << frames.load(std::memory_order_relaxed) << " frames, " << instructions.load(std::memory_order_relaxed)
+        << " instructions";
+    if (seconds > 0)
+    {
+        out << ", " << static_cast<uint64_t>(instructions.load(std::memory_order_relaxed) / seconds) << " IPS achieved of "
+            << targetIPS << " targeted";
+    }
+    out << ", " << audioUnderruns.load(std::memory_order_relaxed) << " audio underruns\n";
+}
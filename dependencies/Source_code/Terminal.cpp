@@ -0,0 +1,199 @@
+#include "Terminal.hpp"
+#include <cerrno>
+#include <cstring>
+#include <unistd.h>
+
+// Indexed by bit 0 = top pixel, bit 1 = bottom pixel
+static const char *const HALF_BLOCKS[4] = {" ", "▀", "▄", "█"};
+
+static void WriteAll(int fd, const std::string &data)
+{
+    size_t done = 0;
+    while (done < data.size())
+    {
+        const ssize_t put = write(fd, data.data() + done, data.size() - done);
+        if (put < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            return;
+        }
+        done += put;
+    }
+}
+
+TerminalRenderer::TerminalRenderer(int fd) : fd{fd}, started{false}
+{
+    Invalidate();
+}
+
+TerminalRenderer::~TerminalRenderer()
+{
+    if (started)
+    {
+        WriteAll(fd, "\x1b[0m\x1b[" + std::to_string(ROWS + 2) + ";1H\x1b[?25h");
+    }
+}
+
+void TerminalRenderer::Invalidate()
+{
+    std::memset(cells, 0xFF, sizeof(cells));
+}
+
+size_t TerminalRenderer::Render(const uint32_t *video, bool beep)
+{
+    buffer.clear();
+    if (!started)
+    {
+        // Clear the screen and hide the cursor
+        buffer += "\x1b[2J\x1b[?25l";
+        started = true;
+    }
+    if (beep)
+    {
+        buffer += '\a';
+    }
+
+    int cursorRow = -1, cursorColumn = -1; // Where the terminal cursor is, -1 unknown
+    for (int row = 0; row < ROWS; row++)
+    {
+        const uint32_t *top = video + (row * 2) * sizes::VIDEO_WIDTH;
+        const uint32_t *bottom = top + sizes::VIDEO_WIDTH;
+        for (int column = 0; column < COLUMNS; column++)
+        {
+            const uint8_t cell = static_cast<uint8_t>((top[column] != 0) | ((bottom[column] != 0) << 1u));
+            uint8_t &old = cells[row * COLUMNS + column];
+            if (cell == old)
+            {
+                continue;
+            }
+            old = cell;
+            if (row != cursorRow || column != cursorColumn)
+            {
+                buffer += "\x1b[" + std::to_string(row + 1) + ";" + std::to_string(column + 1) + "H";
+            }
+            buffer += HALF_BLOCKS[cell];
+            cursorRow = row;
+            cursorColumn = column + 1;
+        }
+    }
+    if (!buffer.empty())
+    {
+        WriteAll(fd, buffer);
+    }
+    return buffer.size();
+}
+
+void TerminalRenderer::Status(const std::string &text)
+{
+    WriteAll(fd, "\x1b[" + std::to_string(ROWS + 1) + ";1H" + text + "\x1b[K");
+}
+
+static int KeypadIndex(char c)
+{
+    switch (c)
+    {
+    case '1': return 0x1;
+    case '2': return 0x2;
+    case '3': return 0x3;
+    case '4': return 0xC;
+    case 'q': return 0x4;
+    case 'w': return 0x5;
+    case 'e': return 0x6;
+    case 'r': return 0xD;
+    case 'a': return 0x7;
+    case 's': return 0x8;
+    case 'd': return 0x9;
+    case 'f': return 0xE;
+    case 'z': return 0xA;
+    case 'x': return 0x0;
+    case 'c': return 0xB;
+    case 'v': return 0xF;
+    default: return -1;
+    }
+}
+
+TerminalInput::TerminalInput() : raw{false}, holdFrames{}
+{
+    if (!isatty(STDIN_FILENO) || tcgetattr(STDIN_FILENO, &saved) != 0)
+    {
+        return;
+    }
+    termios mode = saved;
+    // No line buffering or echo, reads return immediately. Ctrl-C arrives
+    // as a byte too, so the terminal is always restored by the destructor
+    mode.c_lflag &= ~static_cast<tcflag_t>(ICANON | ECHO | ISIG);
+    mode.c_iflag &= ~static_cast<tcflag_t>(IXON | ICRNL);
+    mode.c_cc[VMIN] = 0;
+    mode.c_cc[VTIME] = 0;
+    raw = tcsetattr(STDIN_FILENO, TCSANOW, &mode) == 0;
+}
+
+TerminalInput::~TerminalInput()
+{
+    if (raw)
+    {
+        tcsetattr(STDIN_FILENO, TCSANOW, &saved);
+    }
+}
+
+TerminalInput::Command TerminalInput::Poll(Chip8 &chip8)
+{
+    for (uint16_t &hold : holdFrames)
+    {
+        hold = hold > 0 ? hold - 1 : 0;
+    }
+
+    Command command = NONE;
+    char input[64];
+    ssize_t got;
+    while ((got = read(STDIN_FILENO, input, sizeof(input))) > 0)
+    {
+        for (ssize_t i = 0; i < got; i++)
+        {
+            const char c = input[i];
+            if (c == 0x1B)
+            {
+                // A lone Esc quits, Esc [ ... is an escape sequence (arrows)
+                if (i + 1 < got && input[i + 1] == '[')
+                {
+                    i++;
+                    while (i + 1 < got && !(input[i + 1] >= 0x40 && input[i + 1] <= 0x7E))
+                    {
+                        i++;
+                    }
+                    i++;
+                    continue;
+                }
+                command = QUIT;
+            }
+            else if (c == 0x03)
+            {
+                command = QUIT;
+            }
+            else if (c == ' ')
+            {
+                command = PAUSE;
+            }
+            else if (c == '=')
+            {
+                command = RESET;
+            }
+            else
+            {
+                const int key = KeypadIndex(c >= 'A' && c <= 'Z' ? static_cast<char>(c - 'A' + 'a') : c);
+                if (key >= 0)
+                {
+                    holdFrames[key] = HOLD_FRAMES;
+                }
+            }
+        }
+    }
+    for (int key = 0; key < sizes::numKeys; key++)
+    {
+        chip8.keypad[key] = holdFrames[key] > 0;
+    }
+    return command;
+}
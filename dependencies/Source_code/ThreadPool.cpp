@@ -0,0 +1,85 @@
+#include "ThreadPool.hpp"
+#include <algorithm>
+
+ThreadPool::ThreadPool(uint32_t threads) : job{nullptr}, jobSize{0}, nextIndex{0}, doneWorkers{0}, generation{0}, stopping{false}
+{
+    if (threads == 0)
+    {
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    for (uint32_t i = 1; i < threads; i++)
+    {
+        workers.emplace_back(&ThreadPool::WorkerLoop, this);
+    }
+}
+
+void ThreadPool::RunJob()
+{
+    for (uint32_t i = nextIndex.fetch_add(1); i < jobSize; i = nextIndex.fetch_add(1))
+    {
+        (*job)(i);
+    }
+}
+
+void ThreadPool::WorkerLoop()
+{
+    uint64_t seen = 0;
+    while (true)
+    {
+        {
+            std::unique_lock<std::mutex> guard(lock);
+            wake.wait(guard, [&] { return stopping || generation != seen; });
+            if (stopping)
+            {
+                return;
+            }
+            seen = generation;
+        }
+        RunJob();
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            doneWorkers++;
+        }
+        finished.notify_one();
+    }
+}
+
+void ThreadPool::ParallelFor(uint32_t count, const std::function<void(uint32_t)> &func)
+{
+    if (workers.empty() || count <= 1)
+    {
+        for (uint32_t i = 0; i < count; i++)
+        {
+            func(i);
+        }
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        job = &func;
+        jobSize = count;
+        nextIndex = 0;
+        doneWorkers = 0;
+        generation++;
+    }
+    wake.notify_all();
+    RunJob();
+    // Every worker checks in once per job, so none can still be looking at
+    // it when the next one is set up
+    std::unique_lock<std::mutex> guard(lock);
+    finished.wait(guard, [&] { return doneWorkers == workers.size(); });
+    job = nullptr;
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        stopping = true;
+    }
+    wake.notify_all();
+    for (std::thread &worker : workers)
+    {
+        worker.join();
+    }
+}
@@ -0,0 +1,199 @@
+#include "Timeline.hpp"
+#include <algorithm>
+#include "Disassembler.hpp"
+
+Timeline::Timeline(Chip8 &chip8, uint32_t cyclesPerFrame, uint32_t interval, Debugger *debugger) : chip8{chip8},
+    debugger{debugger}, cyclesPerFrame{std::max<uint32_t>(1, cyclesPerFrame)}, interval{std::max<uint32_t>(1, interval)},
+    instruction{0}, nextEvent{0}
+{
+    checkpoints.push_back(Checkpoint{0, 0, {}});
+    chip8.Snapshot(checkpoints.back().state);
+}
+
+void Timeline::ApplyEvents()
+{
+    while (nextEvent < events.size() && events[nextEvent].instruction == instruction)
+    {
+        const InputEvent &event = events[nextEvent++];
+        if (event.reset)
+        {
+            chip8.Reset();
+        }
+        else
+        {
+            chip8.keypad[event.key] = event.pressed;
+        }
+    }
+}
+
+void Timeline::Cycle()
+{
+    ApplyEvents();
+    if (instruction % interval == 0 && checkpoints.back().instruction < instruction)
+    {
+        checkpoints.push_back(Checkpoint{instruction, nextEvent, {}});
+        chip8.Snapshot(checkpoints.back().state);
+    }
+    chip8.Cycle();
+    if (debugger && debugger->Stopped() && debugger->StoppedBefore())
+    {
+        return; // Nothing ran
+    }
+    if (++instruction % cyclesPerFrame == 0)
+    {
+        chip8.UpdateTimers();
+    }
+}
+
+void Timeline::DiscardFuture()
+{
+    events.resize(nextEvent);
+    while (checkpoints.back().instruction > instruction)
+    {
+        checkpoints.pop_back();
+    }
+}
+
+void Timeline::Log(const InputEvent &event)
+{
+    // New input in the past replaces the future recorded after it
+    DiscardFuture();
+    events.push_back(event);
+    nextEvent = events.size();
+}
+
+void Timeline::SetKey(uint8_t key, bool pressed)
+{
+    Log(InputEvent{instruction, static_cast<uint8_t>(key & 0xFu), pressed, 0});
+    chip8.keypad[key & 0xFu] = pressed;
+}
+
+void Timeline::Reset()
+{
+    Log(InputEvent{instruction, 0, 0, 1});
+    chip8.Reset();
+}
+
+void Timeline::ReplayTo(uint64_t target)
+{
+    const auto after = std::upper_bound(checkpoints.begin(), checkpoints.end(), target,
+                                        [](uint64_t value, const Checkpoint &checkpoint) { return value < checkpoint.instruction; });
+    const Checkpoint &start = *(after - 1);
+    chip8.Restore(start.state);
+    instruction = start.instruction;
+    nextEvent = start.nextEvent;
+
+    Debugger *suspended = debugger;
+    debugger = nullptr;
+    chip8.AttachDebugger(nullptr);
+    while (instruction < target)
+    {
+        Cycle();
+    }
+    ApplyEvents(); // Input given while stopped at target
+    debugger = suspended;
+    if (debugger)
+    {
+        debugger->ClearStop();
+    }
+}
+
+bool Timeline::StepBack(uint64_t count)
+{
+    if (instruction == 0)
+    {
+        return false;
+    }
+    ReplayTo(instruction - std::min(count, instruction));
+    return true;
+}
+
+bool Timeline::SearchBack(Search search, uint16_t address)
+{
+    const uint64_t now = instruction;
+    if (now == 0 || (search == DEBUGGER_STOPS && !debugger))
+    {
+        return false;
+    }
+    // Newest interval first; each is replayed once, recording the last
+    // match before now
+    size_t index = std::upper_bound(checkpoints.begin(), checkpoints.end(), now - 1,
+                                    [](uint64_t value, const Checkpoint &checkpoint) { return value < checkpoint.instruction; }) -
+                   checkpoints.begin();
+    while (index-- > 0)
+    {
+        const uint64_t from = checkpoints[index].instruction;
+        const uint64_t to = std::min<uint64_t>(now, index + 1 < checkpoints.size() ? checkpoints[index + 1].instruction : now);
+        ReplayTo(from);
+        bool found = false;
+        uint64_t match = 0;
+        if (search == WRITES)
+        {
+            Debugger *suspended = debugger;
+            debugger = nullptr;
+            chip8.AttachDebugger(nullptr);
+            while (instruction < to)
+            {
+                const Chip8CpuState state = chip8.GetCpuState();
+                const uint16_t opcode = static_cast<uint16_t>(chip8.Peek(state.PC) << 8u | chip8.Peek(state.PC + 1));
+                const disasm::OpcodeClass opcodeClass = disasm::Classify(opcode);
+                if (opcodeClass == disasm::OPC_Fx33 || opcodeClass == disasm::OPC_Fx55)
+                {
+                    const uint16_t length = opcodeClass == disasm::OPC_Fx33 ? 3 : ((opcode >> 8u) & 0xFu) + 1;
+                    if (static_cast<uint16_t>((address - state.Index) & 0xFFFu) < length)
+                    {
+                        found = true;
+                        match = instruction;
+                    }
+                }
+                Cycle();
+            }
+            debugger = suspended;
+        }
+        else
+        {
+            // ReplayTo cleared the stop, a breakpoint right at from counts
+            while (instruction < to)
+            {
+                Cycle();
+                if (debugger->Stopped())
+                {
+                    // Stops after a write land on the next instruction
+                    if (instruction < now)
+                    {
+                        found = true;
+                        match = instruction;
+                    }
+                    debugger->Resume(Debugger::CONTINUE);
+                }
+            }
+        }
+        if (found)
+        {
+            ReplayTo(match);
+            return true;
+        }
+    }
+    ReplayTo(now);
+    return false;
+}
+
+bool Timeline::ReverseContinue()
+{
+    return SearchBack(DEBUGGER_STOPS, 0);
+}
+
+bool Timeline::ReverseToWrite(uint16_t address)
+{
+    return SearchBack(WRITES, address & 0xFFFu);
+}
+
+size_t Timeline::MemoryUsed() const
+{
+    size_t bytes = events.capacity() * sizeof(InputEvent) + checkpoints.capacity() * sizeof(Checkpoint);
+    for (const Checkpoint &checkpoint : checkpoints)
+    {
+        bytes += checkpoint.state.pages.capacity();
+    }
+    return bytes;
+}
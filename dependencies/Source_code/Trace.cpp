@@ -0,0 +1,146 @@
+#include "Trace.hpp"
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
+static const size_t BUFFER_SIZE = 1 << 20;
+
+static void Put16(uint8_t *out, uint16_t value)
+{
+    out[0] = static_cast<uint8_t>(value & 0xFFu);
+    out[1] = static_cast<uint8_t>(value >> 8u);
+}
+
+static void Put64(uint8_t *out, uint64_t value)
+{
+    for (int i = 0; i < 8; i++)
+    {
+        out[i] = static_cast<uint8_t>(value >> (8 * i));
+    }
+}
+
+static uint16_t Get16(const uint8_t *in)
+{
+    return static_cast<uint16_t>(in[0] | in[1] << 8u);
+}
+
+static uint64_t Get64(const uint8_t *in)
+{
+    uint64_t value = 0;
+    for (int i = 0; i < 8; i++)
+    {
+        value |= static_cast<uint64_t>(in[i]) << (8 * i);
+    }
+    return value;
+}
+
+trace::Record trace::Capture(const Chip8 &chip8)
+{
+    const Chip8CpuState state = chip8.GetCpuState();
+    Record record;
+    record.PC = state.PC;
+    record.opcode = static_cast<uint16_t>(chip8.Peek(state.PC) << 8u | chip8.Peek(state.PC + 1));
+    record.Index = state.Index;
+    record.SP = state.SP;
+    record.delayTimer = chip8.GetDelayTimer();
+    record.soundTimer = chip8.GetSoundTimer();
+    std::copy(std::begin(state.registers), std::end(state.registers), record.registers);
+    record.stackTop = state.SP > 0 ? state.stack[(state.SP - 1) % sizes::stackLevels] : 0;
+    return record;
+}
+
+void trace::Encode(const Record &record, uint8_t *out)
+{
+    Put16(out, record.PC);
+    Put16(out + 2, record.opcode);
+    Put16(out + 4, record.Index);
+    out[6] = record.SP;
+    out[7] = record.delayTimer;
+    out[8] = record.soundTimer;
+    out[9] = 0;
+    std::memcpy(out + 10, record.registers, sizes::numRegisters);
+    Put16(out + 26, record.stackTop);
+}
+
+trace::Record trace::Decode(const uint8_t *in)
+{
+    Record record;
+    record.PC = Get16(in);
+    record.opcode = Get16(in + 2);
+    record.Index = Get16(in + 4);
+    record.SP = in[6];
+    record.delayTimer = in[7];
+    record.soundTimer = in[8];
+    std::memcpy(record.registers, in + 10, sizes::numRegisters);
+    record.stackTop = Get16(in + 26);
+    return record;
+}
+
+bool trace::DecodeHeader(const uint8_t *data, size_t size, Header &header)
+{
+    if (size < HEADER_SIZE || std::memcmp(data, MAGIC, sizeof(MAGIC)) != 0)
+    {
+        return false;
+    }
+    header.version = Get16(data + 4);
+    header.recordSize = Get16(data + 6);
+    header.romHash = Get64(data + 8);
+    header.seed = Get64(data + 16);
+    return true;
+}
+
+TraceWriter::TraceWriter() : file{nullptr}, used{0}, records{0}, failed{false}
+{
+}
+
+TraceWriter::~TraceWriter()
+{
+    Close();
+}
+
+bool TraceWriter::Open(const std::string &filename, const Chip8 &chip8)
+{
+    file = std::fopen(filename.c_str(), "wb");
+    if (!file)
+    {
+        std::cout << "Error: could not create " << filename << "\n";
+        return false;
+    }
+    buffer.resize(BUFFER_SIZE);
+    uint8_t header[trace::HEADER_SIZE];
+    std::memcpy(header, trace::MAGIC, sizeof(trace::MAGIC));
+    Put16(header + 4, trace::VERSION);
+    Put16(header + 6, trace::RECORD_SIZE);
+    Put64(header + 8, chip8.RomHash());
+    Put64(header + 16, chip8.GetSeed());
+    std::memcpy(buffer.data(), header, sizeof(header));
+    used = sizeof(header);
+    records = 0;
+    failed = false;
+    return true;
+}
+
+void TraceWriter::Flush()
+{
+    if (file && used > 0 && std::fwrite(buffer.data(), 1, used, file) != used)
+    {
+        failed = true;
+    }
+    used = 0;
+}
+
+bool TraceWriter::Close()
+{
+    if (!file)
+    {
+        return !failed;
+    }
+    Flush();
+    failed = std::fclose(file) != 0 || failed;
+    file = nullptr;
+    if (failed)
+    {
+        std::cout << "Error: could not write the trace\n";
+    }
+    return !failed;
+}
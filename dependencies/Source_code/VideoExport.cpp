@@ -0,0 +1,471 @@
+#include "VideoExport.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <unordered_map>
+
+static bool PixelOn(const uint8_t *screen, int x, int y)
+{
+    const int pixel = y * sizes::VIDEO_WIDTH + x;
+    return (screen[pixel / 8] >> (7 - pixel % 8)) & 1u;
+}
+
+static void PutLe16(std::vector<uint8_t> &out, uint32_t value)
+{
+    out.push_back(static_cast<uint8_t>(value & 0xFFu));
+    out.push_back(static_cast<uint8_t>((value >> 8u) & 0xFFu));
+}
+
+static void PutLe32(std::vector<uint8_t> &out, uint32_t value)
+{
+    PutLe16(out, value & 0xFFFFu);
+    PutLe16(out, value >> 16u);
+}
+
+static void PutBe32(std::vector<uint8_t> &out, uint32_t value)
+{
+    for (int shift = 24; shift >= 0; shift -= 8)
+    {
+        out.push_back(static_cast<uint8_t>((value >> shift) & 0xFFu));
+    }
+}
+
+static void PutBe16(std::vector<uint8_t> &out, uint32_t value)
+{
+    out.push_back(static_cast<uint8_t>((value >> 8u) & 0xFFu));
+    out.push_back(static_cast<uint8_t>(value & 0xFFu));
+}
+
+static void PutRgb(std::vector<uint8_t> &out, uint32_t colour)
+{
+    out.push_back(static_cast<uint8_t>((colour >> 16u) & 0xFFu));
+    out.push_back(static_cast<uint8_t>((colour >> 8u) & 0xFFu));
+    out.push_back(static_cast<uint8_t>(colour & 0xFFu));
+}
+
+static void Write(std::ofstream &out, const std::vector<uint8_t> &data)
+{
+    out.write(reinterpret_cast<const char *>(data.data()), data.size());
+}
+
+// GIF
+
+// Variable width LZW codes, packed LSB first into sub-blocks of 255 bytes
+class LzwWriter
+{
+    std::vector<uint8_t> &out;
+    std::vector<uint8_t> block;
+    uint32_t bits;
+    int bitCount;
+
+    public:
+    explicit LzwWriter(std::vector<uint8_t> &out) : out{out}, bits{0}, bitCount{0} {}
+
+    void Put(uint32_t code, int width)
+    {
+        bits |= code << bitCount;
+        bitCount += width;
+        while (bitCount >= 8)
+        {
+            Byte(static_cast<uint8_t>(bits & 0xFFu));
+            bits >>= 8u;
+            bitCount -= 8;
+        }
+    }
+
+    void Byte(uint8_t value)
+    {
+        block.push_back(value);
+        if (block.size() == 255)
+        {
+            Flush();
+        }
+    }
+
+    void Flush()
+    {
+        if (!block.empty())
+        {
+            out.push_back(static_cast<uint8_t>(block.size()));
+            out.insert(out.end(), block.begin(), block.end());
+            block.clear();
+        }
+    }
+
+    void Finish()
+    {
+        if (bitCount > 0)
+        {
+            Byte(static_cast<uint8_t>(bits & 0xFFu));
+            bits = 0;
+            bitCount = 0;
+        }
+        Flush();
+        out.push_back(0);
+    }
+};
+
+static void LzwEncode(const std::vector<uint8_t> &pixels, std::vector<uint8_t> &out)
+{
+    const int minCodeSize = 2; // The smallest GIF allows, enough for 2 colours
+    const uint32_t clearCode = 1u << minCodeSize;
+    const uint32_t endCode = clearCode + 1;
+    out.push_back(minCodeSize);
+    LzwWriter writer{out};
+
+    std::unordered_map<uint32_t, uint32_t> codes; // (prefix << 8 | pixel) -> code
+    uint32_t nextCode = endCode + 1;
+    int width = minCodeSize + 1;
+    writer.Put(clearCode, width);
+    uint32_t prefix = pixels[0];
+    for (size_t i = 1; i < pixels.size(); i++)
+    {
+        const uint32_t key = (prefix << 8u) | pixels[i];
+        const auto found = codes.find(key);
+        if (found != codes.end())
+        {
+            prefix = found->second;
+            continue;
+        }
+        writer.Put(prefix, width);
+        if (nextCode < 4096)
+        {
+            if (nextCode == (1u << width))
+            {
+                width++;
+            }
+            codes[key] = nextCode++;
+        }
+        else
+        {
+            writer.Put(clearCode, width);
+            codes.clear();
+            nextCode = endCode + 1;
+            width = minCodeSize + 1;
+        }
+        prefix = pixels[i];
+    }
+    writer.Put(prefix, width);
+    writer.Put(endCode, width);
+    writer.Finish();
+}
+
+bool GifExporter::Begin(const std::string &filename, const ExportOptions &exportOptions)
+{
+    options = exportOptions;
+    out.open(filename, std::ios::binary);
+    if (!out)
+    {
+        std::cout << "Error: could not write " << filename << "\n";
+        return false;
+    }
+    std::vector<uint8_t> header{'G', 'I', 'F', '8', '9', 'a'};
+    PutLe16(header, sizes::VIDEO_WIDTH * options.scale);
+    PutLe16(header, sizes::VIDEO_HEIGHT * options.scale);
+    header.push_back(0x80); // Global colour table of 2 entries
+    header.push_back(0);    // Background colour index
+    header.push_back(0);    // Pixel aspect ratio
+    PutRgb(header, options.bgColour);
+    PutRgb(header, options.fgColour);
+    // Loop forever
+    const uint8_t loop[] = {0x21, 0xFF, 0x0B, 'N', 'E', 'T', 'S', 'C', 'A', 'P', 'E', '2', '.', '0', 0x03, 0x01, 0x00, 0x00, 0x00};
+    header.insert(header.end(), std::begin(loop), std::end(loop));
+    Write(out, header);
+    hasPending = false;
+    pendingStart = 0;
+    now = 0;
+    return true;
+}
+
+void GifExporter::WriteFrame(const uint8_t *screen, uint16_t delay)
+{
+    const int width = sizes::VIDEO_WIDTH * options.scale;
+    const int height = sizes::VIDEO_HEIGHT * options.scale;
+    std::vector<uint8_t> frame{0x21, 0xF9, 0x04, 0x00};
+    PutLe16(frame, delay);
+    frame.push_back(0); // Transparent colour index, unused
+    frame.push_back(0);
+    frame.push_back(0x2C);
+    PutLe16(frame, 0);
+    PutLe16(frame, 0);
+    PutLe16(frame, width);
+    PutLe16(frame, height);
+    frame.push_back(0); // No local colour table, not interlaced
+
+    std::vector<uint8_t> pixels(static_cast<size_t>(width) * height);
+    for (int y = 0; y < height; y++)
+    {
+        for (int x = 0; x < width; x++)
+        {
+            pixels[static_cast<size_t>(y) * width + x] = PixelOn(screen, x / options.scale, y / options.scale);
+        }
+    }
+    LzwEncode(pixels, frame);
+    Write(out, frame);
+}
+
+static uint64_t Centiseconds(uint64_t frame)
+{
+    return (frame * 100 + 30) / 60;
+}
+
+void GifExporter::AddFrame(const uint8_t *screen, uint32_t frames)
+{
+    if (hasPending)
+    {
+        const uint64_t delay = Centiseconds(now) - Centiseconds(pendingStart);
+        if (delay >= 2)
+        {
+            WriteFrame(pending, static_cast<uint16_t>(std::min<uint64_t>(delay, 0xFFFF)));
+            pendingStart = now;
+        }
+    }
+    std::memcpy(pending, screen, sizeof(pending));
+    hasPending = true;
+    now += frames;
+}
+
+bool GifExporter::End()
+{
+    if (hasPending)
+    {
+        const uint64_t delay = Centiseconds(now) - Centiseconds(pendingStart);
+        WriteFrame(pending, static_cast<uint16_t>(std::min<uint64_t>(std::max<uint64_t>(delay, 2), 0xFFFF)));
+    }
+    out.put(0x3B);
+    out.close();
+    return !out.fail();
+}
+
+// APNG
+
+static uint32_t Crc32(const uint8_t *data, size_t size, uint32_t crc = 0)
+{
+    static uint32_t table[256];
+    static bool tableReady = false;
+    if (!tableReady)
+    {
+        for (uint32_t n = 0; n < 256; n++)
+        {
+            uint32_t c = n;
+            for (int k = 0; k < 8; k++)
+            {
+                c = (c & 1u) ? 0xEDB88320u ^ (c >> 1u) : c >> 1u;
+            }
+            table[n] = c;
+        }
+        tableReady = true;
+    }
+    crc = ~crc;
+    for (size_t i = 0; i < size; i++)
+    {
+        crc = table[(crc ^ data[i]) & 0xFFu] ^ (crc >> 8u);
+    }
+    return ~crc;
+}
+
+// zlib stream made of stored deflate blocks
+static std::vector<uint8_t> ZlibStored(const std::vector<uint8_t> &data)
+{
+    std::vector<uint8_t> out{0x78, 0x01};
+    size_t pos = 0;
+    do
+    {
+        const size_t size = std::min<size_t>(data.size() - pos, 0xFFFF);
+        out.push_back(pos + size == data.size() ? 1 : 0);
+        PutLe16(out, static_cast<uint32_t>(size));
+        PutLe16(out, static_cast<uint32_t>(~size & 0xFFFFu));
+        out.insert(out.end(), data.begin() + pos, data.begin() + pos + size);
+        pos += size;
+    } while (pos < data.size());
+
+    uint32_t a = 1, b = 0;
+    for (uint8_t byte : data)
+    {
+        a = (a + byte) % 65521;
+        b = (b + a) % 65521;
+    }
+    PutBe32(out, (b << 16u) | a);
+    return out;
+}
+
+void ApngExporter::WriteChunk(const char *type, const std::vector<uint8_t> &data)
+{
+    std::vector<uint8_t> chunk;
+    PutBe32(chunk, static_cast<uint32_t>(data.size()));
+    chunk.insert(chunk.end(), type, type + 4);
+    chunk.insert(chunk.end(), data.begin(), data.end());
+    PutBe32(chunk, Crc32(chunk.data() + 4, chunk.size() - 4));
+    Write(out, chunk);
+}
+
+bool ApngExporter::Begin(const std::string &filename, const ExportOptions &exportOptions)
+{
+    options = exportOptions;
+    out.open(filename, std::ios::binary);
+    if (!out)
+    {
+        std::cout << "Error: could not write " << filename << "\n";
+        return false;
+    }
+    const uint8_t signature[] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+    out.write(reinterpret_cast<const char *>(signature), sizeof(signature));
+
+    std::vector<uint8_t> ihdr;
+    PutBe32(ihdr, sizes::VIDEO_WIDTH * options.scale);
+    PutBe32(ihdr, sizes::VIDEO_HEIGHT * options.scale);
+    ihdr.push_back(1); // Bit depth
+    ihdr.push_back(3); // Palette
+    ihdr.push_back(0); // Deflate
+    ihdr.push_back(0); // Adaptive filtering
+    ihdr.push_back(0); // Not interlaced
+    WriteChunk("IHDR", ihdr);
+
+    // Frame count is patched in End
+    actlPosition = out.tellp();
+    WriteChunk("acTL", std::vector<uint8_t>(8, 0));
+
+    std::vector<uint8_t> plte;
+    PutRgb(plte, options.bgColour);
+    PutRgb(plte, options.fgColour);
+    WriteChunk("PLTE", plte);
+    frameCount = 0;
+    sequence = 0;
+    return true;
+}
+
+void ApngExporter::AddFrame(const uint8_t *screen, uint32_t frames)
+{
+    const int width = sizes::VIDEO_WIDTH * options.scale;
+    const int height = sizes::VIDEO_HEIGHT * options.scale;
+    const int rowBytes = (width + 7) / 8;
+    std::vector<uint8_t> raw;
+    raw.reserve(static_cast<size_t>(rowBytes + 1) * height);
+    for (int y = 0; y < height; y++)
+    {
+        raw.push_back(0); // No filter
+        for (int byte = 0; byte < rowBytes; byte++)
+        {
+            uint8_t bits = 0;
+            for (int bit = 0; bit < 8; bit++)
+            {
+                const int x = byte * 8 + bit;
+                const bool on = x < width && PixelOn(screen, x / options.scale, y / options.scale);
+                bits = static_cast<uint8_t>((bits << 1u) | on);
+            }
+            raw.push_back(bits);
+        }
+    }
+    const std::vector<uint8_t> compressed = ZlibStored(raw);
+
+    // delay_num is 16 bits, a longer screen becomes several frames
+    while (frames > 0)
+    {
+        const uint32_t delay = std::min<uint32_t>(frames, 0xFFFF);
+        frames -= delay;
+        std::vector<uint8_t> fctl;
+        PutBe32(fctl, sequence++);
+        PutBe32(fctl, width);
+        PutBe32(fctl, height);
+        PutBe32(fctl, 0);
+        PutBe32(fctl, 0);
+        PutBe16(fctl, delay);
+        PutBe16(fctl, 60);
+        fctl.push_back(0); // Dispose: none
+        fctl.push_back(0); // Blend: source
+        WriteChunk("fcTL", fctl);
+        if (frameCount == 0)
+        {
+            WriteChunk("IDAT", compressed);
+        }
+        else
+        {
+            std::vector<uint8_t> fdat;
+            PutBe32(fdat, sequence++);
+            fdat.insert(fdat.end(), compressed.begin(), compressed.end());
+            WriteChunk("fdAT", fdat);
+        }
+        frameCount++;
+    }
+}
+
+bool ApngExporter::End()
+{
+    WriteChunk("IEND", {});
+    out.seekp(actlPosition);
+    std::vector<uint8_t> actl;
+    PutBe32(actl, frameCount);
+    PutBe32(actl, 0); // Loop forever
+    WriteChunk("acTL", actl);
+    out.close();
+    return !out.fail() && frameCount > 0;
+}
+
+// BMP sequence
+
+bool BmpSequenceExporter::Begin(const std::string &filename, const ExportOptions &exportOptions)
+{
+    prefix = filename;
+    options = exportOptions;
+    now = 0;
+    ok = true;
+    return true;
+}
+
+void BmpSequenceExporter::AddFrame(const uint8_t *screen, uint32_t frames)
+{
+    const int width = sizes::VIDEO_WIDTH * options.scale;
+    const int height = sizes::VIDEO_HEIGHT * options.scale;
+    const int rowBytes = ((width + 31) / 32) * 4;
+    const uint32_t pixelOffset = 14 + 40 + 8;
+    const uint32_t fileSize = pixelOffset + rowBytes * height;
+
+    std::vector<uint8_t> bmp{'B', 'M'};
+    PutLe32(bmp, fileSize);
+    PutLe32(bmp, 0);
+    PutLe32(bmp, pixelOffset);
+    PutLe32(bmp, 40);
+    PutLe32(bmp, width);
+    PutLe32(bmp, height); // Positive: rows are stored bottom up
+    PutLe16(bmp, 1);
+    PutLe16(bmp, 1);      // 1 bit per pixel
+    PutLe32(bmp, 0);
+    PutLe32(bmp, rowBytes * height);
+    PutLe32(bmp, 2835);   // 72 DPI
+    PutLe32(bmp, 2835);
+    PutLe32(bmp, 2);
+    PutLe32(bmp, 0);
+    PutLe32(bmp, options.bgColour); // BGRA in memory order, same as 0x00RRGGBB little endian
+    PutLe32(bmp, options.fgColour);
+    for (int y = height - 1; y >= 0; y--)
+    {
+        for (int byte = 0; byte < rowBytes; byte++)
+        {
+            uint8_t bits = 0;
+            for (int bit = 0; bit < 8; bit++)
+            {
+                const int x = byte * 8 + bit;
+                const bool on = x < width && PixelOn(screen, x / options.scale, y / options.scale);
+                bits = static_cast<uint8_t>((bits << 1u) | on);
+            }
+            bmp.push_back(bits);
+        }
+    }
+
+    char name[32];
+    std::snprintf(name, sizeof(name), "_%06llu.bmp", static_cast<unsigned long long>(now));
+    std::ofstream out(prefix + name, std::ios::binary);
+    Write(out, bmp);
+    if (!out)
+    {
+        std::cout << "Error: could not write " << prefix + name << "\n";
+        ok = false;
+    }
+    now += frames;
+}
+
+bool BmpSequenceExporter::End()
+{
+    return ok;
+}
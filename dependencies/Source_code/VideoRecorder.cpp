@@ -0,0 +1,261 @@
+#include "VideoRecorder.hpp"
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <iterator>
+
+static const char VIDEO_MAGIC[4] = {'C', '8', 'V', 'D'};
+static const uint8_t VIDEO_VERSION = 1;
+static const uint8_t VIDEO_FPS = 60;
+static const uint32_t KEYFRAME_INTERVAL = 600;
+// Frames the queue can hold before the emulation thread starts dropping
+static const size_t QUEUE_FRAMES = 1024;
+
+static void WriteLeb128(std::vector<uint8_t> &out, uint64_t value)
+{
+    while (value >= 0x80)
+    {
+        out.push_back(static_cast<uint8_t>(value | 0x80u));
+        value >>= 7u;
+    }
+    out.push_back(static_cast<uint8_t>(value));
+}
+
+static bool ReadLeb128(const std::vector<uint8_t> &in, size_t &pos, uint64_t &value)
+{
+    value = 0;
+    for (int shift = 0; shift < 64; shift += 7)
+    {
+        if (pos >= in.size())
+        {
+            return false;
+        }
+        const uint8_t byte = in[pos++];
+        value |= static_cast<uint64_t>(byte & 0x7Fu) << shift;
+        if (!(byte & 0x80u))
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+VideoRecorder::VideoRecorder() :
+    queue{QUEUE_FRAMES},
+    stopping{false},
+    droppedFrames{0},
+    droppedPending{0},
+    previous{},
+    frameCount{0},
+    repeats{0},
+    sinceKeyframe{0}
+{
+}
+
+VideoRecorder::~VideoRecorder()
+{
+    Stop();
+}
+
+bool VideoRecorder::Start(const std::string &filename)
+{
+    out.open(filename, std::ios::binary);
+    if (!out)
+    {
+        std::cout << "Error: could not write " << filename << "\n";
+        return false;
+    }
+    out.write(VIDEO_MAGIC, sizeof(VIDEO_MAGIC));
+    const char info[4] = {static_cast<char>(VIDEO_VERSION), static_cast<char>(VIDEO_FPS),
+                          static_cast<char>(sizes::VIDEO_WIDTH), static_cast<char>(sizes::VIDEO_HEIGHT)};
+    out.write(info, sizeof(info));
+    std::memset(previous, 0, sizeof(previous));
+    frameCount = 0;
+    repeats = 0;
+    sinceKeyframe = KEYFRAME_INTERVAL; // The first frame is a keyframe
+    droppedFrames = 0;
+    droppedPending = 0;
+    stopping = false;
+    encoder = std::thread(&VideoRecorder::EncoderLoop, this);
+    return true;
+}
+
+void VideoRecorder::Submit(const Chip8 &chip8)
+{
+    QueuedFrame frame;
+    frame.dropped = droppedPending;
+    framecodec::Pack(chip8.video, frame.screen);
+    if (queue.TryPush(frame))
+    {
+        droppedPending = 0;
+    }
+    else
+    {
+        // The encoder fell far behind, keep the timing and show the last
+        // frame it got for a little longer instead of waiting
+        droppedPending++;
+        droppedFrames.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+void VideoRecorder::Stop()
+{
+    if (!encoder.joinable())
+    {
+        return;
+    }
+    stopping = true;
+    encoder.join();
+    // Frames dropped after the last queued one still count
+    repeats += droppedPending;
+    frameCount += droppedPending;
+    droppedPending = 0;
+    FlushRepeats();
+    record.clear();
+    record.push_back('E');
+    WriteLeb128(record, frameCount);
+    out.write(reinterpret_cast<const char *>(record.data()), record.size());
+    out.close();
+}
+
+void VideoRecorder::EncoderLoop()
+{
+    QueuedFrame frame;
+    while (true)
+    {
+        if (queue.TryPop(frame))
+        {
+            Encode(frame);
+            continue;
+        }
+        if (stopping)
+        {
+            // Stop is only set after the last Submit, nothing can follow
+            if (!queue.TryPop(frame))
+            {
+                return;
+            }
+            Encode(frame);
+            continue;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(2));
+    }
+}
+
+void VideoRecorder::FlushRepeats()
+{
+    if (repeats == 0)
+    {
+        return;
+    }
+    record.clear();
+    record.push_back('R');
+    WriteLeb128(record, repeats);
+    out.write(reinterpret_cast<const char *>(record.data()), record.size());
+    repeats = 0;
+}
+
+void VideoRecorder::Encode(const QueuedFrame &frame)
+{
+    repeats += frame.dropped;
+    frameCount += frame.dropped + 1;
+    sinceKeyframe += frame.dropped + 1;
+    if (frameCount > 1 && sinceKeyframe < KEYFRAME_INTERVAL &&
+        std::memcmp(frame.screen, previous, sizeof(previous)) == 0)
+    {
+        repeats++;
+        return;
+    }
+    FlushRepeats();
+
+    static const uint8_t black[framecodec::PACKED_SIZE] = {};
+    std::vector<uint8_t> payload;
+    const bool keyframe = sinceKeyframe >= KEYFRAME_INTERVAL;
+    framecodec::EncodeDelta(keyframe ? black : previous, frame.screen, payload);
+    record.clear();
+    record.push_back(keyframe ? 'K' : 'D');
+    WriteLeb128(record, payload.size());
+    record.insert(record.end(), payload.begin(), payload.end());
+    out.write(reinterpret_cast<const char *>(record.data()), record.size());
+    std::memcpy(previous, frame.screen, sizeof(previous));
+    if (keyframe)
+    {
+        sinceKeyframe = 0;
+    }
+}
+
+bool ReadVideo(const std::string &filename,
+               const std::function<void(const uint8_t *screen, uint32_t frames)> &onFrame)
+{
+    std::ifstream file(filename, std::ios::binary);
+    if (!file)
+    {
+        std::cout << "Error: could not read " << filename << "\n";
+        return false;
+    }
+    const std::vector<uint8_t> data{std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>()};
+    if (data.size() < 8 || std::memcmp(data.data(), VIDEO_MAGIC, sizeof(VIDEO_MAGIC)) != 0 ||
+        data[4] != VIDEO_VERSION || data[6] != sizes::VIDEO_WIDTH || data[7] != sizes::VIDEO_HEIGHT)
+    {
+        std::cout << "Error: " << filename << " is not a recording\n";
+        return false;
+    }
+
+    uint8_t screen[framecodec::PACKED_SIZE] = {};
+    uint64_t shown = 0;   // Frames the current screen stays visible
+    uint64_t total = 0;
+    size_t pos = 8;
+    while (pos < data.size())
+    {
+        const uint8_t type = data[pos++];
+        uint64_t value;
+        if (!ReadLeb128(data, pos, value))
+        {
+            break;
+        }
+        if (type == 'R')
+        {
+            shown += value;
+            continue;
+        }
+        if (type == 'E')
+        {
+            if (shown > 0)
+            {
+                onFrame(screen, static_cast<uint32_t>(shown));
+            }
+            if (total + shown != value)
+            {
+                std::cout << "Error: " << filename << " holds " << total + shown << " frames, expected " << value
+                          << "\n";
+                return false;
+            }
+            return true;
+        }
+        if ((type != 'K' && type != 'D') || value > data.size() - pos)
+        {
+            break;
+        }
+        if (shown > 0)
+        {
+            onFrame(screen, static_cast<uint32_t>(shown));
+            total += shown;
+        }
+        if (type == 'K')
+        {
+            std::memset(screen, 0, sizeof(screen));
+        }
+        if (!framecodec::ApplyDelta(data.data() + pos, value, screen))
+        {
+            break;
+        }
+        pos += value;
+        shown = 1;
+    }
+    if (shown > 0)
+    {
+        onFrame(screen, static_cast<uint32_t>(shown));
+    }
+    std::cout << "Error: " << filename << " is damaged or incomplete\n";
+    return false;
+}
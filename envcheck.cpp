@@ -0,0 +1,215 @@
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <vector>
+#include "Chip8Env.hpp"
+#include "ThreadPool.hpp"
+
+// Drives Chip8Env and ThreadPool end to end on a ROM built in memory and
+// checks what a training loop relies on: rewards from the score probe, the
+// terminated and truncated flags, packed observations, resets and that
+// several threads step a batch exactly like 1 thread. Exits with 1 if any
+// check fails
+//
+// The ROM draws one pixel at (0, 0), then loops adding 1 to V1, and 1 more
+// whenever key 5 is held, so holding the key earns reward faster
+static const uint8_t ROM[] = {
+    0x65, 0x05, // 200 LD V5, 0x05
+    0x60, 0x00, // 202 LD V0, 0x00
+    0xA2, 0x12, // 204 LD I, 0x212
+    0xD0, 0x01, // 206 DRW V0, V0, 1
+    0x71, 0x01, // 208 ADD V1, 0x01
+    0xE5, 0xA1, // 20A SKNP V5
+    0x71, 0x01, // 20C ADD V1, 0x01
+    0x12, 0x08, // 20E JP 0x208
+    0x00, 0x00, // 210
+    0x80, 0x00  // 212 sprite: the leftmost pixel
+};
+
+static const uint32_t NUM_ENVS = 64;
+static const uint32_t MAX_STEPS = 20;
+static const uint8_t GAME_OVER_SCORE = 100;
+static const uint16_t KEY_5 = 1u << 5;
+
+static int failures = 0;
+
+static void Check(bool passed, const char *what)
+{
+    std::cout << (passed ? "ok    " : "FAIL  ") << what << "\n";
+    failures += !passed;
+}
+
+static void CheckThreadPool()
+{
+    ThreadPool pool{4};
+    std::vector<std::atomic<uint32_t>> hits(100000);
+    pool.ParallelFor(static_cast<uint32_t>(hits.size()), [&](uint32_t i) { hits[i]++; });
+    bool once = true;
+    for (const std::atomic<uint32_t> &hit : hits)
+    {
+        once = once && hit == 1;
+    }
+    Check(once, "ParallelFor calls every index exactly once");
+
+    bool called = false;
+    pool.ParallelFor(0, [&](uint32_t) { called = true; });
+    Check(!called, "ParallelFor over nothing calls nothing");
+}
+
+// Runs episodes until every environment is done. Even environments hold key
+// 5, odd ones press nothing. Returns the summed reward per environment
+static std::vector<float> RunEpisode(Chip8Env &env, bool &flagsOk, bool &rewardsOk)
+{
+    std::vector<uint16_t> actions(NUM_ENVS);
+    for (uint32_t i = 0; i < NUM_ENVS; i++)
+    {
+        actions[i] = i % 2 == 0 ? KEY_5 : 0;
+    }
+    std::vector<float> total(NUM_ENVS, 0.0f);
+    std::vector<uint8_t> lastScore(NUM_ENVS, 0);
+    flagsOk = true;
+    rewardsOk = true;
+    for (uint32_t step = 0; step < MAX_STEPS + 5; step++)
+    {
+        env.Step(actions.data());
+        for (uint32_t i = 0; i < NUM_ENVS; i++)
+        {
+            const uint8_t score = env.Machine(i).PeekRegister(1);
+            rewardsOk = rewardsOk && env.Rewards()[i] == static_cast<float>(score - lastScore[i]);
+            lastScore[i] = score;
+            total[i] += env.Rewards()[i];
+            // Both flags are never set together, and one is set by the end
+            flagsOk = flagsOk && !(env.Terminated()[i] && env.Truncated()[i]);
+            if (step + 1 >= MAX_STEPS)
+            {
+                flagsOk = flagsOk && env.Done(i);
+            }
+        }
+    }
+    return total;
+}
+
+// Steps a batch on 1 thread next to one on config.threads threads, with the
+// same seeds and actions, and compares rewards, flags and observations after
+// every step
+static bool MatchesOneThread(const Chip8EnvConfig &config, const uint64_t *seeds)
+{
+    Chip8EnvConfig oneConfig = config;
+    oneConfig.threads = 1;
+    std::unique_ptr<Chip8Env> one = Chip8Env::Create(oneConfig);
+    std::unique_ptr<Chip8Env> many = Chip8Env::Create(config);
+    if (!one || !many || !one->LoadRom(ROM, sizeof(ROM)) || !many->LoadRom(ROM, sizeof(ROM)))
+    {
+        return false;
+    }
+    std::vector<uint8_t> oneObservations(NUM_ENVS * Chip8Env::PACKED_FRAME_SIZE);
+    std::vector<uint8_t> manyObservations(NUM_ENVS * Chip8Env::PACKED_FRAME_SIZE);
+    one->SetObservationBuffer(oneObservations.data());
+    many->SetObservationBuffer(manyObservations.data());
+    one->Reset(seeds);
+    many->Reset(seeds);
+
+    std::vector<uint16_t> actions(NUM_ENVS);
+    bool same = true;
+    for (uint32_t step = 0; step < MAX_STEPS + 5; step++)
+    {
+        // A different key pattern per step and environment
+        for (uint32_t i = 0; i < NUM_ENVS; i++)
+        {
+            actions[i] = (i + step) % 3 == 0 ? KEY_5 : 0;
+        }
+        one->Step(actions.data());
+        many->Step(actions.data());
+        same = same && std::memcmp(one->Rewards(), many->Rewards(), NUM_ENVS * sizeof(float)) == 0 &&
+               std::memcmp(one->Terminated(), many->Terminated(), NUM_ENVS) == 0 &&
+               std::memcmp(one->Truncated(), many->Truncated(), NUM_ENVS) == 0 && oneObservations == manyObservations;
+    }
+    return same;
+}
+
+int main()
+{
+    CheckThreadPool();
+
+    Chip8EnvConfig empty;
+    empty.numEnvs = 0;
+    Check(Chip8Env::Create(empty) == nullptr, "a batch of 0 environments is rejected");
+
+    Chip8EnvConfig config;
+    config.numEnvs = NUM_ENVS;
+    config.cyclesPerFrame = 12;
+    config.frameskip = 1;
+    config.maxSteps = MAX_STEPS;
+    config.threads = 4;
+    config.score = [](const Chip8 &machine) { return static_cast<float>(machine.PeekRegister(1)); };
+    config.gameOver = [](const Chip8 &machine) { return machine.PeekRegister(1) >= GAME_OVER_SCORE; };
+    std::unique_ptr<Chip8Env> env = Chip8Env::Create(config);
+    if (!env || !env->LoadRom(ROM, sizeof(ROM)))
+    {
+        Check(false, "the environment batch is created and loads the ROM");
+        return 1;
+    }
+    std::vector<uint8_t> observations(NUM_ENVS * Chip8Env::PACKED_FRAME_SIZE, 0xFF);
+    env->SetObservationBuffer(observations.data());
+    std::vector<uint64_t> seeds(NUM_ENVS);
+    for (uint32_t i = 0; i < NUM_ENVS; i++)
+    {
+        seeds[i] = i;
+    }
+    env->Reset(seeds.data());
+
+    bool flagsOk = false, rewardsOk = false;
+    const auto start = std::chrono::steady_clock::now();
+    const std::vector<float> first = RunEpisode(*env, flagsOk, rewardsOk);
+    const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    Check(rewardsOk, "rewards are the score difference between steps, 0 once done");
+    Check(flagsOk, "every environment is done by maxSteps, never both terminated and truncated");
+
+    bool keyTerminated = true, idleTruncated = true, sameRewards = true;
+    for (uint32_t i = 0; i < NUM_ENVS; i++)
+    {
+        if (i % 2 == 0)
+        {
+            // Holding the key scores 2 per 4 instructions and reaches the game over score in time
+            keyTerminated = keyTerminated && env->Terminated()[i] && !env->Truncated()[i] && first[i] >= GAME_OVER_SCORE;
+        }
+        else
+        {
+            idleTruncated = idleTruncated && env->Truncated()[i] && !env->Terminated()[i] && first[i] < GAME_OVER_SCORE;
+        }
+        sameRewards = sameRewards && first[i] == first[i % 2];
+    }
+    Check(keyTerminated, "environments holding the key hit the gameOver probe");
+    Check(idleTruncated, "idle environments are truncated after maxSteps");
+    Check(sameRewards, "environments with the same actions earn the same rewards on any thread");
+
+    bool packed = true;
+    for (uint32_t i = 0; i < NUM_ENVS; i++)
+    {
+        const uint8_t *frame = observations.data() + i * Chip8Env::PACKED_FRAME_SIZE;
+        packed = packed && frame[0] == 0x80 && env->Frame(i)[0] != 0;
+        for (size_t byte = 1; byte < Chip8Env::PACKED_FRAME_SIZE; byte++)
+        {
+            packed = packed && frame[byte] == 0;
+        }
+    }
+    Check(packed, "observations are packed to 1 bit per pixel, MSB first");
+
+    env->Reset(seeds.data());
+    bool cleared = true;
+    for (uint32_t i = 0; i < NUM_ENVS; i++)
+    {
+        cleared = cleared && !env->Done(i) && env->Rewards()[i] == 0.0f && env->Machine(i).PeekRegister(1) == 0 &&
+                  observations[i * Chip8Env::PACKED_FRAME_SIZE] == 0;
+    }
+    Check(cleared, "Reset clears the flags, rewards, machine and observation");
+    const std::vector<float> second = RunEpisode(*env, flagsOk, rewardsOk);
+    Check(second == first && flagsOk && rewardsOk, "a second episode after Reset repeats the first");
+    Check(MatchesOneThread(config, seeds.data()), "a batch on 4 threads steps exactly like one on 1 thread");
+
+    std::cout << NUM_ENVS << " environments x " << MAX_STEPS + 5 << " steps in " << seconds * 1000.0 << " ms\n";
+    std::cout << (failures ? "FAILED" : "All checks passed") << "\n";
+    return failures ? 1 : 0;
+}
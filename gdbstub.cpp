@@ -0,0 +1,98 @@
+#include <chrono>
+#include <csignal>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <thread>
+#include "Args.hpp"
+#include "Chip8.hpp"
+#include "GdbStub.hpp"
+
+// Runs a ROM in real time without a window behind a GDB remote serial
+// protocol server: target remote <port> or target remote <socket path>
+// from any RSP client. The ROM waits halted at its entry for the client
+static volatile std::sig_atomic_t stopRequested = 0;
+
+static void PrintUsage(const char *program)
+{
+    std::cout << "Usage: " << program << " <rom> <socket path | port> [--ips n] [--seed n]" << "\n";
+}
+
+int main(int argc, char** argv)
+{
+    if(argc < 3)
+    {
+        PrintUsage(argv[0]);
+        return -1;
+    }
+    uint32_t IPS = 600;
+    uint64_t seed = 0;
+    for(int i = 3; i < argc; i++)
+    {
+        if(std::strcmp(argv[i], "--ips") == 0 && i + 1 < argc)
+        {
+            if(!ParseArg(argv[++i], IPS))
+            {
+                PrintUsage(argv[0]);
+                return -1;
+            }
+        }
+        else if(std::strcmp(argv[i], "--seed") == 0 && i + 1 < argc)
+        {
+            if(!ParseArg(argv[++i], seed, 0))
+            {
+                PrintUsage(argv[0]);
+                return -1;
+            }
+        }
+        else
+        {
+            std::cout << "Unknown option: " << argv[i] << "\n";
+            return -1;
+        }
+    }
+    Chip8 chip8;
+    chip8.Seed(seed);
+    if(chip8.LoadRom(argv[1]) < 0)
+    {
+        return -1;
+    }
+    const uint32_t cyclesPerFrame = IPS / 60 ? IPS / 60 : 1;
+    GdbStub stub(chip8, cyclesPerFrame);
+    if(!stub.Listen(argv[2]))
+    {
+        return -1;
+    }
+    std::signal(SIGINT, [](int) { stopRequested = 1; });
+    std::signal(SIGTERM, [](int) { stopRequested = 1; });
+    std::cout << "Waiting for a debugger on " << argv[2] << "\n";
+
+    using clock = std::chrono::steady_clock;
+    const auto framePeriod = std::chrono::duration_cast<clock::duration>(std::chrono::nanoseconds(1000000000 / 60));
+    auto nextFrame = clock::now();
+    while(!stopRequested)
+    {
+        // Packets are only handled here, once per frame while running
+        stub.Poll(20);
+        if(!stub.Running())
+        {
+            nextFrame = clock::now();
+            continue;
+        }
+        // Up to the end of the current frame, a stop can land mid frame.
+        // The timeline ticks the timers
+        const uint64_t frameEnd = (stub.Instruction() / cyclesPerFrame + 1) * cyclesPerFrame;
+        while(stub.Running() && stub.Instruction() < frameEnd)
+        {
+            stub.Cycle();
+        }
+        if(stub.Instruction() < frameEnd)
+        {
+            continue;
+        }
+        chip8.screenUpdate = false;
+        nextFrame += framePeriod;
+        std::this_thread::sleep_until(nextFrame);
+    }
+    return 0;
+}
@@ -0,0 +1,76 @@
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include "Chip8.hpp"
+#include "Movie.hpp"
+
+// Plays back a movie recorded with `main <rom> --record <movie>` without any
+// window or audio, as fast as the core can run
+int main(int argc, char** argv)
+{
+    if(argc < 3)
+    {
+        std::cout << "Usage: " << argv[0] << " <rom> <movie> [--trace file]" << "\n";
+        return -1;
+    }
+    std::string romFile{argv[1]};
+    std::string traceFile;
+    for(int i = 3; i < argc; i++)
+    {
+        if(std::strcmp(argv[i], "--trace") == 0 && i + 1 < argc)
+        {
+            traceFile = argv[++i];
+        }
+        else
+        {
+            std::cout << "Unknown option: " << argv[i] << "\n";
+            return -1;
+        }
+    }
+    Movie movie;
+    if(!movie.Load(argv[2]))
+    {
+        return -1;
+    }
+
+    Chip8 chip8;
+    chip8.Seed(movie.seed);
+    if(chip8.LoadRom(romFile.c_str()) < 0)
+    {
+        return -1;
+    }
+    if(movie.romHash != chip8.RomHash())
+    {
+        std::cout << "Warning: movie was recorded with a different ROM\n";
+    }
+
+    TraceWriter trace;
+    if(!traceFile.empty() && !trace.Open(traceFile, chip8))
+    {
+        return -1;
+    }
+
+    const auto start = std::chrono::steady_clock::now();
+    const uint64_t hash = movie.PlayHeadless(chip8, traceFile.empty() ? nullptr : &trace);
+    const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    if(!traceFile.empty())
+    {
+        if(!trace.Close())
+        {
+            return -1;
+        }
+        std::cout << "Traced " << trace.Records() << " instructions to " << traceFile << "\n";
+    }
+
+    std::cout << "Frames: " << movie.frameCount << " in " << seconds << " s ("
+              << (seconds > 0 ? movie.frameCount / seconds / 60.0 : 0.0) << "x real time)\n";
+    std::cout << "State hash: " << std::hex << hash << std::dec << "\n";
+    if(movie.finalHash != 0)
+    {
+        bool match = hash == movie.finalHash;
+        std::cout << (match ? "Matches recording" : "DIFFERS from recording") << "\n";
+        return match ? 0 : 1;
+    }
+    return 0;
+}
@@ -1,18 +1,86 @@
 #include <iostream>
+#include <cstring>
+#include <string>
+#include "Args.hpp"
 #include "Display.hpp"
 
+static void PrintUsage(const char *program)
+{
+    std::cout << "Usage: " << program << " <rom> [--seed n] [--record movie] [--play movie] [--shm name] [--video file] [--stats seconds] [--overlay] [--latency] [--dump-rom]" << "\n";
+}
+
 int main(int argc, char** argv) 
 {
     if(argc < 2)
     {
         std::cout << "Please Enter a Rom File" << "\n";
+        PrintUsage(argv[0]);
         return -1;
     }
     std::string romFile{argv[1]};
     Options options;
     // options.toneFreq = 440;
+    for(int i = 2; i < argc; i++)
+    {
+        if(std::strcmp(argv[i], "--seed") == 0 && i + 1 < argc)
+        {
+            if(!ParseArg(argv[++i], options.seed, 0))
+            {
+                PrintUsage(argv[0]);
+                return -1;
+            }
+        }
+        else if(std::strcmp(argv[i], "--record") == 0 && i + 1 < argc)
+        {
+            options.recordFile = argv[++i];
+        }
+        else if(std::strcmp(argv[i], "--play") == 0 && i + 1 < argc)
+        {
+            options.playFile = argv[++i];
+        }
+        else if(std::strcmp(argv[i], "--shm") == 0 && i + 1 < argc)
+        {
+            options.shmName = argv[++i];
+        }
+        else if(std::strcmp(argv[i], "--video") == 0 && i + 1 < argc)
+        {
+            options.videoFile = argv[++i];
+        }
+        else if(std::strcmp(argv[i], "--stats") == 0 && i + 1 < argc)
+        {
+            if(!ParseArg(argv[++i], options.statsInterval))
+            {
+                PrintUsage(argv[0]);
+                return -1;
+            }
+        }
+        else if(std::strcmp(argv[i], "--overlay") == 0)
+        {
+            options.overlay = true;
+        }
+        else if(std::strcmp(argv[i], "--latency") == 0)
+        {
+            options.latency = true;
+        }
+        else if(std::strcmp(argv[i], "--dump-rom") == 0)
+        {
+            options.dumpRom = true;
+        }
+        else
+        {
+            std::cout << "Unknown option: " << argv[i] << "\n";
+            return -1;
+        }
+    }
+    if(options.playFile.empty())
+    {
+        std::cout << "Seed: " << options.seed << "\n";
+    }
     Display display{options};
-    display.InitChip(20, romFile.c_str()); // InitChip(scaleFactor, romFile)
+    if(!display.InitChip(20, romFile.c_str())) // InitChip(scaleFactor, romFile)
+    {
+        return -1;
+    }
     display.RunChip();
     return 0;
 }
@@ -0,0 +1,130 @@
+#include <cstring>
+#include <iostream>
+#include <string>
+#include "Args.hpp"
+#include "Chip8.hpp"
+#include "MemoryTracker.hpp"
+#include "Movie.hpp"
+
+// Runs a ROM without a window (for a number of frames, or driven by a movie
+// recorded with `main --record`) and shows which memory it executed, read
+// and wrote. Needs a build with tracking compiled in: make TRACK_MEMORY=1 memmap
+static void PrintUsage(const char *program)
+{
+    std::cout << "Usage: " << program << " <rom> [--movie file] [--frames n] [--ips n] [--seed n] [--image file.ppm] [--scale n]" << "\n";
+}
+
+int main(int argc, char** argv)
+{
+    if(argc < 2)
+    {
+        PrintUsage(argv[0]);
+        return -1;
+    }
+    std::string movieFile, imageFile;
+    uint32_t frames = 3600, IPS = 600;
+    uint64_t seed = 0;
+    int scale = 8;
+    for(int i = 2; i < argc; i++)
+    {
+        if(std::strcmp(argv[i], "--movie") == 0 && i + 1 < argc)
+        {
+            movieFile = argv[++i];
+        }
+        else if(std::strcmp(argv[i], "--frames") == 0 && i + 1 < argc)
+        {
+            if(!ParseArg(argv[++i], frames))
+            {
+                PrintUsage(argv[0]);
+                return -1;
+            }
+        }
+        else if(std::strcmp(argv[i], "--ips") == 0 && i + 1 < argc)
+        {
+            if(!ParseArg(argv[++i], IPS))
+            {
+                PrintUsage(argv[0]);
+                return -1;
+            }
+        }
+        else if(std::strcmp(argv[i], "--seed") == 0 && i + 1 < argc)
+        {
+            if(!ParseArg(argv[++i], seed, 0))
+            {
+                PrintUsage(argv[0]);
+                return -1;
+            }
+        }
+        else if(std::strcmp(argv[i], "--image") == 0 && i + 1 < argc)
+        {
+            imageFile = argv[++i];
+        }
+        else if(std::strcmp(argv[i], "--scale") == 0 && i + 1 < argc)
+        {
+            if(!ParseArg(argv[++i], scale))
+            {
+                PrintUsage(argv[0]);
+                return -1;
+            }
+        }
+        else
+        {
+            std::cout << "Unknown option: " << argv[i] << "\n";
+            return -1;
+        }
+    }
+
+    Movie movie;
+    if(!movieFile.empty())
+    {
+        if(!movie.Load(movieFile))
+        {
+            return -1;
+        }
+        seed = movie.seed;
+    }
+    Chip8 chip8;
+    MemoryTracker *tracker = chip8.MemoryAccess();
+    if(!tracker)
+    {
+        std::cout << "Error: built without CHIP8_TRACK_MEMORY, use make TRACK_MEMORY=1 memmap" << "\n";
+        return -1;
+    }
+    chip8.Seed(seed);
+    if(chip8.LoadRom(argv[1]) < 0)
+    {
+        return -1;
+    }
+    if(!movieFile.empty())
+    {
+        if(movie.romHash != chip8.RomHash())
+        {
+            std::cout << "Warning: movie was recorded with a different ROM\n";
+        }
+        movie.PlayHeadless(chip8);
+        frames = movie.frameCount;
+    }
+    else
+    {
+        for(uint32_t frame = 0; frame < frames; frame++)
+        {
+            for(uint32_t i = 0; i < IPS / 60; i++)
+            {
+                chip8.Cycle();
+            }
+            chip8.screenUpdate = false;
+            chip8.UpdateTimers();
+        }
+    }
+
+    std::cout << frames << " frames\n\n";
+    tracker->WriteHeatmap(std::cout);
+    std::cout << "\n";
+    tracker->WritePageSummary(std::cout);
+    std::cout << "\n" << (tracker->SelfModifying() ? "Self modifying: executed code was written\n" : "No self modifying code\n");
+    if(!imageFile.empty() && !tracker->WriteImage(imageFile, scale))
+    {
+        return -1;
+    }
+    return 0;
+}
@@ -0,0 +1,143 @@
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include "Args.hpp"
+#include "Chip8.hpp"
+#include "Movie.hpp"
+#include "Profiler.hpp"
+
+static void PrintUsage(const char *program)
+{
+    std::cout << "Usage: " << program << " <rom> [--movie file] [--frames n] [--ips n] [--seed n] [--top n] [--stacks file]" << "\n";
+}
+
+// Runs a ROM without a window (for a number of frames, or driven by a movie
+// recorded with `main --record`) and prints where its time went. Needs a
+// build with the profiler compiled in: make PROFILE=1 profile
+int main(int argc, char** argv)
+{
+    if(argc < 2)
+    {
+        PrintUsage(argv[0]);
+        return -1;
+    }
+    if(!Chip8::ProfilerBuilt())
+    {
+        std::cout << "Error: built without CHIP8_PROFILE, use make PROFILE=1 profile" << "\n";
+        return -1;
+    }
+    std::string movieFile, stacksFile;
+    uint32_t frames = 3600, IPS = 600;
+    uint64_t seed = 0;
+    size_t top = 20;
+    for(int i = 2; i < argc; i++)
+    {
+        if(std::strcmp(argv[i], "--movie") == 0 && i + 1 < argc)
+        {
+            movieFile = argv[++i];
+        }
+        else if(std::strcmp(argv[i], "--frames") == 0 && i + 1 < argc)
+        {
+            if(!ParseArg(argv[++i], frames))
+            {
+                PrintUsage(argv[0]);
+                return -1;
+            }
+        }
+        else if(std::strcmp(argv[i], "--ips") == 0 && i + 1 < argc)
+        {
+            if(!ParseArg(argv[++i], IPS))
+            {
+                PrintUsage(argv[0]);
+                return -1;
+            }
+        }
+        else if(std::strcmp(argv[i], "--seed") == 0 && i + 1 < argc)
+        {
+            if(!ParseArg(argv[++i], seed, 0))
+            {
+                PrintUsage(argv[0]);
+                return -1;
+            }
+        }
+        else if(std::strcmp(argv[i], "--top") == 0 && i + 1 < argc)
+        {
+            if(!ParseArg(argv[++i], top))
+            {
+                PrintUsage(argv[0]);
+                return -1;
+            }
+        }
+        else if(std::strcmp(argv[i], "--stacks") == 0 && i + 1 < argc)
+        {
+            stacksFile = argv[++i];
+        }
+        else
+        {
+            std::cout << "Unknown option: " << argv[i] << "\n";
+            return -1;
+        }
+    }
+
+    Movie movie;
+    if(!movieFile.empty())
+    {
+        if(!movie.Load(movieFile))
+        {
+            return -1;
+        }
+        seed = movie.seed;
+    }
+    Chip8 chip8;
+    chip8.Seed(seed);
+    if(chip8.LoadRom(argv[1]) < 0)
+    {
+        return -1;
+    }
+    Profiler profiler;
+    chip8.AttachProfiler(&profiler);
+    if(!movieFile.empty())
+    {
+        if(movie.romHash != chip8.RomHash())
+        {
+            std::cout << "Warning: movie was recorded with a different ROM\n";
+        }
+        movie.PlayHeadless(chip8);
+        frames = movie.frameCount;
+    }
+    else
+    {
+        for(uint32_t frame = 0; frame < frames; frame++)
+        {
+            for(uint32_t i = 0; i < IPS / 60; i++)
+            {
+                chip8.Cycle();
+            }
+            chip8.screenUpdate = false;
+            chip8.UpdateTimers();
+        }
+    }
+    chip8.AttachProfiler(nullptr);
+
+    std::cout << profiler.Instructions() << " instructions in " << frames << " frames\n\n";
+    profiler.WriteOpcodeClasses(std::cout);
+    std::cout << "\n";
+    profiler.WriteHotSpots(std::cout, top);
+    std::cout << "\n";
+    profiler.WriteCallGraph(std::cout);
+    std::cout << "\n";
+    profiler.WriteUndecoded(std::cout);
+    if(!stacksFile.empty())
+    {
+        std::ofstream out(stacksFile);
+        profiler.WriteCollapsedStacks(out);
+        if(!out)
+        {
+            std::cout << "Error: could not write " << stacksFile << "\n";
+            return -1;
+        }
+        std::cout << "\nCollapsed stacks written to " << stacksFile << "\n";
+    }
+    return 0;
+}
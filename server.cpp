@@ -0,0 +1,63 @@
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <thread>
+#include <vector>
+#include "Args.hpp"
+#include "SessionScheduler.hpp"
+
+// Runs many sessions of one ROM for a while with random key presses and
+// prints how well the scheduler kept up
+int main(int argc, char** argv)
+{
+    uint32_t count = 100, seconds = 5, threads = 0;
+    if(argc < 2 || (argc > 2 && !ParseArg(argv[2], count)) || (argc > 3 && !ParseArg(argv[3], seconds)) ||
+       (argc > 4 && !ParseArg(argv[4], threads)))
+    {
+        std::cout << "Usage: " << argv[0] << " <rom> [sessions] [seconds] [threads]" << "\n";
+        return -1;
+    }
+    std::ifstream file(argv[1], std::ios::binary);
+    std::vector<uint8_t> rom{std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>()};
+
+    SessionScheduler scheduler{count, threads};
+    for(uint32_t i = 0; i < count; i++)
+    {
+        // Mix of speeds, 500 to 2000 instructions per second
+        if(scheduler.AddSession(rom.data(), rom.size(), 500 + (i % 4) * 500, i) < 0)
+        {
+            std::cout << "Error: could not create session " << i << "\n";
+            return -1;
+        }
+    }
+
+    const auto start = std::chrono::steady_clock::now();
+    scheduler.Start();
+    for(uint32_t tick = 0; tick < seconds * 10; tick++)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        scheduler.SetKeys(tick % count, (tick & 1) ? static_cast<uint16_t>(1u << (tick % 16)) : 0);
+    }
+    scheduler.Stop();
+    const double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    uint64_t frames = 0, idleFrames = 0, missed = 0, parked = 0;
+    double worst = 0;
+    for(uint32_t i = 0; i < count; i++)
+    {
+        SessionStats stats = scheduler.Stats(i);
+        frames += stats.frames;
+        idleFrames += stats.idleFrames;
+        missed += stats.missed;
+        parked += stats.parked;
+        worst = std::max(worst, stats.maxLatenessMs);
+    }
+    std::cout << "Sessions: " << count << " on " << scheduler.Threads() << " threads for " << elapsed << " s\n";
+    std::cout << "Frames: " << frames << " (" << frames / elapsed << " /s, 60 /s per session that is not parked), idle: "
+              << idleFrames << ", parked sessions: " << parked << "\n";
+    std::cout << "Missed deadlines: " << missed << ", worst lateness: " << worst << " ms, steals: "
+              << scheduler.Steals() << "\n";
+    return 0;
+}
@@ -0,0 +1,61 @@
+#include <bitset>
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <thread>
+#include "Args.hpp"
+#include "FrameRing.hpp"
+
+// Follows the frames `main <rom> --shm name` publishes and prints a line of
+// machine stats every second
+int main(int argc, char** argv)
+{
+    uint32_t seconds = 0;
+    if(argc < 2 || (argc > 2 && !ParseArg(argv[2], seconds)))
+    {
+        std::cout << "Usage: " << argv[0] << " <name> [seconds]" << "\n";
+        return -1;
+    }
+    FrameRingReader ring;
+    if(!ring.Open(argv[1]))
+    {
+        return -1;
+    }
+
+    using clock = std::chrono::steady_clock;
+    const auto start = clock::now();
+    auto nextReport = start + std::chrono::seconds(1);
+    uint64_t next = ring.Published();
+    uint64_t read = 0, missed = 0;
+    FrameRecord record{};
+    while(seconds == 0 || clock::now() - start < std::chrono::seconds(seconds))
+    {
+        const uint64_t published = ring.Published();
+        for(; next < published; next++)
+        {
+            if(ring.Read(next, record))
+            {
+                read++;
+            }
+            else
+            {
+                missed++;
+            }
+        }
+        if(clock::now() >= nextReport)
+        {
+            size_t lit = 0;
+            for(uint8_t bits : record.screen)
+            {
+                lit += std::bitset<8>(bits).count();
+            }
+            std::cout << "frame " << record.frame << "  PC " << std::hex << record.cpu.PC << "  I " << record.cpu.Index
+                      << "  keys " << record.keys << std::dec << "  DT " << +record.delayTimer << "  ST "
+                      << +record.soundTimer << "  lit pixels " << lit << "  read " << read << "  missed " << missed
+                      << "\n";
+            nextReport += std::chrono::seconds(1);
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    return 0;
+}
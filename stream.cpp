@@ -0,0 +1,63 @@
+#include <chrono>
+#include <csignal>
+#include <iostream>
+#include <string>
+#include <thread>
+#include "Args.hpp"
+#include "Chip8.hpp"
+#include "Stream.hpp"
+
+// Runs a ROM in real time without a window and streams its screen to every
+// viewer connected to the socket. Viewers control the keypad
+static volatile std::sig_atomic_t stopRequested = 0;
+
+int main(int argc, char** argv)
+{
+    uint32_t IPS = 600;
+    uint64_t seed = 0;
+    if(argc < 3 || (argc > 3 && !ParseArg(argv[3], IPS)) || (argc > 4 && !ParseArg(argv[4], seed)))
+    {
+        std::cout << "Usage: " << argv[0] << " <rom> <socket path | port> [IPS] [seed]" << "\n";
+        return -1;
+    }
+    Chip8 chip8;
+    chip8.Seed(seed);
+    if(chip8.LoadRom(argv[1]) < 0)
+    {
+        return -1;
+    }
+    StreamServer server;
+    if(!server.Listen(argv[2]))
+    {
+        return -1;
+    }
+    std::signal(SIGINT, [](int) { stopRequested = 1; });
+    std::signal(SIGTERM, [](int) { stopRequested = 1; });
+
+    using clock = std::chrono::steady_clock;
+    const auto framePeriod = std::chrono::duration_cast<clock::duration>(std::chrono::nanoseconds(1000000000 / 60));
+    auto nextFrame = clock::now();
+    size_t viewers = 0;
+    while(!stopRequested)
+    {
+        server.Poll();
+        if(server.ViewerCount() != viewers)
+        {
+            viewers = server.ViewerCount();
+            std::cout << "Viewers: " << viewers << "\n";
+        }
+        server.ApplyKeys(chip8);
+        for(uint32_t i = 0; i < IPS / 60; i++)
+        {
+            chip8.Cycle();
+        }
+        chip8.UpdateTimers();
+        server.Publish(chip8);
+        chip8.screenUpdate = false;
+
+        nextFrame += framePeriod;
+        std::this_thread::sleep_until(nextFrame);
+    }
+    std::cout << "Frames published: " << server.FramesPublished() << ", bytes sent: " << server.BytesSent() << "\n";
+    return 0;
+}
@@ -0,0 +1,72 @@
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <thread>
+#include "Args.hpp"
+#include "Chip8.hpp"
+#include "Terminal.hpp"
+
+// Runs a ROM in the terminal at 60 frames per second, works over SSH.
+// Esc quits, space pauses, '=' resets
+int main(int argc, char** argv)
+{
+    uint32_t IPS = 600;
+    uint64_t seed = 0;
+    if(argc < 2 || (argc > 2 && !ParseArg(argv[2], IPS)) || (argc > 3 && !ParseArg(argv[3], seed)))
+    {
+        std::cout << "Usage: " << argv[0] << " <rom> [IPS] [seed]" << "\n";
+        return -1;
+    }
+    Chip8 chip8;
+    chip8.Seed(seed);
+    if(chip8.LoadRom(argv[1]) < 0)
+    {
+        return -1;
+    }
+
+    using clock = std::chrono::steady_clock;
+    const auto framePeriod = std::chrono::duration_cast<clock::duration>(std::chrono::nanoseconds(1000000000 / 60));
+    uint64_t bytes = 0, frames = 0;
+    bool paused = false;
+    bool sounding = false;
+    {
+        TerminalInput input;
+        TerminalRenderer renderer;
+        auto nextFrame = clock::now();
+        auto nextStatus = nextFrame;
+        bool running = true;
+        while(running)
+        {
+            switch(input.Poll(chip8))
+            {
+                case TerminalInput::QUIT: running = false; break;
+                case TerminalInput::PAUSE: paused = !paused; break;
+                case TerminalInput::RESET: chip8.Reset(); break;
+                case TerminalInput::NONE: break;
+            }
+            if(!paused)
+            {
+                for(uint32_t i = 0; i < IPS / 60; i++)
+                {
+                    chip8.Cycle();
+                }
+                const bool silent = chip8.UpdateTimers();
+                // The terminal bell stands in for the tone
+                bytes += renderer.Render(chip8.video, !silent && !sounding);
+                sounding = !silent;
+                chip8.screenUpdate = false;
+                frames++;
+            }
+            if(clock::now() >= nextStatus)
+            {
+                renderer.Status((paused ? "PAUSED  " : "") + std::to_string(frames) + " frames, " +
+                                std::to_string(frames ? bytes / frames : 0) + " bytes/frame");
+                nextStatus += std::chrono::seconds(1);
+            }
+            nextFrame += framePeriod;
+            std::this_thread::sleep_until(nextFrame);
+        }
+    }
+    std::cout << "Sent " << bytes << " bytes for " << frames << " frames\n";
+    return 0;
+}
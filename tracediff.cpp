@@ -0,0 +1,367 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "Args.hpp"
+#include "Disassembler.hpp"
+#include "Trace.hpp"
+
+// Finds the first point where two execution traces differ, e.g. from two
+// builds playing the same movie with `headless --trace`. Both files are read
+// in lockstep a block at a time and whole equal blocks are skipped with a
+// single memcmp, so memory stays at two blocks and multi-GB traces go as
+// fast as the disk. Binary traces (Trace.hpp) are compared record by
+// record, anything else line by line (e.g. the DEBUG build's state dump)
+
+static const size_t CONTEXT_BYTES = 64 * 1024;
+
+struct Divergence
+{
+    bool found;         // False when the traces are identical
+    uint64_t offset;    // First differing byte, or where the shorter trace ends
+    uint64_t lines;     // Newlines before offset (text traces only)
+    uint64_t lineStart; // Offset of the line holding offset (text traces only)
+};
+
+static uint64_t FileSize(std::FILE *file)
+{
+    fseeko(file, 0, SEEK_END);
+    return static_cast<uint64_t>(ftello(file));
+}
+
+// The linear pass: compares both files from start on, block by block
+static Divergence FirstDifference(std::FILE *a, std::FILE *b, uint64_t start, size_t blockSize, bool countLines)
+{
+    std::vector<uint8_t> left(blockSize), right(blockSize);
+    Divergence divergence{false, start, 0, start};
+    fseeko(a, static_cast<off_t>(start), SEEK_SET);
+    fseeko(b, static_cast<off_t>(start), SEEK_SET);
+    while (true)
+    {
+        const size_t readA = std::fread(left.data(), 1, blockSize, a);
+        const size_t readB = std::fread(right.data(), 1, blockSize, b);
+        const size_t common = std::min(readA, readB);
+        size_t same = common;
+        if (std::memcmp(left.data(), right.data(), common) != 0)
+        {
+            same = std::mismatch(left.begin(), left.begin() + common, right.begin()).first - left.begin();
+        }
+        if (countLines)
+        {
+            // memchr is vectorised even in debug builds, unlike std::count
+            const uint8_t *end = left.data() + same;
+            for (const uint8_t *p = left.data(); (p = static_cast<const uint8_t *>(std::memchr(p, '\n', end - p))); p++)
+            {
+                divergence.lines++;
+            }
+            const auto lastNewline = std::find(std::make_reverse_iterator(left.begin() + same), left.rend(), '\n');
+            if (lastNewline != left.rend())
+            {
+                divergence.lineStart = divergence.offset + (lastNewline.base() - left.begin());
+            }
+        }
+        divergence.offset += same;
+        if (same < common || readA != readB)
+        {
+            divergence.found = true;
+            return divergence;
+        }
+        if (common == 0)
+        {
+            return divergence;
+        }
+    }
+}
+
+// --- Binary traces ---
+
+static std::vector<trace::Record> ReadRecords(std::FILE *file, uint64_t first, uint64_t count)
+{
+    std::vector<uint8_t> bytes(count * trace::RECORD_SIZE);
+    fseeko(file, static_cast<off_t>(trace::HEADER_SIZE + first * trace::RECORD_SIZE), SEEK_SET);
+    const size_t read = std::fread(bytes.data(), trace::RECORD_SIZE, count, file);
+    std::vector<trace::Record> records;
+    for (size_t i = 0; i < read; i++)
+    {
+        records.push_back(trace::Decode(bytes.data() + i * trace::RECORD_SIZE));
+    }
+    return records;
+}
+
+static std::string FormatInstruction(uint64_t index, const trace::Record &record)
+{
+    char line[48];
+    std::snprintf(line, sizeof(line), "%10llu  %03X  %04X  ", static_cast<unsigned long long>(index), record.PC, record.opcode);
+    return line + disasm::Disassemble(record.opcode);
+}
+
+static std::string FormatEnd(uint64_t index)
+{
+    char line[40];
+    std::snprintf(line, sizeof(line), "%10llu  (end of trace)", static_cast<unsigned long long>(index));
+    return line;
+}
+
+// One row per machine state with a marker row under the differing fields
+static void PrintStates(const trace::Record &a, const trace::Record &b)
+{
+    struct Field
+    {
+        const char *name;
+        unsigned valueA, valueB;
+        int width;
+    };
+    std::vector<Field> fields{{"PC", a.PC, b.PC, 3}, {"I", a.Index, b.Index, 3}, {"SP", a.SP, b.SP, 2},
+                              {"DT", a.delayTimer, b.delayTimer, 2}, {"ST", a.soundTimer, b.soundTimer, 2},
+                              {"RET", a.stackTop, b.stackTop, 3}};
+    static const char *const names[sizes::numRegisters] = {"V0", "V1", "V2", "V3", "V4", "V5", "V6", "V7",
+                                                           "V8", "V9", "VA", "VB", "VC", "VD", "VE", "VF"};
+    for (int i = 0; i < sizes::numRegisters; i++)
+    {
+        fields.push_back({names[i], a.registers[i], b.registers[i], 2});
+    }
+
+    std::string header = "     ", rowA = "  a  ", rowB = "  b  ", marks = "     ";
+    for (const Field &field : fields)
+    {
+        const int width = std::max<int>(field.width, std::strlen(field.name));
+        char cell[16];
+        std::snprintf(cell, sizeof(cell), "%-*s ", width, field.name);
+        header += cell;
+        std::snprintf(cell, sizeof(cell), "%0*X%*s ", field.width, field.valueA, width - field.width, "");
+        rowA += cell;
+        std::snprintf(cell, sizeof(cell), "%0*X%*s ", field.width, field.valueB, width - field.width, "");
+        rowB += cell;
+        marks += std::string(width, field.valueA != field.valueB ? '^' : ' ') + " ";
+    }
+    std::cout << header << "\n" << rowA << "\n" << rowB << "\n" << marks << "\n";
+}
+
+static int ReportBinary(std::FILE *a, std::FILE *b, const Divergence &divergence, uint64_t context)
+{
+    const uint64_t countA = (FileSize(a) - trace::HEADER_SIZE) / trace::RECORD_SIZE;
+    const uint64_t countB = (FileSize(b) - trace::HEADER_SIZE) / trace::RECORD_SIZE;
+    const uint64_t index = (divergence.offset - trace::HEADER_SIZE) / trace::RECORD_SIZE;
+    const uint64_t first = index > context ? index - context : 0;
+    const std::vector<trace::Record> windowA = ReadRecords(a, first, index + context + 1 - first);
+    const std::vector<trace::Record> windowB = ReadRecords(b, first, index + context + 1 - first);
+
+    if (index >= countA || index >= countB)
+    {
+        std::cout << "Identical for " << index << " instructions, then trace " << (index >= countA ? "a" : "b")
+                  << " ends while the other has " << (std::max(countA, countB) - index) << " more\n\n";
+    }
+    else
+    {
+        std::cout << "First difference at instruction " << index << "\n\n";
+    }
+    std::cout << "    instruction  PC   op    disassembly\n";
+    for (uint64_t i = first; i <= index + context; i++)
+    {
+        const size_t slot = i - first;
+        const bool inA = slot < windowA.size(), inB = slot < windowB.size();
+        if (!inA && !inB)
+        {
+            break;
+        }
+        if (i < index)
+        {
+            std::cout << "   " << FormatInstruction(i, windowA[slot]) << "\n";
+            continue;
+        }
+        std::cout << (i == index ? "a> " : "a  ") << (inA ? FormatInstruction(i, windowA[slot]) : FormatEnd(i)) << "\n";
+        std::cout << (i == index ? "b> " : "b  ") << (inB ? FormatInstruction(i, windowB[slot]) : FormatEnd(i)) << "\n";
+    }
+
+    const size_t at = index - first;
+    if (at < windowA.size() && at < windowB.size())
+    {
+        std::cout << "\nState before instruction " << index << ":\n";
+        PrintStates(windowA[at], windowB[at]);
+        if (at > 0)
+        {
+            // The instruction that ran last in both is usually the culprit
+            std::cout << "Last instruction before it: " << disasm::Disassemble(windowA[at - 1].opcode) << " at "
+                      << std::hex << std::uppercase << windowA[at - 1].PC << std::nouppercase << std::dec << "\n";
+        }
+    }
+    return 1;
+}
+
+// --- Text traces ---
+
+// Up to count lines starting at from, stopping at end of file
+static std::vector<std::string> ReadLinesAfter(std::FILE *file, uint64_t from, uint64_t count)
+{
+    std::vector<std::string> lines;
+    std::vector<char> bytes(CONTEXT_BYTES);
+    fseeko(file, static_cast<off_t>(from), SEEK_SET);
+    const size_t read = std::fread(bytes.data(), 1, bytes.size(), file);
+    size_t begin = 0;
+    while (lines.size() < count && begin < read)
+    {
+        const size_t end = std::find(bytes.begin() + begin, bytes.begin() + read, '\n') - bytes.begin();
+        lines.emplace_back(bytes.data() + begin, end - begin);
+        begin = end + 1;
+    }
+    return lines;
+}
+
+// Up to count whole lines ending right before offset
+static std::vector<std::string> ReadLinesBefore(std::FILE *file, uint64_t start, uint64_t offset, uint64_t count)
+{
+    const uint64_t from = offset - std::min<uint64_t>(offset - start, CONTEXT_BYTES);
+    std::vector<char> bytes(offset - from);
+    fseeko(file, static_cast<off_t>(from), SEEK_SET);
+    const size_t read = std::fread(bytes.data(), 1, bytes.size(), file);
+    std::vector<std::string> lines;
+    size_t end = read;
+    while (lines.size() < count && end > 0)
+    {
+        // bytes[end - 1] is the newline closing the previous line
+        const auto lineBegin = std::find(std::make_reverse_iterator(bytes.begin() + end - 1), bytes.rend(), '\n').base();
+        if (lineBegin == bytes.begin() && from > start)
+        {
+            break; // Longer than the context buffer
+        }
+        lines.emplace_back(lineBegin, bytes.begin() + end - 1);
+        end = lineBegin - bytes.begin();
+    }
+    std::reverse(lines.begin(), lines.end());
+    return lines;
+}
+
+static std::string FormatLine(uint64_t number, const std::string &text)
+{
+    char prefix[24];
+    std::snprintf(prefix, sizeof(prefix), "%10llu  ", static_cast<unsigned long long>(number));
+    return prefix + text;
+}
+
+static int ReportText(std::FILE *a, std::FILE *b, const Divergence &divergence, uint64_t context)
+{
+    const uint64_t line = divergence.lines + 1;
+    const std::vector<std::string> before = ReadLinesBefore(a, 0, divergence.lineStart, context);
+    const std::vector<std::string> afterA = ReadLinesAfter(a, divergence.lineStart, context + 1);
+    const std::vector<std::string> afterB = ReadLinesAfter(b, divergence.lineStart, context + 1);
+
+    std::cout << "First difference at line " << line << ", column " << divergence.offset - divergence.lineStart + 1 << "\n\n";
+    for (size_t i = 0; i < before.size(); i++)
+    {
+        std::cout << "   " << FormatLine(line - before.size() + i, before[i]) << "\n";
+    }
+    for (uint64_t i = 0; i <= context; i++)
+    {
+        if (i >= afterA.size() && i >= afterB.size())
+        {
+            break;
+        }
+        std::cout << (i == 0 ? "a> " : "a  ") << FormatLine(line + i, i < afterA.size() ? afterA[i] : "(end of trace)") << "\n";
+        std::cout << (i == 0 ? "b> " : "b  ") << FormatLine(line + i, i < afterB.size() ? afterB[i] : "(end of trace)") << "\n";
+    }
+    return 1;
+}
+
+static void PrintUsage(const char *program)
+{
+    std::cout << "Usage: " << program << " <trace a> <trace b> [--context n] [--block KB]\n";
+}
+
+int main(int argc, char** argv)
+{
+    if (argc < 3)
+    {
+        PrintUsage(argv[0]);
+        return -1;
+    }
+    uint64_t context = 8;
+    size_t blockSize = 1 << 20;
+    for (int i = 3; i < argc; i++)
+    {
+        if (std::strcmp(argv[i], "--context") == 0 && i + 1 < argc)
+        {
+            if (!ParseArg(argv[++i], context))
+            {
+                PrintUsage(argv[0]);
+                return -1;
+            }
+        }
+        else if (std::strcmp(argv[i], "--block") == 0 && i + 1 < argc)
+        {
+            uint32_t kilobytes = 0;
+            if (!ParseArg(argv[++i], kilobytes))
+            {
+                PrintUsage(argv[0]);
+                return -1;
+            }
+            blockSize = std::max<size_t>(1, kilobytes) * 1024;
+        }
+        else
+        {
+            std::cout << "Unknown option: " << argv[i] << "\n";
+            return -1;
+        }
+    }
+
+    std::FILE *a = std::fopen(argv[1], "rb");
+    std::FILE *b = std::fopen(argv[2], "rb");
+    if (!a || !b)
+    {
+        std::cout << "Error: could not open " << (a ? argv[2] : argv[1]) << "\n";
+        return -1;
+    }
+
+    uint8_t headerBytes[trace::HEADER_SIZE];
+    trace::Header headerA{}, headerB{};
+    const bool binaryA = trace::DecodeHeader(headerBytes, std::fread(headerBytes, 1, sizeof(headerBytes), a), headerA);
+    const bool binaryB = trace::DecodeHeader(headerBytes, std::fread(headerBytes, 1, sizeof(headerBytes), b), headerB);
+    if (binaryA != binaryB)
+    {
+        std::cout << "Error: " << (binaryA ? argv[1] : argv[2]) << " is a binary trace but the other isn't\n";
+        return -1;
+    }
+    if (binaryA)
+    {
+        if (headerA.version != trace::VERSION || headerB.version != trace::VERSION ||
+            headerA.recordSize != trace::RECORD_SIZE || headerB.recordSize != trace::RECORD_SIZE)
+        {
+            std::cout << "Error: unsupported trace version\n";
+            return -1;
+        }
+        if (headerA.romHash != headerB.romHash)
+        {
+            std::cout << "Warning: the traces ran different ROMs\n";
+        }
+        if (headerA.seed != headerB.seed)
+        {
+            std::cout << "Warning: the traces used different seeds (" << headerA.seed << " and " << headerB.seed << ")\n";
+        }
+    }
+
+    const uint64_t start = binaryA ? trace::HEADER_SIZE : 0;
+    const auto begin = std::chrono::steady_clock::now();
+    const Divergence divergence = FirstDifference(a, b, start, blockSize, !binaryA);
+    const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+    const double megabytes = (divergence.offset - start) / 1e6;
+    std::cout << "Compared " << megabytes << " MB per trace in " << seconds << " s ("
+              << (seconds > 0 ? megabytes / seconds : 0.0) << " MB/s)\n";
+
+    int result = 0;
+    if (!divergence.found)
+    {
+        std::cout << "Traces are identical ("
+                  << (binaryA ? (divergence.offset - start) / trace::RECORD_SIZE : divergence.lines)
+                  << (binaryA ? " instructions" : " lines") << ")\n";
+    }
+    else
+    {
+        result = binaryA ? ReportBinary(a, b, divergence, context) : ReportText(a, b, divergence, context);
+    }
+    std::fclose(a);
+    std::fclose(b);
+    return result;
+}
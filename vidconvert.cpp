@@ -0,0 +1,57 @@
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <string>
+#include "Args.hpp"
+#include "VideoExport.hpp"
+#include "VideoRecorder.hpp"
+
+// Converts a recording made with `main <rom> --video file` to an animated
+// GIF, an animated PNG or a sequence of BMP files
+int main(int argc, char** argv)
+{
+    int scale = 1;
+    if(argc < 4 || (argc > 4 && !ParseArg(argv[4], scale)))
+    {
+        std::cout << "Usage: " << argv[0] << " <recording> <gif | apng | bmp> <output file or bmp prefix> [scale]" << "\n";
+        return -1;
+    }
+    std::unique_ptr<FrameExporter> exporter;
+    if(std::strcmp(argv[2], "gif") == 0)
+    {
+        exporter = std::make_unique<GifExporter>();
+    }
+    else if(std::strcmp(argv[2], "apng") == 0)
+    {
+        exporter = std::make_unique<ApngExporter>();
+    }
+    else if(std::strcmp(argv[2], "bmp") == 0)
+    {
+        exporter = std::make_unique<BmpSequenceExporter>();
+    }
+    else
+    {
+        std::cout << "Unknown format: " << argv[2] << "\n";
+        return -1;
+    }
+    ExportOptions options;
+    if(argc > 4)
+    {
+        options.scale = std::max(1, scale);
+    }
+    if(!exporter->Begin(argv[3], options))
+    {
+        return -1;
+    }
+
+    uint64_t frames = 0, screens = 0;
+    const bool complete = ReadVideo(argv[1], [&](const uint8_t *screen, uint32_t shown) {
+        exporter->AddFrame(screen, shown);
+        frames += shown;
+        screens++;
+    });
+    const bool written = exporter->End();
+    std::cout << "Converted " << screens << " screens, " << frames << " frames (" << frames / 60.0 << " s)\n";
+    return complete && written ? 0 : 1;
+}
@@ -0,0 +1,86 @@
+#include <cstdio>
+#include <iostream>
+#include <poll.h>
+#include <string>
+#include <unistd.h>
+#include "Chip8.hpp"
+#include "FrameCodec.hpp"
+#include "Stream.hpp"
+
+// Shows the screen of a `stream` server in the terminal. Typing hex digits
+// (0-f) and Enter toggles those keys on the server's keypad
+static void Draw(const uint8_t *frame, uint16_t keys, uint64_t bytes, uint64_t frames)
+{
+    std::string out = "\x1b[H";
+    for(int y = 0; y < sizes::VIDEO_HEIGHT; y++)
+    {
+        for(int x = 0; x < sizes::VIDEO_WIDTH; x++)
+        {
+            const int pixel = y * sizes::VIDEO_WIDTH + x;
+            out += ((frame[pixel / 8] >> (7 - pixel % 8)) & 1u) ? '#' : ' ';
+        }
+        out += "|\n";
+    }
+    char status[128];
+    snprintf(status, sizeof(status), "keys %04x, %llu frames, %llu bytes received\x1b[K\n", keys,
+             static_cast<unsigned long long>(frames), static_cast<unsigned long long>(bytes));
+    out += status;
+    std::cout << out << std::flush;
+}
+
+int main(int argc, char** argv)
+{
+    if(argc < 2)
+    {
+        std::cout << "Usage: " << argv[0] << " <socket path | port>" << "\n";
+        return -1;
+    }
+    StreamClient client;
+    if(!client.Connect(argv[1]))
+    {
+        return -1;
+    }
+    std::cout << "\x1b[2J";
+    uint64_t frames = 0;
+    bool readKeys = true;
+    while(true)
+    {
+        pollfd fds[2] = {{client.Fd(), POLLIN, 0}, {STDIN_FILENO, POLLIN, 0}};
+        if(poll(fds, readKeys ? 2 : 1, -1) < 0)
+        {
+            break;
+        }
+        if(readKeys && (fds[1].revents & (POLLIN | POLLHUP)))
+        {
+            char line[64];
+            const ssize_t got = read(STDIN_FILENO, line, sizeof(line));
+            readKeys = got > 0;
+            uint16_t keys = client.Keys();
+            for(ssize_t i = 0; i < got; i++)
+            {
+                const char c = line[i];
+                if(c >= '0' && c <= '9')
+                {
+                    keys ^= static_cast<uint16_t>(1u << (c - '0'));
+                }
+                else if(c >= 'a' && c <= 'f')
+                {
+                    keys ^= static_cast<uint16_t>(1u << (c - 'a' + 10));
+                }
+            }
+            client.SetKeys(keys);
+        }
+        const int received = client.Poll();
+        if(received < 0)
+        {
+            std::cout << "Server closed the stream\n";
+            break;
+        }
+        if(received > 0)
+        {
+            frames += received;
+            Draw(client.Frame(), client.Keys(), client.BytesReceived(), frames);
+        }
+    }
+    return 0;
+}